@@ -0,0 +1,217 @@
+#include "benchmark.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <map>
+#include <iterator>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+BenchmarkOptions defaultBenchmarkOptions()
+{
+	BenchmarkOptions options;
+	options.samples = 30;
+	options.minSampleSeconds = 0.02;
+	options.outputPath = "benchmark_results.json";
+	options.threshold = 0.10;
+	return options;
+}
+
+static double timeIterations(const Benchmark &benchmark, uint64_t iterations)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	benchmark.body(iterations);
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double>(end - start).count();
+}
+
+// tag::runBenchmark[]
+BenchmarkResult runBenchmark(const Benchmark &benchmark, const BenchmarkOptions &options)
+{
+	BenchmarkResult result;
+	result.name = benchmark.name;
+	result.kind = benchmark.kind;
+
+	//calibrate - double the iteration count until one sample is long enough to time reliably
+	uint64_t iterations = 1;
+	double seconds = timeIterations(benchmark, iterations);
+	while (seconds < options.minSampleSeconds && iterations < (uint64_t(1) << 40))
+	{
+		iterations *= 2;
+		seconds = timeIterations(benchmark, iterations);
+	}
+	result.iterationsPerSample = iterations;
+
+	timeIterations(benchmark, iterations); //warm-up sample, discarded
+
+	for (int sample = 0; sample < options.samples; sample++)
+		result.samples.push_back(timeIterations(benchmark, iterations) * 1e9 / double(iterations));
+
+	summariseSamples(result);
+	return result;
+}
+// end::runBenchmark[]
+
+void summariseSamples(BenchmarkResult &result)
+{
+	std::vector<double> sorted = result.samples;
+	std::sort(sorted.begin(), sorted.end());
+	size_t count = sorted.size();
+	if (count == 0)
+	{
+		result.mean = result.median = result.stddev = result.min = result.max = result.p95 = 0.0;
+		return;
+	}
+
+	double sum = 0.0;
+	for (size_t i = 0; i < count; i++)
+		sum += sorted[i];
+	result.mean = sum / count;
+
+	double squares = 0.0;
+	for (size_t i = 0; i < count; i++)
+		squares += (sorted[i] - result.mean) * (sorted[i] - result.mean);
+	result.stddev = (count > 1) ? std::sqrt(squares / (count - 1)) : 0.0;
+
+	result.median = (count % 2) ? sorted[count / 2] : 0.5 * (sorted[count / 2 - 1] + sorted[count / 2]);
+	result.min = sorted.front();
+	result.max = sorted.back();
+	result.p95 = sorted[std::min(count - 1, size_t(std::ceil(0.95 * count)) - 1)];
+}
+
+static std::string compilerName()
+{
+	std::ostringstream name;
+#if defined(__clang__)
+	name << "clang " << __clang_major__ << "." << __clang_minor__;
+#elif defined(__GNUC__)
+	name << "gcc " << __GNUC__ << "." << __GNUC_MINOR__;
+#elif defined(_MSC_VER)
+	name << "msvc " << _MSC_VER;
+#else
+	name << "unknown";
+#endif
+	return name.str();
+}
+
+// tag::writeBenchmarkJson[]
+bool writeBenchmarkJson(const std::string &filePath, const std::vector<BenchmarkResult> &results, const BenchmarkOptions &options)
+{
+	std::ofstream json(filePath, std::ios::out | std::ios::trunc);
+	if (!json)
+	{
+		cerr << "Benchmark results could not be written - cannot open file " << filePath << endl;
+		return false;
+	}
+
+	json << std::fixed << std::setprecision(3);
+	json << "{\n";
+	json << "  \"context\": {\n";
+	json << "    \"compiler\": \"" << compilerName() << "\",\n";
+#ifdef NDEBUG
+	json << "    \"configuration\": \"release\",\n";
+#else
+	json << "    \"configuration\": \"debug\",\n";
+#endif
+	json << "    \"samples\": " << options.samples << ",\n";
+	json << "    \"min_sample_seconds\": " << options.minSampleSeconds << "\n";
+	json << "  },\n";
+	json << "  \"benchmarks\": [\n";
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchmarkResult &result = results[i];
+		json << "    {\n";
+		json << "      \"name\": \"" << result.name << "\",\n";
+		json << "      \"kind\": \"" << result.kind << "\",\n";
+		json << "      \"iterations_per_sample\": " << result.iterationsPerSample << ",\n";
+		json << "      \"mean_ns\": " << result.mean << ",\n";
+		json << "      \"median_ns\": " << result.median << ",\n";
+		json << "      \"stddev_ns\": " << result.stddev << ",\n";
+		json << "      \"min_ns\": " << result.min << ",\n";
+		json << "      \"max_ns\": " << result.max << ",\n";
+		json << "      \"p95_ns\": " << result.p95 << "\n";
+		json << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	json << "  ]\n";
+	json << "}\n";
+
+	cout << "Benchmark results written to " << filePath << endl;
+	return bool(json);
+}
+// end::writeBenchmarkJson[]
+
+//reads back the files written above - just enough JSON to find each name and its summary
+static bool readBaseline(const std::string &filePath, std::map<std::string, BenchmarkResult> &baseline)
+{
+	std::ifstream fileStream(filePath, std::ios::in | std::ios::binary);
+	if (!fileStream)
+	{
+		cerr << "Baseline could not be loaded - cannot read file " << filePath << endl;
+		return false;
+	}
+	std::string text((std::istreambuf_iterator<char>(fileStream)), std::istreambuf_iterator<char>());
+
+	const std::string nameKey = "\"name\": \"";
+	size_t position = text.find(nameKey);
+	while (position != std::string::npos)
+	{
+		size_t nameStart = position + nameKey.size();
+		size_t nameEnd = text.find('"', nameStart);
+		size_t next = text.find(nameKey, nameEnd);
+		std::string entry = text.substr(nameEnd, next == std::string::npos ? std::string::npos : next - nameEnd);
+
+		BenchmarkResult result;
+		result.name = text.substr(nameStart, nameEnd - nameStart);
+		size_t median = entry.find("\"median_ns\": ");
+		size_t min = entry.find("\"min_ns\": ");
+		if (median != std::string::npos && min != std::string::npos)
+		{
+			result.median = std::strtod(entry.c_str() + median + 13, nullptr);
+			result.min = std::strtod(entry.c_str() + min + 10, nullptr);
+			baseline[result.name] = result;
+		}
+		position = next;
+	}
+	return true;
+}
+
+// tag::compareWithBaseline[]
+//A benchmark regresses when its median is more than `threshold` slower than the baseline median,
+//and even its fastest sample is slower than the baseline median - so one noisy sample can't fail a run
+bool compareWithBaseline(const std::string &baselinePath, const std::vector<BenchmarkResult> &results, double threshold)
+{
+	std::map<std::string, BenchmarkResult> baseline;
+	if (!readBaseline(baselinePath, baseline))
+		return false;
+
+	bool passed = true;
+	cout << "\nComparison with " << baselinePath << " (threshold " << threshold * 100.0 << "%):" << endl;
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchmarkResult &result = results[i];
+		std::map<std::string, BenchmarkResult>::const_iterator found = baseline.find(result.name);
+		if (found == baseline.end() || found->second.median <= 0.0)
+		{
+			cout << "  " << std::left << std::setw(36) << result.name << " new" << endl;
+			continue;
+		}
+
+		double change = result.median / found->second.median - 1.0;
+		bool regressed = change > threshold && result.min > found->second.median;
+		if (regressed)
+			passed = false;
+		cout << "  " << std::left << std::setw(36) << result.name << std::right << std::fixed << std::setprecision(1)
+			<< std::setw(8) << change * 100.0 << "%" << (regressed ? "  REGRESSION" : "") << endl;
+	}
+	cout << (passed ? "No regressions" : "Regressions found") << endl;
+	return passed;
+}
+// end::compareWithBaseline[]
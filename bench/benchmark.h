@@ -0,0 +1,69 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+// tag::benchmark[]
+//A small, dependency free benchmark harness.
+//
+//  - each benchmark body runs `iterations` times per call; the harness picks an iteration count so one
+//    sample takes at least `minSampleSeconds`, throws away a warm-up sample, then records `samples` samples
+//  - results are nanoseconds per iteration, summarised as mean/median/stddev/min/max/p95
+//  - results are written as JSON, and can be compared against a stored baseline to catch regressions
+struct Benchmark
+{
+	Benchmark() : needsGL(false) {}
+
+	std::string name;
+	std::string kind; // "micro" or "macro"
+	bool needsGL; // only run when a GL context could be created
+	std::function<void(uint64_t iterations)> body;
+};
+
+struct BenchmarkResult
+{
+	std::string name;
+	std::string kind;
+	uint64_t iterationsPerSample;
+	std::vector<double> samples; // nanoseconds per iteration
+
+	double mean;
+	double median;
+	double stddev;
+	double min;
+	double max;
+	double p95;
+};
+
+struct BenchmarkOptions
+{
+	int samples;
+	double minSampleSeconds;
+	std::string filter; // only run benchmarks whose name contains this
+	std::string outputPath;
+	std::string baselinePath; // compare against this file when not empty
+	double threshold; // a median this much slower than the baseline (0.1 = 10%) is a regression
+};
+
+BenchmarkOptions defaultBenchmarkOptions();
+
+BenchmarkResult runBenchmark(const Benchmark &benchmark, const BenchmarkOptions &options);
+void summariseSamples(BenchmarkResult &result);
+
+bool writeBenchmarkJson(const std::string &filePath, const std::vector<BenchmarkResult> &results, const BenchmarkOptions &options);
+bool compareWithBaseline(const std::string &baselinePath, const std::vector<BenchmarkResult> &results, double threshold); // false if anything regressed
+
+//stop the optimiser from removing work whose result is otherwise unused
+template <typename T>
+inline void doNotOptimize(const T &value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "g"(&value) : "memory");
+#else
+	static volatile const void *sink;
+	sink = &value;
+#endif
+}
+// end::benchmark[]
@@ -0,0 +1,862 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+
+#include <GL/glew.h>
+#include <SDL2/SDL.h>
+
+#define GLM_FORCE_RADIANS // suppress a warning in GLM 0.9.5
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "benchmark.h"
+#include "game.h"
+#include "renderer.h"
+#include "lodMesh.h"
+#include "lightClusters.h"
+#include "particleSystem.h"
+#include "renderQueue.h"
+#include "transformBatch.h"
+#include "headlessMatch.h"
+#include "matchEvents.h"
+#include "gpuArena.h"
+#include "assetPack.h"
+#include "courtEnv.h"
+#include "scene.h"
+
+using std::cout;
+using std::cerr;
+using std::endl;
+using std::string;
+
+// tag::benchmarkInputs[]
+//every input is generated from a fixed seed, so runs on different machines (and days) do the same work
+static float randomFloat(uint32_t &randomState, float low, float high)
+{
+	randomState = randomState * 1664525u + 1013904223u; //LCG - deterministic across compilers, unlike std::rand
+	return low + (high - low) * float(randomState >> 8) / float(1 << 24);
+}
+
+static std::vector<glm::vec3> randomPositions(size_t count)
+{
+	uint32_t randomState = 12345;
+	std::vector<glm::vec3> positions(count);
+	for (size_t i = 0; i < count; i++)
+		positions[i] = glm::vec3(randomFloat(randomState, -3.0f, 3.0f), 0.0f, randomFloat(randomState, -3.5f, 3.5f));
+	return positions;
+}
+// end::benchmarkInputs[]
+
+
+static void addSimulationBenchmarks(std::vector<Benchmark> &benchmarks)
+{
+	Benchmark step;
+	step.name = "simulation/updateSimulation";
+	step.kind = "micro";
+	step.body = [](uint64_t iterations) {
+		GameState state = newGame();
+		BatAi ai = newBatAi();
+		for (uint64_t i = 0; i < iterations; i++)
+		{
+			steerBats(state, ai);
+			updateSimulation(state);
+			if (state.gameOver)
+				state = newGame();
+		}
+		doNotOptimize(state);
+	};
+	benchmarks.push_back(step);
+
+	std::vector<glm::vec3> positions = randomPositions(1024);
+
+	Benchmark clamp;
+	clamp.name = "collision/clampBat";
+	clamp.kind = "micro";
+	clamp.body = [positions](uint64_t iterations) {
+		int clamped = 0;
+		for (uint64_t i = 0; i < iterations; i++)
+		{
+			glm::vec3 bat = positions[i & 1023];
+			clamped += clampBat(bat);
+			doNotOptimize(bat);
+		}
+		doNotOptimize(clamped);
+	};
+	benchmarks.push_back(clamp);
+
+	Benchmark wall;
+	wall.name = "collision/ballHitsSideWall";
+	wall.kind = "micro";
+	wall.body = [positions](uint64_t iterations) {
+		int hits = 0;
+		for (uint64_t i = 0; i < iterations; i++)
+			hits += ballHitsSideWall(positions[i & 1023]);
+		doNotOptimize(hits);
+	};
+	benchmarks.push_back(wall);
+
+	Benchmark bat;
+	bat.name = "collision/ballOverlapsBat";
+	bat.kind = "micro";
+	bat.body = [positions](uint64_t iterations) {
+		int hits = 0;
+		for (uint64_t i = 0; i < iterations; i++)
+			hits += ballOverlapsBat(positions[i & 1023], positions[(i + 512) & 1023]);
+		doNotOptimize(hits);
+	};
+	benchmarks.push_back(bat);
+
+	Benchmark match;
+	match.name = "match/headless";
+	match.kind = "macro";
+	match.body = [](uint64_t iterations) {
+		uint64_t ticks = 0;
+		for (uint64_t i = 0; i < iterations; i++)
+			ticks += playHeadlessMatch();
+		doNotOptimize(ticks);
+	};
+	benchmarks.push_back(match);
+
+	//the same matches, recording every hit, bounce and point - the blocks are encoded but not written,
+	//so the difference from match/headless is what the telemetry costs the simulation
+	Benchmark recorded;
+	recorded.name = "match/headlessWithEvents";
+	recorded.kind = "macro";
+	recorded.body = [](uint64_t iterations) {
+		static MatchEventLog log; // no file
+		MatchEventWriter writer(log);
+		uint64_t ticks = 0;
+		for (uint64_t i = 0; i < iterations; i++)
+		{
+			writer.beginMatch(i, defaultCourtLayout().halfWidth, headlessTickLength);
+			ticks += playHeadlessMatch(12345, &writer);
+		}
+		doNotOptimize(ticks);
+	};
+	benchmarks.push_back(recorded);
+}
+
+// tag::matrixBenchmarks[]
+//the same glm calls render() makes every frame
+static void addMatrixBenchmarks(std::vector<Benchmark> &benchmarks)
+{
+	std::vector<glm::vec3> positions = randomPositions(1024);
+
+	Benchmark translate;
+	translate.name = "matrices/translate";
+	translate.kind = "micro";
+	translate.body = [positions](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++)
+		{
+			glm::mat4 modelMatrix = glm::translate(glm::mat4(1.0f), positions[i & 1023]);
+			doNotOptimize(modelMatrix);
+		}
+	};
+	benchmarks.push_back(translate);
+
+	Benchmark rotate;
+	rotate.name = "matrices/translateRotate";
+	rotate.kind = "micro";
+	rotate.body = [positions](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++)
+		{
+			glm::mat4 modelMatrix = glm::translate(glm::mat4(1.0f), positions[i & 1023]);
+			modelMatrix = glm::rotate(modelMatrix, float(i) * 0.04f, glm::vec3(1, 1, 1));
+			doNotOptimize(modelMatrix);
+		}
+	};
+	benchmarks.push_back(rotate);
+
+	Benchmark lookAt;
+	lookAt.name = "matrices/lookAt";
+	lookAt.kind = "micro";
+	lookAt.body = [positions](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++)
+		{
+			const glm::vec3 &target = positions[i & 1023];
+			glm::mat4 viewMatrix = glm::lookAt(glm::vec3(target.x + 2.0f, target.y + 3.5f, target.z), target, glm::vec3(0.0f, 1.0f, 0.0f));
+			doNotOptimize(viewMatrix);
+		}
+	};
+	benchmarks.push_back(lookAt);
+
+	Benchmark frame;
+	frame.name = "matrices/frame";
+	frame.kind = "micro";
+	frame.body = [positions](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++)
+		{
+			glm::mat4 matrices[9];
+			matrices[0] = glm::perspective(90.0f, 1.0f, 0.1f, 100.0f);
+			matrices[1] = glm::lookAt(glm::vec3(0.0f, 1.5f, 4.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+			for (int object = 2; object < 8; object++)
+				matrices[object] = glm::translate(glm::mat4(1.0f), positions[(i + object) & 1023]);
+			matrices[8] = glm::rotate(glm::translate(glm::mat4(1.0f), positions[i & 1023]), float(i) * 0.04f, glm::vec3(1, 1, 1));
+			doNotOptimize(matrices);
+		}
+	};
+	benchmarks.push_back(frame);
+
+	//every object's model-view and model-view-projection matrices, the way render() builds them now -
+	//first the scene as it is (8 translate-only objects and the ball), then a full batch with 1 in 16 rotating
+	const int batchSizes[] = { 9, TransformBatch::maxObjects };
+	for (int objects : batchSizes)
+	{
+		Benchmark batch;
+		batch.name = "matrices/batch" + std::to_string(objects);
+		batch.kind = "micro";
+		batch.body = [positions, objects](uint64_t iterations) {
+			static TransformBatch transforms;
+			glm::mat4 viewMatrix = glm::lookAt(glm::vec3(0.0f, 1.5f, 4.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+			glm::mat4 projectionMatrix = glm::perspective(90.0f, 1.0f, 0.1f, 100.0f);
+			for (uint64_t i = 0; i < iterations; i++)
+			{
+				transforms.clear();
+				for (int object = 0; object < objects; object++)
+				{
+					const glm::vec3 &position = positions[(i + object) & 1023];
+					if (object % 16 == 8)
+						transforms.addRotated(position, float(i) * 0.04f, glm::vec3(1, 1, 1));
+					else
+						transforms.addTranslated(position);
+				}
+				transforms.build(viewMatrix, projectionMatrix);
+				doNotOptimize(transforms.object(0));
+			}
+		};
+		benchmarks.push_back(batch);
+
+		//the same matrices from glm, one object at a time, for comparison
+		Benchmark perObject;
+		perObject.name = "matrices/glmPerObject" + std::to_string(objects);
+		perObject.kind = "micro";
+		perObject.body = [positions, objects](uint64_t iterations) {
+			static ObjectTransform transforms[TransformBatch::maxObjects];
+			glm::mat4 viewMatrix = glm::lookAt(glm::vec3(0.0f, 1.5f, 4.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+			glm::mat4 projectionMatrix = glm::perspective(90.0f, 1.0f, 0.1f, 100.0f);
+			for (uint64_t i = 0; i < iterations; i++)
+			{
+				for (int object = 0; object < objects; object++)
+				{
+					glm::mat4 modelMatrix = glm::translate(glm::mat4(1.0f), positions[(i + object) & 1023]);
+					if (object % 16 == 8)
+						modelMatrix = glm::rotate(modelMatrix, float(i) * 0.04f, glm::vec3(1, 1, 1));
+					transforms[object].modelView = viewMatrix * modelMatrix;
+					transforms[object].modelViewProjection = projectionMatrix * transforms[object].modelView;
+				}
+				doNotOptimize(transforms[0]);
+			}
+		};
+		benchmarks.push_back(perObject);
+	}
+}
+// end::matrixBenchmarks[]
+
+static void addMeshBenchmarks(std::vector<Benchmark> &benchmarks)
+{
+	Benchmark bat;
+	bat.name = "meshes/generateBatMesh";
+	bat.kind = "micro";
+	bat.body = [](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++)
+		{
+			LodMesh mesh = generateBatMesh(glm::vec3(0.5f, 0.25f, 0.1f), 0.08f, glm::vec4(1.0f, 0.0f, 0.0f, 1.0f), glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+			doNotOptimize(mesh);
+		}
+	};
+	benchmarks.push_back(bat);
+
+	Benchmark ball;
+	ball.name = "meshes/generateBallMesh";
+	ball.kind = "micro";
+	ball.body = [](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++)
+		{
+			LodMesh mesh = generateBallMesh(0.1f, glm::vec4(0.0f, 1.0f, 0.0f, 1.0f), glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
+			doNotOptimize(mesh);
+		}
+	};
+	benchmarks.push_back(ball);
+}
+
+// tag::lightBenchmarks[]
+//sorting lights into clusters on the CPU, for the light counts the frame benchmarks draw
+static void addLightBenchmarks(std::vector<Benchmark> &benchmarks)
+{
+	const int lightCounts[] = { 16, 64, 256, 1024 };
+	for (int count : lightCounts)
+	{
+		std::vector<PointLight> lights(count);
+		uint32_t randomState = 12345;
+		for (PointLight &light : lights)
+		{
+			light.position = glm::vec3(randomFloat(randomState, -3.0f, 3.0f), randomFloat(randomState, 0.0f, 1.0f), randomFloat(randomState, -3.5f, 3.5f));
+			light.radius = randomFloat(randomState, 0.5f, 1.5f);
+			light.color = glm::vec3(0.5f);
+		}
+
+		Benchmark assign;
+		assign.name = "lights/assign" + std::to_string(count);
+		assign.kind = "micro";
+		assign.body = [lights](uint64_t iterations) {
+			static LightClusters clusters; // big - keep it off the stack and out of the timing
+			glm::mat4 viewMatrix = glm::lookAt(glm::vec3(0.0f, 1.5f, 4.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+			glm::mat4 projectionMatrix = glm::perspective(90.0f, 1.0f, 0.1f, 100.0f);
+			for (uint64_t i = 0; i < iterations; i++)
+			{
+				clusters.assign(lights.data(), int(lights.size()), viewMatrix, projectionMatrix, 0.1f, 100.0f);
+				doNotOptimize(clusters.indexCount());
+			}
+		};
+		benchmarks.push_back(assign);
+	}
+}
+// end::lightBenchmarks[]
+
+// tag::renderQueueBenchmarks[]
+//filling and sorting a full render queue - the CPU cost the queue adds to a frame, before any GL call
+//the draws are spread over a few programs and vertex arrays, in a random order, at random depths
+static void addRenderQueueBenchmarks(std::vector<Benchmark> &benchmarks)
+{
+	std::vector<DrawCommand> draws(RenderQueue::maxCommands);
+	std::vector<float> depths(draws.size());
+	uint32_t randomState = 777;
+	for (size_t i = 0; i < draws.size(); i++)
+	{
+		DrawCommand &draw = draws[i];
+		draw.program = 1 + GLuint(randomFloat(randomState, 0.0f, 4.0f));
+		draw.vertexArray = 1 + GLuint(randomFloat(randomState, 0.0f, 16.0f));
+		draw.material = 0;
+		draw.objectLocation = 0;
+		draw.object = int(i);
+		draw.mode = GL_TRIANGLES;
+		draw.first = 0;
+		draw.count = 36;
+		draw.indexType = 0;
+		depths[i] = randomFloat(randomState, 0.0f, 0.1f);
+	}
+
+	Benchmark sort;
+	sort.name = "renderQueue/submitAndSort" + std::to_string(draws.size());
+	sort.kind = "micro";
+	sort.body = [draws, depths](uint64_t iterations) {
+		static RenderQueue queue; // 256 commands - keep it off the stack
+		for (uint64_t i = 0; i < iterations; i++)
+		{
+			for (size_t d = 0; d < draws.size(); d++)
+				queue.submit(draws[d], depths[d]);
+			queue.sort();
+			doNotOptimize(queue.sorted(0));
+			queue.clear();
+		}
+	};
+	benchmarks.push_back(sort);
+}
+// end::renderQueueBenchmarks[]
+
+// tag::assetBenchmarks[]
+//reading every asset at startup - a file at a time, as the loose files are, against mapping the pack and
+//touching every page of it. The page cache is warm after the first sample, so this is the cost of the calls
+//and copies, not of the disk.
+static void addAssetBenchmarks(std::vector<Benchmark> &benchmarks)
+{
+	Benchmark loose;
+	loose.name = "assets/readLooseFiles";
+	loose.kind = "macro";
+	loose.body = [](uint64_t iterations) {
+		std::vector<std::string> names = assetFileNames();
+		size_t bytes = 0;
+		for (uint64_t i = 0; i < iterations; i++)
+		{
+			for (const std::string &name : names)
+			{
+				std::ifstream fileStream(assetDirectory + name, std::ios::in | std::ios::binary);
+				std::vector<char> data((std::istreambuf_iterator<char>(fileStream)), std::istreambuf_iterator<char>());
+				bytes += data.size();
+			}
+		}
+		doNotOptimize(bytes);
+	};
+	benchmarks.push_back(loose);
+
+	Benchmark packed;
+	packed.name = "assets/mapPack";
+	packed.kind = "macro";
+	packed.body = [](uint64_t iterations) {
+		static bool havePack = packAssets("benchmark.assetpack"); // from the same files - needs the .lodmesh files in the asset directory
+		if (!havePack)
+			return;
+		std::vector<std::string> names = assetFileNames();
+		size_t bytes = 0;
+		for (uint64_t i = 0; i < iterations; i++)
+		{
+			AssetPack pack;
+			pack.open("benchmark.assetpack");
+			for (const std::string &name : names)
+			{
+				AssetBlob blob;
+				if (!pack.find(name, blob))
+					continue;
+				for (size_t offset = 0; offset < blob.size; offset += 4096)
+					bytes += uint8_t(blob.data[offset]); // fault every page in, as uploading it would
+			}
+		}
+		doNotOptimize(bytes);
+	};
+	benchmarks.push_back(packed);
+}
+// end::assetBenchmarks[]
+
+// tag::offscreenFrames[]
+//a hidden window gives us a GL context; frames are drawn into a framebuffer object the same size as the game window
+SDL_Window *benchWindow = nullptr;
+SDL_GLContext benchContext = nullptr;
+GLuint offscreenFramebuffer = 0;
+GLuint offscreenRenderbuffers[2] = { 0, 0 };
+
+static bool createOffscreenTarget()
+{
+	if (SDL_Init(SDL_INIT_VIDEO) != 0)
+	{
+		cerr << "SDL_Init Error: " << SDL_GetError() << " - skipping frame benchmarks" << endl;
+		return false;
+	}
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+
+	benchWindow = SDL_CreateWindow("benchmarks", 0, 0, 1000, 700, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+	benchContext = benchWindow ? SDL_GL_CreateContext(benchWindow) : nullptr;
+	if (benchContext == nullptr)
+	{
+		cerr << "Could not create a GL context: " << SDL_GetError() << " - skipping frame benchmarks" << endl;
+		return false;
+	}
+	glewExperimental = GL_TRUE;
+	if (glewInit() != GLEW_OK)
+	{
+		cerr << "GLEW Error - skipping frame benchmarks" << endl;
+		return false;
+	}
+	SDL_GL_SetSwapInterval(0);
+
+	glGenRenderbuffers(2, offscreenRenderbuffers);
+	glBindRenderbuffer(GL_RENDERBUFFER, offscreenRenderbuffers[0]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, 1000, 700);
+	glBindRenderbuffer(GL_RENDERBUFFER, offscreenRenderbuffers[1]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 1000, 700);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &offscreenFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, offscreenFramebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, offscreenRenderbuffers[0]);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, offscreenRenderbuffers[1]);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		cerr << "Offscreen framebuffer incomplete - skipping frame benchmarks" << endl;
+		return false;
+	}
+
+	loadAssets();
+	setOutputFramebuffer(offscreenFramebuffer); // present into our framebuffer rather than the hidden window's
+	setRenderScale(1.0f); // dynamic resolution would change the work between samples
+
+	//let any streamed meshes finish uploading, so every sample draws the same geometry
+	for (int i = 0; i < 200; i++)
+	{
+		preRender();
+		SDL_Delay(5);
+	}
+	glFinish();
+	return true;
+}
+
+static void destroyOffscreenTarget()
+{
+	if (benchContext != nullptr)
+	{
+		unloadAssets();
+		gpuResources.reportLeaks();
+		glDeleteFramebuffers(1, &offscreenFramebuffer);
+		glDeleteRenderbuffers(2, offscreenRenderbuffers);
+		SDL_GL_DeleteContext(benchContext);
+	}
+	if (benchWindow != nullptr)
+		SDL_DestroyWindow(benchWindow);
+	SDL_Quit();
+}
+
+static void addFrameBenchmarks(std::vector<Benchmark> &benchmarks)
+{
+	//a mid-rally state, with a couple of points on the board so the score is drawn too
+	GameState state = newGame();
+	state.position1.x = -1.0f;
+	state.position2.x = 0.5f;
+	state.ballPosition = glm::vec3(0.7f, 0.0f, 1.2f);
+	state.redScore = 2;
+	state.blueScore = 3;
+
+	for (int camView = 1; camView <= 5; camView += 4)
+	{
+		Benchmark frame;
+		frame.name = "frame/offscreenCamera" + std::to_string(camView);
+		frame.kind = "macro";
+		frame.needsGL = true;
+		frame.body = [state, camView](uint64_t iterations) {
+			for (uint64_t i = 0; i < iterations; i++)
+			{
+				preRender();
+				render(state, camView);
+				glFinish(); //wait for the GPU, so the time covers the whole frame, not just submission
+			}
+		};
+		benchmarks.push_back(frame);
+	}
+
+	//the scene at half the width and height, stretched to the full size
+	Benchmark halfScale;
+	halfScale.name = "frame/offscreenCamera1Scale50";
+	halfScale.kind = "macro";
+	halfScale.needsGL = true;
+	halfScale.body = [state](uint64_t iterations) {
+		setRenderScale(0.5f);
+		for (uint64_t i = 0; i < iterations; i++)
+		{
+			preRender();
+			render(state, 1);
+			glFinish();
+		}
+		setRenderScale(1.0f);
+	};
+	benchmarks.push_back(halfScale);
+
+	//a whole pool of live sparks - each frame replaces the oldest few thousand, so the pool stays full
+	Benchmark sparks;
+	sparks.name = "frame/particles" + std::to_string(ParticleSystem::maxParticles);
+	sparks.kind = "macro";
+	sparks.needsGL = true;
+	sparks.body = [state](uint64_t iterations) {
+		emitParticles(glm::vec3(0.0f, 0.0f, 2.3f), glm::vec3(0.0f, 0.0f, -1.0f), ParticleSystem::maxParticles);
+		for (uint64_t i = 0; i < iterations; i++)
+		{
+			emitParticles(glm::vec3(2.4f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f), 4096);
+			preRender();
+			render(state, 1);
+			glFinish();
+		}
+	};
+	benchmarks.push_back(sparks);
+
+	//frame time against the number of lights, with and without clustering - run under llvmpipe
+	//(LIBGL_ALWAYS_SOFTWARE=1) the fragment shading cost shows up directly in the time
+	//the floodlights and the ball's glow are always there, on top of the display lights
+	const int displayLightCounts[] = { 0, 16, 64, 256, 1000 };
+	for (int count : displayLightCounts)
+	{
+		for (int clustered = 1; clustered >= 0; clustered--)
+		{
+			Benchmark lights;
+			lights.name = "frame/displayLights" + std::to_string(count) + (clustered ? "" : "Unclustered");
+			lights.kind = "macro";
+			lights.needsGL = true;
+			lights.body = [state, count, clustered](uint64_t iterations) {
+				setDisplayLightCount(count);
+				setLightClustering(clustered != 0);
+				for (uint64_t i = 0; i < iterations; i++)
+				{
+					preRender();
+					render(state, 1);
+					glFinish();
+				}
+				setDisplayLightCount(64); // back to the game's defaults, for the other benchmarks
+				setLightClustering(true);
+			};
+			benchmarks.push_back(lights);
+		}
+	}
+}
+// end::offscreenFrames[]
+
+// tag::sceneBenchmarks[]
+//a scene file change, applied as the game does it - only the walls that changed, against every wall built
+//again, which is what reloading the whole scene would cost. The scene is a court with a grid of extra walls,
+//so there is something to skip
+static Scene wallGridScene(float width)
+{
+	Scene scene = defaultScene();
+	for (int row = 0; row < 6; row++)
+	{
+		for (int column = 0; column < 8; column++)
+		{
+			SceneWall wall;
+			wall.name = "block" + std::to_string(row) + "_" + std::to_string(column);
+			wall.position = glm::vec2(-1.75f + column * 0.5f, -2.5f + row * 1.0f);
+			wall.size = glm::vec2(width, 0.1f);
+			scene.walls.push_back(wall);
+		}
+	}
+	return scene;
+}
+
+static void addSceneBenchmarks(std::vector<Benchmark> &benchmarks)
+{
+	Benchmark parse;
+	parse.name = "scene/parseAndDiff";
+	parse.kind = "micro";
+	parse.body = [](uint64_t iterations) {
+		std::ifstream fileStream(assetDirectory + "court.scene", std::ios::in | std::ios::binary);
+		std::string text((std::istreambuf_iterator<char>(fileStream)), std::istreambuf_iterator<char>());
+		Scene current = defaultScene();
+		size_t changes = 0;
+		for (uint64_t i = 0; i < iterations; i++)
+		{
+			Scene parsed = current;
+			parseScene(text, "court.scene", parsed);
+			changes += diffScenes(current, parsed).walls.size();
+		}
+		doNotOptimize(changes);
+	};
+	benchmarks.push_back(parse);
+
+	for (int everyWall = 0; everyWall <= 1; everyWall++)
+	{
+		Benchmark apply;
+		apply.name = everyWall ? "scene/applyEveryWall" : "scene/applyOneWall";
+		apply.kind = "macro";
+		apply.needsGL = true;
+		apply.body = [everyWall](uint64_t iterations) {
+			Scene scenes[2] = { wallGridScene(0.2f), wallGridScene(everyWall ? 0.3f : 0.2f) };
+			scenes[1].walls[10].size.x = 0.3f;
+			applyScene(scenes[0]);
+			for (uint64_t i = 0; i < iterations; i++)
+				applyScene(scenes[(i + 1) & 1]); // reshaped, so the changed walls are built and uploaded again
+			glFinish();
+			applyScene(defaultScene()); // back to the game's court, for the other benchmarks
+		};
+		benchmarks.push_back(apply);
+	}
+}
+// end::sceneBenchmarks[]
+
+// tag::arenaBenchmarks[]
+//one tick of a whole arena, on the CPU reference and on the GPU - under llvmpipe the "GPU" is the CPU too,
+//so only a real GPU shows what keeping the courts there is worth
+static void addArenaBenchmarks(std::vector<Benchmark> &benchmarks)
+{
+	const int courtCount = 4096;
+
+	Benchmark cpu;
+	cpu.name = "arena/cpuStep" + std::to_string(courtCount);
+	cpu.kind = "macro";
+	cpu.body = [courtCount](uint64_t iterations) {
+		static std::vector<GameState> states; // made on first use, so only the ticks are timed - then carries on like the GPU one
+		static std::vector<BatAi> ais;
+		if (states.empty())
+		{
+			states.assign(courtCount, newGame());
+			ais.resize(courtCount);
+			for (int court = 0; court < courtCount; court++)
+				ais[court] = newBatAi(arenaCourtSeed(court));
+		}
+		for (uint64_t i = 0; i < iterations; i++)
+		{
+			for (int court = 0; court < courtCount; court++)
+				stepArenaCourt(states[court], ais[court]);
+		}
+		doNotOptimize(states[0]);
+	};
+	benchmarks.push_back(cpu);
+
+	Benchmark gpu;
+	gpu.name = "arena/gpuStep" + std::to_string(courtCount);
+	gpu.kind = "macro";
+	gpu.needsGL = true;
+	gpu.body = [courtCount](uint64_t iterations) {
+		static GpuArena arena; // loaded on first use, and left for the GL context to clean up
+		if (!arena.loaded() && !arena.load((assetDirectory + "arenaUpdateShader.glsl").c_str(), (assetDirectory + "arenaVertexShader.glsl").c_str(), (assetDirectory + "arenaFragmentShader.glsl").c_str()))
+			return;
+		if (arena.courts() != courtCount)
+			arena.reset(courtCount); // then carries on from wherever the last sample left the courts
+		arena.step(int(iterations));
+		glFinish();
+	};
+	benchmarks.push_back(gpu);
+
+	//a frame with the arena behind the main court - the courts are stepped at the game's tick rate, so the time includes a tick most frames
+	GameState state = newGame();
+	Benchmark frame;
+	frame.name = "frame/offscreenCamera1Arena" + std::to_string(courtCount);
+	frame.kind = "macro";
+	frame.needsGL = true;
+	frame.body = [state, courtCount](uint64_t iterations) {
+		setArenaCourts(courtCount);
+		for (uint64_t i = 0; i < iterations; i++)
+		{
+			preRender();
+			render(state, 1);
+			glFinish();
+		}
+		setArenaCourts(0);
+	};
+	benchmarks.push_back(frame);
+}
+// end::arenaBenchmarks[]
+
+// tag::envBenchmarks[]
+//an env and the buffers it steps into
+struct EnvBatch
+{
+	CourtEnv *env; // left for the process to clean up, like the GPU arena
+	std::vector<float> observations;
+	std::vector<float> rewards;
+	std::vector<uint8_t> dones;
+};
+
+//one step of a batch of training courts through the C interface - steps per second is courtCount / the time
+//per iteration. The actions, the env and its buffers are made on first use, so only the step itself is timed.
+static void addEnvBenchmarks(std::vector<Benchmark> &benchmarks)
+{
+	const int courtCount = 4096;
+	const int actionSets = 64;
+
+	for (int bats = 1; bats <= 2; bats++)
+	{
+		Benchmark step;
+		step.name = string(bats == 1 ? "env/stepAgainstAi" : "env/stepSelfPlay") + std::to_string(courtCount);
+		step.kind = "macro";
+		step.body = [courtCount, actionSets, bats](uint64_t iterations) {
+			static std::vector<int32_t> actions;
+			if (actions.empty())
+			{
+				uint32_t randomState = 12345;
+				actions.resize(size_t(actionSets) * courtCount * 2);
+				for (size_t i = 0; i < actions.size(); i++)
+				{
+					randomState = randomState * 1664525u + 1013904223u;
+					actions[i] = int32_t(randomState >> 30) - 1; // -1, 0, 1 or 2 - anything over 0 is right
+				}
+			}
+			static EnvBatch batches[2]; // one for each bat count - both benchmarks share this lambda's statics
+			EnvBatch &batch = batches[bats - 1];
+			if (batch.env == nullptr)
+			{
+				batch.observations.resize(size_t(courtCount) * COURT_ENV_OBSERVATION_SIZE);
+				batch.rewards.resize(size_t(courtCount) * bats);
+				batch.dones.resize(courtCount);
+				batch.env = courtEnvCreate(bats, 12345, 10000);
+				courtEnvReset(batch.env, courtCount, batch.observations.data());
+			}
+			for (uint64_t i = 0; i < iterations; i++)
+				courtEnvStep(batch.env, &actions[size_t(i % actionSets) * courtCount * bats], batch.observations.data(), batch.rewards.data(), batch.dones.data());
+			doNotOptimize(batch.observations[0]);
+		};
+		benchmarks.push_back(step);
+	}
+}
+// end::envBenchmarks[]
+
+static void printUsage()
+{
+	cout << "benchmarks [options]\n"
+		<< "  --samples N       samples per benchmark (default 30)\n"
+		<< "  --min-time S      minimum seconds per sample (default 0.02)\n"
+		<< "  --filter TEXT     only run benchmarks whose name contains TEXT\n"
+		<< "  --output FILE     where to write the JSON results (default benchmark_results.json)\n"
+		<< "  --baseline FILE   compare against earlier results, exit 1 on regression\n"
+		<< "  --threshold F     allowed slowdown of the median, as a fraction (default 0.10)\n"
+		<< "  --assets DIR      where to find the shaders and meshes (default ../src/3D_matrices/)\n"
+		<< "  --no-gl           skip the benchmarks that need a GL context\n"
+		<< "  --list            list the benchmarks and exit\n";
+}
+
+// tag::benchmarkMain[]
+int main(int argc, char *args[])
+{
+	BenchmarkOptions options = defaultBenchmarkOptions();
+	bool useGL = true;
+	bool listOnly = false;
+	assetDirectory = "../src/3D_matrices/";
+
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = args[i];
+		bool hasValue = (i + 1 < argc);
+		if (arg == "--samples" && hasValue)
+			options.samples = std::max(1, atoi(args[++i]));
+		else if (arg == "--min-time" && hasValue)
+			options.minSampleSeconds = atof(args[++i]);
+		else if (arg == "--filter" && hasValue)
+			options.filter = args[++i];
+		else if (arg == "--output" && hasValue)
+			options.outputPath = args[++i];
+		else if (arg == "--baseline" && hasValue)
+			options.baselinePath = args[++i];
+		else if (arg == "--threshold" && hasValue)
+			options.threshold = atof(args[++i]);
+		else if (arg == "--assets" && hasValue)
+			assetDirectory = args[++i];
+		else if (arg == "--no-gl")
+			useGL = false;
+		else if (arg == "--list")
+			listOnly = true;
+		else
+		{
+			printUsage();
+			return (arg == "--help") ? 0 : 1;
+		}
+	}
+
+	std::vector<Benchmark> benchmarks;
+	addSimulationBenchmarks(benchmarks);
+	addMatrixBenchmarks(benchmarks);
+	addMeshBenchmarks(benchmarks);
+	addAssetBenchmarks(benchmarks);
+	addLightBenchmarks(benchmarks);
+	addRenderQueueBenchmarks(benchmarks);
+	addFrameBenchmarks(benchmarks);
+	addSceneBenchmarks(benchmarks);
+	addArenaBenchmarks(benchmarks);
+	addEnvBenchmarks(benchmarks);
+
+	std::vector<Benchmark> selected;
+	bool needsGL = false;
+	for (size_t i = 0; i < benchmarks.size(); i++)
+	{
+		if (!options.filter.empty() && benchmarks[i].name.find(options.filter) == string::npos)
+			continue;
+		if (listOnly)
+			cout << benchmarks[i].kind << "\t" << benchmarks[i].name << endl;
+		selected.push_back(benchmarks[i]);
+		needsGL = needsGL || benchmarks[i].needsGL;
+	}
+	if (listOnly)
+		return 0;
+
+	bool haveGL = needsGL && useGL && createOffscreenTarget();
+
+	std::vector<BenchmarkResult> results;
+	for (size_t i = 0; i < selected.size(); i++)
+	{
+		if (selected[i].needsGL && !haveGL)
+			continue;
+
+		BenchmarkResult result = runBenchmark(selected[i], options);
+		cout << result.name << ": median " << result.median << " ns, stddev " << result.stddev << " ns (" << result.iterationsPerSample << " iterations x " << options.samples << " samples)" << endl;
+		results.push_back(result);
+	}
+
+	if (needsGL && useGL)
+		destroyOffscreenTarget();
+
+	if (!writeBenchmarkJson(options.outputPath, results, options))
+		return 1;
+	if (!options.baselinePath.empty() && !compareWithBaseline(options.baselinePath, results, options.threshold))
+		return 1;
+	return 0;
+}
+// end::benchmarkMain[]
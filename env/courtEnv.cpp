@@ -0,0 +1,148 @@
+#include "courtEnv.h"
+
+#include <vector>
+#include <new>
+
+#include "game.h"
+#include "headlessMatch.h"
+
+//the same as the game - its fixed tick, and how fast the keys move a bat
+const double envTickLength = 0.02;
+const float envBatSpeed = 3.0f;
+
+struct CourtEnv
+{
+	int controlledBats;
+	uint32_t seed;
+	uint32_t maxMatchTicks;
+	uint64_t matchesStarted; // every match gets its own AI seed, so the opponent doesn't play the same match over and over
+	uint64_t matchesPlayed;
+
+	//one of each per court - sized by reset, and never touched by the allocator in step
+	std::vector<GameState> states;
+	std::vector<BatAi> ais;
+	std::vector<uint32_t> matchTicks;
+};
+
+static void startMatch(CourtEnv &env, int court)
+{
+	env.states[court] = newGame();
+	env.ais[court] = newBatAi(env.seed + uint32_t(env.matchesStarted++) * 2654435761u);
+	env.matchTicks[court] = 0;
+}
+
+static void writeObservation(const GameState &state, float *observation)
+{
+	observation[COURT_ENV_BALL_X] = state.ballPosition.x;
+	observation[COURT_ENV_BALL_Z] = state.ballPosition.z;
+	observation[COURT_ENV_BALL_VELOCITY_X] = state.ballVelocity.x;
+	observation[COURT_ENV_BALL_VELOCITY_Z] = state.ballVelocity.z;
+	observation[COURT_ENV_RED_BAT_X] = state.position1.x;
+	observation[COURT_ENV_RED_BAT_VELOCITY_X] = state.velocity1.x;
+	observation[COURT_ENV_BLUE_BAT_X] = state.position2.x;
+	observation[COURT_ENV_BLUE_BAT_VELOCITY_X] = state.velocity2.x;
+}
+
+static float batVelocity(int32_t action)
+{
+	return (action > 0) ? envBatSpeed : ((action < 0) ? -envBatSpeed : 0.0f);
+}
+
+CourtEnv *courtEnvCreate(int controlledBats, uint32_t seed, uint32_t maxMatchTicks)
+{
+	if (controlledBats != 1 && controlledBats != 2)
+		return nullptr;
+	CourtEnv *env = new (std::nothrow) CourtEnv;
+	if (env == nullptr)
+		return nullptr;
+	env->controlledBats = controlledBats;
+	env->seed = seed;
+	env->maxMatchTicks = maxMatchTicks;
+	env->matchesStarted = 0;
+	env->matchesPlayed = 0;
+	return env;
+}
+
+void courtEnvDestroy(CourtEnv *env)
+{
+	delete env;
+}
+
+int courtEnvReset(CourtEnv *env, int envCount, float *observations)
+{
+	if (env == nullptr || envCount <= 0 || observations == nullptr)
+		return 0;
+	//nothing may throw across the C interface
+	try
+	{
+		env->states.resize(envCount);
+		env->ais.resize(envCount);
+		env->matchTicks.resize(envCount);
+	}
+	catch (const std::bad_alloc &)
+	{
+		env->states.clear();
+		env->ais.clear();
+		env->matchTicks.clear();
+		return 0;
+	}
+	env->matchesStarted = 0;
+	env->matchesPlayed = 0;
+	for (int court = 0; court < envCount; court++)
+	{
+		startMatch(*env, court);
+		writeObservation(env->states[court], observations + court * COURT_ENV_OBSERVATION_SIZE);
+	}
+	return 1;
+}
+
+// tag::courtEnvStep[]
+int courtEnvStep(CourtEnv *env, const int32_t *actions, float *observations, float *rewards, uint8_t *dones)
+{
+	if (env == nullptr || env->states.empty() || actions == nullptr || observations == nullptr || rewards == nullptr || dones == nullptr)
+		return 0;
+	const int courts = int(env->states.size());
+	const int bats = env->controlledBats;
+	for (int court = 0; court < courts; court++)
+	{
+		GameState &state = env->states[court];
+		if (bats == 1)
+			steerBats(state, env->ais[court]); // the AI plays blue - its choice for red is overwritten below
+		state.velocity1.x = batVelocity(actions[court * bats]);
+		if (bats == 2)
+			state.velocity2.x = batVelocity(actions[court * bats + 1]);
+
+		unsigned int redScore = state.redScore;
+		unsigned int blueScore = state.blueScore;
+		updateSimulation(state, envTickLength);
+		float redReward = float(int(state.redScore - redScore) - int(state.blueScore - blueScore));
+		rewards[court * bats] = redReward;
+		if (bats == 2)
+			rewards[court * bats + 1] = -redReward;
+
+		uint8_t done = COURT_ENV_PLAYING;
+		if (state.gameOver)
+			done = COURT_ENV_MATCH_OVER;
+		else if (env->maxMatchTicks != 0 && ++env->matchTicks[court] >= env->maxMatchTicks)
+			done = COURT_ENV_TRUNCATED;
+		if (done != COURT_ENV_PLAYING)
+		{
+			env->matchesPlayed++;
+			startMatch(*env, court); // auto-reset, so the batch never has a finished court in it
+		}
+		dones[court] = done;
+		writeObservation(state, observations + court * COURT_ENV_OBSERVATION_SIZE);
+	}
+	return 1;
+}
+// end::courtEnvStep[]
+
+int courtEnvCount(const CourtEnv *env)
+{
+	return (env == nullptr) ? 0 : int(env->states.size());
+}
+
+uint64_t courtEnvMatchesPlayed(const CourtEnv *env)
+{
+	return (env == nullptr) ? 0 : env->matchesPlayed;
+}
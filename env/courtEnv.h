@@ -0,0 +1,76 @@
+#pragma once
+
+/* A C interface to the game's simulation, for training bat controllers - see env/README.asciidoc.
+ * Plain C, so it can be loaded from Python with ctypes (or cffi) without any binding code. */
+
+#include <stdint.h>
+
+#ifdef _WIN32
+	#ifdef COURT_ENV_BUILD
+		#define COURT_ENV_API __declspec(dllexport)
+	#else
+		#define COURT_ENV_API __declspec(dllimport)
+	#endif
+#else
+	#define COURT_ENV_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* tag::courtEnvLayout[] */
+/* One observation is COURT_ENV_OBSERVATION_SIZE floats, in this order. The court is 5 wide (x, -2.5 to 2.5)
+ * and 6 long (z, -3 to 3); the red bat defends z = -3 and the blue bat z = 3. */
+enum CourtEnvObservation
+{
+	COURT_ENV_BALL_X,
+	COURT_ENV_BALL_Z,
+	COURT_ENV_BALL_VELOCITY_X,
+	COURT_ENV_BALL_VELOCITY_Z,
+	COURT_ENV_RED_BAT_X,
+	COURT_ENV_RED_BAT_VELOCITY_X,
+	COURT_ENV_BLUE_BAT_X,
+	COURT_ENV_BLUE_BAT_VELOCITY_X,
+	COURT_ENV_OBSERVATION_SIZE
+};
+
+/* what a done flag says happened on that step - the court has already started its next match either way */
+enum CourtEnvDone
+{
+	COURT_ENV_PLAYING = 0,
+	COURT_ENV_MATCH_OVER = 1, /* one side reached 5 points */
+	COURT_ENV_TRUNCATED = 2 /* the match reached maxMatchTicks first */
+};
+/* end::courtEnvLayout[] */
+
+/* tag::courtEnvApi[] */
+typedef struct CourtEnv CourtEnv;
+
+/* controlledBats is 1 - the actions move the red bat, and the blue bat is played by the headless matches' AI -
+ * or 2, where the actions move both bats (self-play). maxMatchTicks (0 for no limit) cuts off a match whose
+ * rally never ends. Returns null if an argument is out of range. */
+COURT_ENV_API CourtEnv *courtEnvCreate(int controlledBats, uint32_t seed, uint32_t maxMatchTicks);
+COURT_ENV_API void courtEnvDestroy(CourtEnv *env);
+
+/* Starts envCount courts at the start of a match, and writes their first observations into
+ * observations[envCount * COURT_ENV_OBSERVATION_SIZE]. The only call that allocates - returns 0 on failure. */
+COURT_ENV_API int courtEnvReset(CourtEnv *env, int envCount, float *observations);
+
+/* Advances every court by one tick (0.02 seconds). All of the buffers belong to the caller, and are only used
+ * during the call:
+ *   actions[envCount * controlledBats]                    -1 moves a bat left, 1 right, 0 stops it - red first, then blue
+ *   observations[envCount * COURT_ENV_OBSERVATION_SIZE]   after the tick
+ *   rewards[envCount * controlledBats]                    1 for a point won on this tick, -1 for a point lost, else 0
+ *   dones[envCount]                                       a CourtEnvDone
+ * A court whose match ends is reset straight away, so its observation is the first of the next match.
+ * Returns 0, and changes nothing, if reset hasn't been called yet or any of the buffers is null. */
+COURT_ENV_API int courtEnvStep(CourtEnv *env, const int32_t *actions, float *observations, float *rewards, uint8_t *dones);
+
+COURT_ENV_API int courtEnvCount(const CourtEnv *env);
+COURT_ENV_API uint64_t courtEnvMatchesPlayed(const CourtEnv *env); /* matches finished or truncated since reset */
+/* end::courtEnvApi[] */
+
+#ifdef __cplusplus
+}
+#endif
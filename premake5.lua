@@ -1,4 +1,99 @@
 
+-- build with `premake5 --alloc-tracking <action>` to count heap allocations in the frame loop (see allocTracker.h)
+newoption {
+   trigger = "alloc-tracking",
+   description = "Hook operator new and malloc to count allocations per phase of the main loop"
+}
+
+-- compiler flags, header paths and configurations - everything a project needs apart from the libraries
+function buildSettings()
+   configuration { "windows" }
+      buildoptions ""
+      linkoptions { "/NODEFAULTLIB:msvcrt" } -- https://github.com/yuriks/robotic/blob/master/premake5.lua
+   configuration { "linux" }
+      buildoptions "-std=c++11" --http://industriousone.com/topic/xcode4-c11-build-option
+      toolset "gcc"
+   configuration {}
+
+
+   -- where are header files?
+   -- tag::headers[]
+   configuration "windows"
+   includedirs {
+                 "./graphics_dependencies/SDL2/include",
+                 "./graphics_dependencies/glew/include",
+                 "./graphics_dependencies/glm",
+                 "./graphics_dependencies/SDL2_image/include",
+
+               }
+   configuration { "linux" }
+   includedirs {
+            -- should be installed as in ./graphics_dependencies/README.asciidoc
+               }
+   configuration {}
+   -- end::headers[]
+
+   if _OPTIONS["alloc-tracking"] then
+      defines { "ALLOC_TRACKING" }
+   end
+
+   configuration "*Debug"
+      defines { "DEBUG" }
+      flags { "Symbols" }
+      optimize "Off"
+      targetsuffix "-debug"
+
+
+   configuration "*Release"
+      defines { "NDEBUG" }
+      optimize "On"
+      targetsuffix "-release"
+
+   configuration {}
+end
+
+-- settings shared by every project that opens a window: compiler flags, dependencies and configurations
+function commonSettings(projectName)
+   buildSettings()
+
+   -- what libraries need linking to
+   -- tag::libraries[]
+   configuration "windows"
+      links { "SDL2", "SDL2main", "opengl32", "glew32", "SDL2_image", "ws2_32" }
+   configuration "linux"
+      links { "SDL2", "SDL2main", "GL", "GLEW", "SDL2_image", "pthread" }
+   configuration {}
+   -- end::libraries[]
+
+   -- where are libraries?
+   -- tag::librariesDirs[]
+   configuration "windows"
+   libdirs {
+             "./graphics_dependencies/glew/lib/Release/Win32",
+             "./graphics_dependencies/SDL2/lib/win32",
+             "./graphics_dependencies/SDL2_image/lib/x86/",
+           }
+   configuration "linux"
+            -- should be installed as in ./graphics_dependencies/README.asciidoc
+   configuration {}
+   -- end::librariesDirs[]
+
+
+   -- copy dlls on windows
+   -- tag::windowsDLLCopy[]
+   if os.get() == "windows" then
+      os.copyfile("./graphics_dependencies/glew/bin/Release/Win32/glew32.dll", path.join(projectName, "glew32.dll"))
+      os.copyfile("./graphics_dependencies/SDL2/lib/win32/SDL2.dll", path.join(projectName, "SDL2.dll"))
+      os.copyfile("./graphics_dependencies/SDL2_image/lib/x86/SDL2_image.dll", path.join(projectName, "SDL2_image.dll"))
+      os.copyfile("./graphics_dependencies/SDL2_image/lib/x86/libjpeg-9.dll", path.join(projectName, "libjpeg-9.dll"))
+      os.copyfile("./graphics_dependencies/SDL2_image/lib/x86/libpng16-16.dll", path.join(projectName, "libpng16-16.dll"))
+      os.copyfile("./graphics_dependencies/SDL2_image/lib/x86/libtiff-5.dll", path.join(projectName, "libtiff-5.dll"))
+      os.copyfile("./graphics_dependencies/SDL2_image/lib/x86/libwebp-4.dll", path.join(projectName, "libwebp-4.dll"))
+      os.copyfile("./graphics_dependencies/SDL2_image/lib/x86/zlib1.dll", path.join(projectName, "zlib1.dll"))
+   end
+   -- end::windowsDLLCopy[]
+end
+
 -- A solution contains projects, and defines the available configurations
 solution "graphicsByExample"
    configurations { "Debug", "Release"}
@@ -16,83 +111,44 @@ solution "graphicsByExample"
           language "C++"
           targetdir ( projectName )
 
-          configuration { "windows" }
-             buildoptions ""
-             linkoptions { "/NODEFAULTLIB:msvcrt" } -- https://github.com/yuriks/robotic/blob/master/premake5.lua
-          configuration { "linux" }
-             buildoptions "-std=c++11" --http://industriousone.com/topic/xcode4-c11-build-option
-             toolset "gcc"
-          configuration {}
-
           files { path.join(projectName, "**.h"), path.join(projectName, "**.cpp") } -- build all .h and .cpp files recursively
           excludes { "./graphics_dependencies/**" }  -- don't build files in graphics_dependencies/
 
-
-          -- where are header files?
-          -- tag::headers[]
-          configuration "windows"
-          includedirs {
-                        "./graphics_dependencies/SDL2/include",
-                        "./graphics_dependencies/glew/include",
-                        "./graphics_dependencies/glm",
-                        "./graphics_dependencies/SDL2_image/include",
-
-                      }
-          configuration { "linux" }
-          includedirs {
-                   -- should be installed as in ./graphics_dependencies/README.asciidoc
-                      }
-          configuration {}
-          -- end::headers[]
-
-
-          -- what libraries need linking to
-          -- tag::libraries[]
-          configuration "windows"
-             links { "SDL2", "SDL2main", "opengl32", "glew32", "SDL2_image" }
-          configuration "linux"
-             links { "SDL2", "SDL2main", "GL", "GLEW", "SDL2_image" }
-          configuration {}
-          -- end::libraries[]
-
-          -- where are libraries?
-          -- tag::librariesDirs[]
-          configuration "windows"
-          libdirs {
-                    "./graphics_dependencies/glew/lib/Release/Win32",
-                    "./graphics_dependencies/SDL2/lib/win32",
-                    "./graphics_dependencies/SDL2_image/lib/x86/",
-                  }
-          configuration "linux"
-                   -- should be installed as in ./graphics_dependencies/README.asciidoc
-          configuration {}
-          -- end::librariesDirs[]
-
-
-          configuration "*Debug"
-             defines { "DEBUG" }
-             flags { "Symbols" }
-             optimize "Off"
-             targetsuffix "-debug"
-
-
-          configuration "*Release"
-             defines { "NDEBUG" }
-             optimize "On"
-             targetsuffix "-release"
-
-
-          -- copy dlls on windows
-          -- tag::windowsDLLCopy[]
-          if os.get() == "windows" then
-             os.copyfile("./graphics_dependencies/glew/bin/Release/Win32/glew32.dll", path.join(projectName, "glew32.dll"))
-             os.copyfile("./graphics_dependencies/SDL2/lib/win32/SDL2.dll", path.join(projectName, "SDL2.dll"))
-             os.copyfile("./graphics_dependencies/SDL2_image/lib/x86/SDL2_image.dll", path.join(projectName, "SDL2_image.dll"))
-             os.copyfile("./graphics_dependencies/SDL2_image/lib/x86/libjpeg-9.dll", path.join(projectName, "libjpeg-9.dll"))
-             os.copyfile("./graphics_dependencies/SDL2_image/lib/x86/libpng16-16.dll", path.join(projectName, "libpng16-16.dll"))
-             os.copyfile("./graphics_dependencies/SDL2_image/lib/x86/libtiff-5.dll", path.join(projectName, "libtiff-5.dll"))
-             os.copyfile("./graphics_dependencies/SDL2_image/lib/x86/libwebp-4.dll", path.join(projectName, "libwebp-4.dll"))
-             os.copyfile("./graphics_dependencies/SDL2_image/lib/x86/zlib1.dll", path.join(projectName, "zlib1.dll"))
-          end
-          -- end::windowsDLLCopy[]
+          commonSettings(projectName)
    end
+
+   -- micro and macro benchmarks for the 3D_matrices example - see bench/README.asciidoc
+   -- builds the example's sources without its main.cpp, plus the harness in bench/
+   project "benchmarks"
+      kind "ConsoleApp"
+      location "bench"
+      language "C++"
+      targetdir "bench"
+
+      files { "bench/**.h", "bench/**.cpp", "src/3D_matrices/**.h", "src/3D_matrices/**.cpp", "env/**.h", "env/**.cpp" }
+      excludes { "src/3D_matrices/main.cpp" }
+      includedirs { "src/3D_matrices", "env" }
+      defines { "COURT_ENV_BUILD" } -- courtEnv is built in, not imported from the library
+
+      commonSettings("bench")
+
+   -- the 3D_matrices simulation as a shared library with a C interface, for training bat controllers - see env/README.asciidoc
+   -- only the simulation is built in, so it needs no window, GL or SDL
+   project "courtEnv"
+      kind "SharedLib"
+      location "env"
+      language "C++"
+      targetdir "env"
+
+      files { "env/**.h", "env/**.cpp",
+              "src/3D_matrices/game.h", "src/3D_matrices/game.cpp",
+              "src/3D_matrices/headlessMatch.h", "src/3D_matrices/headlessMatch.cpp",
+              "src/3D_matrices/matchEvents.h", "src/3D_matrices/matchEvents.cpp" }
+      includedirs { "src/3D_matrices" }
+      defines { "COURT_ENV_BUILD" }
+
+      buildSettings()
+      configuration "linux"
+         buildoptions "-fvisibility=hidden" -- only the COURT_ENV_API functions are exported
+         links { "pthread" } -- simulateMatches, in headlessMatch.cpp, starts threads
+      configuration {}
@@ -0,0 +1,179 @@
+#include "allocTracker.h"
+
+#include <iostream>
+#include <cstdlib>
+#include <new>
+#include <atomic>
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+	#include <crtdbg.h>
+#endif
+
+using std::cout;
+using std::endl;
+
+//several threads are tracked (the main thread and the simulation thread), so the counts are atomic and each thread has its own phase
+struct AtomicAllocationCounts
+{
+	std::atomic<uint64_t> newCount;
+	std::atomic<uint64_t> mallocCount;
+	std::atomic<uint64_t> bytes;
+};
+
+static AtomicAllocationCounts phaseCounts[ALLOCATION_PHASE_COUNT];
+static thread_local AllocationPhase currentPhase = ALLOCATION_PHASE_SETUP;
+static thread_local bool trackedThread = false;
+
+static const char *phaseNames[ALLOCATION_PHASE_COUNT] = {
+	"setup", "handleInput", "updateSimulation", "preRender", "render", "postRender"
+};
+
+#ifdef ALLOC_TRACKING
+static inline void countNew(size_t size)
+{
+	if (!trackedThread)
+		return;
+	phaseCounts[currentPhase].newCount.fetch_add(1, std::memory_order_relaxed);
+	phaseCounts[currentPhase].bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+static inline void countMalloc()
+{
+	if (!trackedThread)
+		return;
+	phaseCounts[currentPhase].mallocCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+// tag::allocHooks[]
+void *operator new(std::size_t size)
+{
+	countNew(size);
+	void *memory = std::malloc(size ? size : 1);
+	if (memory == nullptr)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void *operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void *memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+	std::free(memory);
+}
+
+#if defined(__GLIBC__)
+//glibc exports its allocator under these names as well, so wrapping malloc and friends is safe
+extern "C" {
+	void *__libc_malloc(size_t size);
+	void *__libc_calloc(size_t count, size_t size);
+	void *__libc_realloc(void *memory, size_t size);
+	void __libc_free(void *memory);
+
+	void *malloc(size_t size)
+	{
+		countMalloc();
+		return __libc_malloc(size);
+	}
+
+	void *calloc(size_t count, size_t size)
+	{
+		countMalloc();
+		return __libc_calloc(count, size);
+	}
+
+	void *realloc(void *memory, size_t size)
+	{
+		countMalloc();
+		return __libc_realloc(memory, size);
+	}
+
+	void free(void *memory)
+	{
+		__libc_free(memory);
+	}
+}
+#elif defined(_MSC_VER) && defined(_DEBUG)
+static int allocHook(int allocType, void *, size_t, int blockType, long, const unsigned char *, int)
+{
+	if (blockType != _CRT_BLOCK && (allocType == _HOOK_ALLOC || allocType == _HOOK_REALLOC))
+		countMalloc();
+	return TRUE;
+}
+#endif
+// end::allocHooks[]
+#endif // ALLOC_TRACKING
+
+bool allocationTrackingEnabled()
+{
+#ifdef ALLOC_TRACKING
+	return true;
+#else
+	return false;
+#endif
+}
+
+void trackAllocationsOnThisThread()
+{
+	trackedThread = true;
+#if defined(ALLOC_TRACKING) && defined(_MSC_VER) && defined(_DEBUG)
+	_CrtSetAllocHook(allocHook);
+#endif
+}
+
+void setAllocationPhase(AllocationPhase phase)
+{
+	currentPhase = phase;
+}
+
+void resetAllocationCounts()
+{
+	for (int i = 0; i < ALLOCATION_PHASE_COUNT; i++)
+	{
+		phaseCounts[i].newCount.store(0, std::memory_order_relaxed);
+		phaseCounts[i].mallocCount.store(0, std::memory_order_relaxed);
+		phaseCounts[i].bytes.store(0, std::memory_order_relaxed);
+	}
+}
+
+AllocationCounts allocationCounts(AllocationPhase phase)
+{
+	AllocationCounts counts;
+	counts.newCount = phaseCounts[phase].newCount.load(std::memory_order_relaxed);
+	counts.mallocCount = phaseCounts[phase].mallocCount.load(std::memory_order_relaxed);
+	counts.bytes = phaseCounts[phase].bytes.load(std::memory_order_relaxed);
+	return counts;
+}
+
+const char *allocationPhaseName(AllocationPhase phase)
+{
+	return phaseNames[phase];
+}
+
+// tag::reportAllocations[]
+bool reportAllocations(uint64_t frames, bool strict)
+{
+	//copy first - printing may allocate
+	AllocationCounts counts[ALLOCATION_PHASE_COUNT];
+	for (int i = 0; i < ALLOCATION_PHASE_COUNT; i++)
+		counts[i] = allocationCounts(AllocationPhase(i));
+
+	bool clean = true;
+	cout << "\nHeap allocations over " << frames << " frames after warm-up:" << endl;
+	for (int i = ALLOCATION_PHASE_INPUT; i < ALLOCATION_PHASE_COUNT; i++)
+	{
+		cout << "  " << phaseNames[i] << ": " << counts[i].newCount << " new, " << counts[i].mallocCount << " malloc, " << counts[i].bytes << " bytes" << endl;
+		if (counts[i].newCount > 0 || (strict && counts[i].mallocCount > 0))
+			clean = false;
+	}
+	cout << (clean ? "Allocation check PASSED" : "Allocation check FAILED - the frame loop allocated after warm-up") << endl;
+	return clean;
+}
+// end::reportAllocations[]
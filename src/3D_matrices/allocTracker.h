@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// tag::allocTracker[]
+//Counts heap allocations made by the tracked threads, split by the phase of the frame loop they happen in.
+//
+//The hooks are only compiled in when ALLOC_TRACKING is defined (`premake5 --alloc-tracking <action>`):
+//  - global operator new / new[] are always replaced
+//  - with glibc, malloc/calloc/realloc are also wrapped, which catches allocations made inside SDL and the GL driver
+//  - with the MSVC debug CRT, a _CrtSetAllocHook does the same job
+//Each tracked thread has its own current phase - the simulation thread stays in ALLOCATION_PHASE_SIMULATION.
+//Without ALLOC_TRACKING, setAllocationPhase() is a plain store and the counts stay at zero.
+enum AllocationPhase
+{
+	ALLOCATION_PHASE_SETUP,
+	ALLOCATION_PHASE_INPUT,
+	ALLOCATION_PHASE_SIMULATION,
+	ALLOCATION_PHASE_PRE_RENDER,
+	ALLOCATION_PHASE_RENDER,
+	ALLOCATION_PHASE_POST_RENDER,
+	ALLOCATION_PHASE_COUNT
+};
+
+struct AllocationCounts
+{
+	uint64_t newCount; // operator new - allocations made by our own C++ code
+	uint64_t mallocCount; // every malloc/calloc/realloc, including those behind operator new
+	uint64_t bytes; // requested through operator new
+};
+
+bool allocationTrackingEnabled();
+void trackAllocationsOnThisThread(); // call from the main and simulation threads - allocations on other threads (e.g. mesh streaming) are not counted
+void setAllocationPhase(AllocationPhase phase); // for the calling thread
+void resetAllocationCounts();
+AllocationCounts allocationCounts(AllocationPhase phase);
+const char *allocationPhaseName(AllocationPhase phase);
+
+// print counts per phase, and return false if the steady state allocated
+// (operator new only, or any allocation at all when `strict`)
+bool reportAllocations(uint64_t frames, bool strict);
+// end::allocTracker[]
@@ -0,0 +1,14 @@
+#version 330
+// The arena's courts are small and far away, so one light overhead does - none of the main court's clustered lights
+in vec4 fragmentColor;
+in vec3 viewNormal;
+out vec4 outputColor;
+
+uniform mat4 viewMatrix;
+
+void main()
+{
+	vec3 lightDirection = normalize(mat3(viewMatrix) * vec3(0.3, 1.0, 0.5));
+	float diffuse = max(dot(normalize(viewNormal), lightDirection), 0.0);
+	outputColor = vec4(fragmentColor.rgb * (0.5 + 0.5 * diffuse), fragmentColor.a);
+}
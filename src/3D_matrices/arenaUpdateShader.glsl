@@ -0,0 +1,164 @@
+#version 400
+// One tick of one court of the arena - steerBats() (headlessMatch.cpp) then updateSimulation() (game.cpp),
+// rewritten in GLSL. There is no fragment shader - the outputs are captured with transform feedback
+// into the other buffer of the pair, and nothing is rasterised.
+//
+// The results have to match the C++ bit for bit, so:
+//  - whatever the C++ works out in double (the tests against double constants, and the spin) is done in double here
+//  - the float sums are precise, so they can't be fused into multiply-adds the C++ doesn't do
+in vec3 position1; // red bat
+in vec3 velocity1;
+in vec3 position2; // blue bat
+in vec3 velocity2;
+in vec3 ballPosition;
+in vec3 ballVelocity;
+in float rotateAngle;
+in vec3 ai; // aimError1, aimError2, lastBallDirection
+in uvec4 match; // redScore, blueScore, gameOver, impactCount
+in uint randomState;
+
+out vec3 outPosition1;
+out vec3 outVelocity1;
+out vec3 outPosition2;
+out vec3 outVelocity2;
+out vec3 outBallPosition;
+out vec3 outBallVelocity;
+out float outRotateAngle;
+out vec3 outAi;
+flat out uvec4 outMatch;
+flat out uint outRandomState;
+
+uniform double simLength;
+
+// the court, as it is changed
+precise vec3 bat1, bat1Velocity, bat2, bat2Velocity, ball, ballSpeed;
+float angle;
+vec3 aim;
+uint redScore, blueScore, impactCount, random;
+bool gameOver;
+
+float randomFloat(float low, float high)
+{
+	random = random * 1664525u + 1013904223u;
+	precise float value = low + (high - low) * float(random >> 8u) / float(1 << 24);
+	return value;
+}
+
+float steerTowards(float batX, float targetX)
+{
+	const float batSpeed = 3.0;
+	if (targetX > batX + 0.05)
+		return batSpeed;
+	if (targetX < batX - 0.05)
+		return -batSpeed;
+	return 0.0;
+}
+
+void newGame()
+{
+	bat1 = bat1Velocity = bat2 = bat2Velocity = ball = vec3(0.0);
+	ballSpeed = vec3(2.0, 0.0, 1.0);
+	angle = 1.0;
+	redScore = blueScore = impactCount = 0u;
+	gameOver = false;
+}
+
+void clampBat(inout vec3 bat)
+{
+	if (double(bat.x) + 0.5lf > 2.5lf)
+		bat.x = 2.0;
+	else if (double(bat.x) - 0.5lf < -2.5lf)
+		bat.x = -2.0;
+}
+
+bool ballOverlapsBat(vec3 bat)
+{
+	return ball.x + 0.1 > bat.x - 0.5 && ball.x - 0.1 < bat.x + 0.5;
+}
+
+void resetBall(bool isRedPoint)
+{
+	if (isRedPoint)
+		redScore++;
+	else
+		blueScore++;
+
+	if (redScore >= 5u || blueScore >= 5u)
+	{
+		gameOver = true;
+		ballSpeed.x = 0.0;
+		ballSpeed.z = 0.0;
+	}
+
+	ball.x = 0.0;
+	ball.z = 0.0;
+}
+
+void main()
+{
+	bat1 = position1; bat1Velocity = velocity1;
+	bat2 = position2; bat2Velocity = velocity2;
+	ball = ballPosition; ballSpeed = ballVelocity;
+	angle = rotateAngle;
+	aim = ai;
+	redScore = match.x; blueScore = match.y; gameOver = match.z != 0u; impactCount = match.w;
+	random = randomState;
+
+	// a finished match makes way for a new one
+	if (gameOver)
+		newGame();
+
+	// steerBats()
+	if (ballSpeed.z != aim.z)
+	{
+		aim.z = ballSpeed.z;
+		aim.x = randomFloat(-0.9, 0.9);
+		aim.y = randomFloat(-0.9, 0.9);
+	}
+	bat1Velocity.x = steerTowards(bat1.x, ball.x + aim.x);
+	bat2Velocity.x = steerTowards(bat2.x, ball.x + aim.y);
+
+	// updateSimulation()
+	float step = float(simLength);
+	bat1 += step * bat1Velocity;
+	bat2 += step * bat2Velocity;
+	angle = float(double(angle) + simLength * 2.0lf);
+
+	ball += step * ballSpeed;
+
+	clampBat(bat1);
+	clampBat(bat2);
+
+	if (double(ball.x) + 0.1lf > 2.5lf || double(ball.x) - 0.1lf < -2.5lf)
+	{
+		ballSpeed.x *= -1.0;
+		impactCount++;
+	}
+
+	if (double(ball.z) + 0.1lf > 3.0lf)
+		resetBall(true);
+	if (double(ball.z) - 0.1lf < -3.0lf)
+		resetBall(false);
+
+	// only a change of direction counts as a hit
+	if (ballOverlapsBat(bat1) && double(ball.z) - 0.1lf < double(-2.3))
+	{
+		if (ballSpeed.z != 1.0)
+			impactCount++;
+		ballSpeed.z = 1.0;
+	}
+	else if (ballOverlapsBat(bat2) && double(ball.z) + 0.1lf > double(2.3))
+	{
+		if (ballSpeed.z != -1.0)
+			impactCount++;
+		ballSpeed.z = -1.0;
+	}
+
+	outPosition1 = bat1; outVelocity1 = bat1Velocity;
+	outPosition2 = bat2; outVelocity2 = bat2Velocity;
+	outBallPosition = ball; outBallVelocity = ballSpeed;
+	outRotateAngle = angle;
+	outAi = aim;
+	outMatch = uvec4(redScore, blueScore, gameOver ? 1u : 0u, impactCount);
+	outRandomState = random;
+}
@@ -0,0 +1,42 @@
+#version 330
+// Draws one part (a bat, or the ball) of every court in the arena, one instance per court.
+// Where each court's part is comes straight from the arena's state buffer, as per-instance attributes.
+in vec3 position;
+in vec4 vertexColor;
+in vec3 normal;
+in vec3 objectPosition; // per instance - the bat or ball position in its court
+in float objectAngle; // per instance - the ball's spin
+out vec4 fragmentColor;
+out vec3 viewNormal;
+
+uniform mat4 viewMatrix;
+uniform mat4 projectionMatrix;
+uniform int courtColumns;
+uniform bool spin; // the ball turns about (1, 1, 1), like the one in the main court
+
+const vec2 courtSpacing = vec2(6.5, 7.5); // a court is 5 by 6, with a gap round it
+
+// what glm::rotate builds
+mat3 rotation(float angle, vec3 axis)
+{
+	float c = cos(angle);
+	float s = sin(angle);
+	vec3 t = (1.0 - c) * axis;
+	return mat3(c + t.x * axis.x, t.x * axis.y + s * axis.z, t.x * axis.z - s * axis.y,
+		t.y * axis.x - s * axis.z, c + t.y * axis.y, t.y * axis.z + s * axis.x,
+		t.z * axis.x + s * axis.y, t.z * axis.y - s * axis.x, c + t.z * axis.z);
+}
+
+void main()
+{
+	// the courts are laid out in rows behind the main one
+	int column = gl_InstanceID % courtColumns;
+	int row = gl_InstanceID / courtColumns;
+	vec3 court = vec3((float(column) - 0.5 * float(courtColumns - 1)) * courtSpacing.x, 0.0, -float(row + 1) * courtSpacing.y);
+
+	mat3 model = spin ? rotation(objectAngle, normalize(vec3(1.0))) : mat3(1.0);
+	vec4 worldPosition = vec4(court + objectPosition + model * position, 1.0);
+	gl_Position = projectionMatrix * viewMatrix * worldPosition;
+	fragmentColor = vertexColor;
+	viewNormal = mat3(viewMatrix) * model * normal;
+}
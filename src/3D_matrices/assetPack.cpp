@@ -0,0 +1,252 @@
+#include "assetPack.h"
+
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <cstring>
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+static uint64_t alignPackOffset(uint64_t offset)
+{
+	return (offset + ASSET_PACK_ALIGNMENT - 1) / ASSET_PACK_ALIGNMENT * ASSET_PACK_ALIGNMENT;
+}
+
+AssetPack::AssetPack() : mapping(nullptr), mappedBytes(0), entries(nullptr), entryCount(0)
+{
+}
+
+AssetPack::~AssetPack()
+{
+	close();
+}
+
+// tag::mapAssetPack[]
+//maps the whole file read-only - the file handles can be closed straight away, the mapping keeps the file open
+static const char *mapFile(const std::string &filePath, size_t &size)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return nullptr;
+	LARGE_INTEGER fileSize;
+	HANDLE fileMapping = nullptr;
+	if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+		fileMapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);
+	if (fileMapping == nullptr)
+		return nullptr;
+	void *view = MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(fileMapping);
+	if (view == nullptr)
+		return nullptr;
+	size = size_t(fileSize.QuadPart);
+	//touch every page in order, so the whole pack comes in as one sequential read now rather than a fault at a time later
+	volatile char touched = 0;
+	for (size_t offset = 0; offset < size; offset += 4096)
+		touched += static_cast<const char *>(view)[offset];
+	return static_cast<const char *>(view);
+#else
+	int file = ::open(filePath.c_str(), O_RDONLY);
+	if (file < 0)
+		return nullptr;
+	struct stat status;
+	void *view = MAP_FAILED;
+	if (fstat(file, &status) == 0 && status.st_size > 0)
+		view = mmap(nullptr, size_t(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+	::close(file);
+	if (view == MAP_FAILED)
+		return nullptr;
+	size = size_t(status.st_size);
+	//read the whole pack in now, in order, rather than a page fault at a time as assets are used
+	madvise(view, size, MADV_SEQUENTIAL);
+	madvise(view, size, MADV_WILLNEED);
+	return static_cast<const char *>(view);
+#endif
+}
+
+static void unmapFile(const char *mapping, size_t size)
+{
+#ifdef _WIN32
+	(void)size;
+	UnmapViewOfFile(mapping);
+#else
+	munmap(const_cast<char *>(mapping), size);
+#endif
+}
+// end::mapAssetPack[]
+
+// tag::openAssetPack[]
+bool AssetPack::open(const std::string &path)
+{
+	close();
+	size_t size = 0;
+	const char *view = mapFile(path, size);
+	if (view == nullptr)
+	{
+		cerr << "Asset pack could not be opened - cannot map file " << path << endl;
+		return false;
+	}
+
+	//check everything the table of contents points at is inside the file, so find() can trust it
+	const AssetPackHeader *header = reinterpret_cast<const AssetPackHeader *>(view);
+	const char *problem = nullptr;
+	if (size < sizeof(AssetPackHeader) || header->magic != ASSET_PACK_MAGIC)
+		problem = "is not an asset pack";
+	else if (header->version != ASSET_PACK_VERSION)
+		problem = "is a different version";
+	else if (header->fileSize != size || sizeof(AssetPackHeader) + uint64_t(header->entryCount) * sizeof(AssetPackEntry) > size)
+		problem = "is truncated";
+	else
+	{
+		const AssetPackEntry *table = reinterpret_cast<const AssetPackEntry *>(view + sizeof(AssetPackHeader));
+		for (uint32_t i = 0; i < header->entryCount && problem == nullptr; i++)
+		{
+			if (table[i].offset > size || table[i].size > size - table[i].offset || table[i].offset % ASSET_PACK_ALIGNMENT != 0)
+				problem = "has an asset out of range";
+			else if (table[i].name[ASSET_NAME_LENGTH - 1] != '\0' || (i > 0 && std::strcmp(table[i - 1].name, table[i].name) >= 0))
+				problem = "has a damaged table of contents";
+		}
+	}
+	if (problem != nullptr)
+	{
+		cerr << "Asset pack could not be opened - " << path << " " << problem << "." << endl;
+		unmapFile(view, size);
+		return false;
+	}
+
+	mapping = view;
+	mappedBytes = size;
+	entries = reinterpret_cast<const AssetPackEntry *>(view + sizeof(AssetPackHeader));
+	entryCount = header->entryCount;
+	filePath = path;
+	return true;
+}
+// end::openAssetPack[]
+
+void AssetPack::close()
+{
+	if (mapping != nullptr)
+		unmapFile(mapping, mappedBytes);
+	mapping = nullptr;
+	mappedBytes = 0;
+	entries = nullptr;
+	entryCount = 0;
+	filePath.clear();
+}
+
+// tag::findAsset[]
+//the table is sorted by name, so this is a binary search - and the blob is a pointer into the mapping, not a copy
+bool AssetPack::find(const std::string &name, AssetBlob &blob) const
+{
+	const AssetPackEntry *end = entries + entryCount;
+	const AssetPackEntry *entry = std::lower_bound(entries, end, name, [](const AssetPackEntry &e, const std::string &n) {
+		return std::strcmp(e.name, n.c_str()) < 0;
+	});
+	if (entry == end || name != entry->name)
+		return false;
+	blob.data = mapping + entry->offset;
+	blob.size = size_t(entry->size);
+	blob.type = AssetType(entry->type);
+	return true;
+}
+// end::findAsset[]
+
+void AssetPackWriter::add(const std::string &name, AssetType type, const void *data, size_t size)
+{
+	PendingAsset asset;
+	asset.name = name;
+	asset.type = type;
+	asset.bytes.assign(static_cast<const char *>(data), static_cast<const char *>(data) + size);
+	assets.push_back(asset);
+}
+
+bool AssetPackWriter::addFile(const std::string &name, AssetType type, const std::string &filePath)
+{
+	std::ifstream fileStream(filePath, std::ios::in | std::ios::binary);
+	if (!fileStream)
+	{
+		cerr << "Asset could not be packed - cannot read file " << filePath << endl;
+		return false;
+	}
+	std::vector<char> bytes((std::istreambuf_iterator<char>(fileStream)), std::istreambuf_iterator<char>());
+	add(name, type, bytes.data(), bytes.size());
+	return true;
+}
+
+// tag::writeAssetPack[]
+bool AssetPackWriter::write(const std::string &filePath)
+{
+	std::sort(assets.begin(), assets.end(), [](const PendingAsset &a, const PendingAsset &b) { return a.name < b.name; });
+
+	//lay out the blobs after the table of contents
+	std::vector<AssetPackEntry> table(assets.size());
+	uint64_t offset = alignPackOffset(sizeof(AssetPackHeader) + table.size() * sizeof(AssetPackEntry));
+	for (size_t i = 0; i < assets.size(); i++)
+	{
+		if (assets[i].name.size() >= ASSET_NAME_LENGTH || (i > 0 && assets[i].name == assets[i - 1].name))
+		{
+			cerr << "Asset pack could not be written - the name " << assets[i].name << " is too long, or used twice" << endl;
+			return false;
+		}
+		AssetPackEntry &entry = table[i];
+		std::memset(&entry, 0, sizeof(entry));
+		std::strcpy(entry.name, assets[i].name.c_str());
+		entry.type = uint32_t(assets[i].type);
+		entry.offset = offset;
+		entry.size = assets[i].bytes.size();
+		offset = alignPackOffset(offset + entry.size);
+	}
+
+	AssetPackHeader header;
+	header.magic = ASSET_PACK_MAGIC;
+	header.version = ASSET_PACK_VERSION;
+	header.entryCount = uint32_t(table.size());
+	header.reserved = 0;
+	header.fileSize = offset;
+
+	std::ofstream fileStream(filePath, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!fileStream)
+	{
+		cerr << "Asset pack could not be written - cannot open file " << filePath << endl;
+		return false;
+	}
+
+	std::vector<char> padding(ASSET_PACK_ALIGNMENT, 0);
+	auto padTo = [&](uint64_t target) {
+		uint64_t position = uint64_t(fileStream.tellp());
+		fileStream.write(padding.data(), std::streamsize(target - position));
+	};
+
+	fileStream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	fileStream.write(reinterpret_cast<const char *>(table.data()), table.size() * sizeof(AssetPackEntry));
+	for (size_t i = 0; i < assets.size(); i++)
+	{
+		padTo(table[i].offset);
+		fileStream.write(assets[i].bytes.data(), assets[i].bytes.size());
+	}
+	padTo(offset);
+
+	if (!fileStream)
+	{
+		cerr << "Asset pack could not be written - write to " << filePath << " failed." << endl;
+		return false;
+	}
+	cout << "Asset pack written to " << filePath << " (" << table.size() << " assets, " << offset << " bytes)" << endl;
+	return true;
+}
+// end::writeAssetPack[]
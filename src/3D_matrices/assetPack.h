@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// tag::assetPackFormat[]
+// An asset pack is every file the game loads, in one file that is memory mapped at startup:
+//
+//   AssetPackHeader
+//   AssetPackEntry[entryCount] - the table of contents, sorted by name
+//   the blobs, each starting on an ASSET_PACK_ALIGNMENT boundary
+//
+// A blob is the file as it would be on disk - a shader's source, a whole .lodmesh (so its vertex and
+// index blobs stay aligned too), or one of the compiled-in vertex arrays with its normals already added.
+// All values are little endian.
+const uint32_t ASSET_PACK_MAGIC = 0x4B415041; // "APAK"
+const uint32_t ASSET_PACK_VERSION = 1;
+const uint32_t ASSET_PACK_ALIGNMENT = 64; // a multiple of LOD_MESH_ALIGNMENT
+const uint32_t ASSET_NAME_LENGTH = 48;
+
+enum AssetType
+{
+	ASSET_SHADER_SOURCE,
+	ASSET_LOD_MESH,
+	ASSET_VERTEX_ARRAY // 10 floats per vertex - position, colour and normal
+};
+
+struct AssetPackHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t entryCount;
+	uint32_t reserved;
+	uint64_t fileSize; // so a truncated pack is spotted before anything is read from it
+};
+
+struct AssetPackEntry
+{
+	char name[ASSET_NAME_LENGTH]; // the file name the asset was packed from, nul terminated
+	uint32_t type; // AssetType
+	uint32_t reserved;
+	uint64_t offset; // from the start of the pack
+	uint64_t size;
+};
+// end::assetPackFormat[]
+
+// tag::assetPack[]
+//where one asset is, inside the mapping
+struct AssetBlob
+{
+	const char *data;
+	size_t size;
+	AssetType type;
+};
+
+//A pack, mapped read-only into memory. Nothing is copied out of it: find() hands back a pointer into the
+//mapping, which GL can upload from directly. The mapping is asked to read the whole file in at once,
+//so startup is one sequential read rather than a seek and a read per file.
+class AssetPack
+{
+public:
+	AssetPack();
+	~AssetPack();
+
+	bool open(const std::string &filePath);
+	void close(); // any AssetBlob found before is invalid after this
+	bool isOpen() const { return mapping != nullptr; }
+
+	bool find(const std::string &name, AssetBlob &blob) const; // by file name, without any directory
+
+	size_t size() const { return mappedBytes; }
+	uint32_t assetCount() const { return entryCount; }
+	const std::string &path() const { return filePath; }
+
+private:
+	AssetPack(const AssetPack &);
+	AssetPack &operator=(const AssetPack &);
+
+	const char *mapping;
+	size_t mappedBytes;
+	const AssetPackEntry *entries;
+	uint32_t entryCount;
+	std::string filePath;
+};
+// end::assetPack[]
+
+// tag::assetPackWriter[]
+//Collects assets, then writes them out as a pack - used by --pack-assets
+class AssetPackWriter
+{
+public:
+	void add(const std::string &name, AssetType type, const void *data, size_t size);
+	bool addFile(const std::string &name, AssetType type, const std::string &filePath); // false if the file can't be read
+	bool write(const std::string &filePath);
+
+private:
+	struct PendingAsset
+	{
+		std::string name;
+		AssetType type;
+		std::vector<char> bytes;
+	};
+
+	std::vector<PendingAsset> assets;
+};
+// end::assetPackWriter[]
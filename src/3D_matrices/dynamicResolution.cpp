@@ -0,0 +1,176 @@
+#include "dynamicResolution.h"
+
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+const float ResolutionController::minScale = 0.4f;
+const float ResolutionController::maxScale = 1.0f;
+
+static const int settleFrames = 8; // longer than the timer queries take to come back
+static const float scaleStep = 1.0f / 32.0f; // scales are rounded to this, so tiny changes don't move the image
+
+ResolutionController::ResolutionController() : enabled(true), targetMs(16.0f), currentScale(1.0f), smoothedMs(0.0), framesSinceChange(0)
+{
+}
+
+void ResolutionController::setTarget(float frameMs)
+{
+	enabled = true;
+	targetMs = std::max(frameMs, 1.0f);
+	smoothedMs = 0.0;
+	framesSinceChange = 0;
+}
+
+void ResolutionController::setFixedScale(float scale)
+{
+	enabled = false;
+	currentScale = std::max(minScale, std::min(scale, maxScale));
+}
+
+// tag::updateResolution[]
+float ResolutionController::update(double gpuFrameMs)
+{
+	if (!enabled)
+		return currentScale;
+
+	smoothedMs = (smoothedMs == 0.0) ? gpuFrameMs : smoothedMs + (gpuFrameMs - smoothedMs) * 0.2;
+	if (++framesSinceChange < settleFrames)
+		return currentScale;
+
+	float wanted = currentScale;
+	if (smoothedMs > targetMs)
+		wanted = currentScale * std::max(0.8f, float(std::sqrt(targetMs / smoothedMs)) * 0.97f); // aim a little under the target
+	else if (smoothedMs < targetMs * 0.75f)
+		wanted = currentScale * std::min(1.05f, float(std::sqrt(targetMs * 0.85f / smoothedMs)));
+
+	wanted = std::floor(wanted / scaleStep + 0.5f) * scaleStep;
+	wanted = std::max(minScale, std::min(wanted, maxScale));
+	if (wanted != currentScale)
+	{
+		currentScale = wanted;
+		framesSinceChange = 0;
+		smoothedMs = 0.0; // measure the new size from scratch
+	}
+	return currentScale;
+}
+// end::updateResolution[]
+
+GpuTimer::GpuTimer() : nextQuery(0), pending(0), running(false)
+{
+	for (int i = 0; i < queryCount; i++)
+		queries[i] = 0;
+}
+
+void GpuTimer::load()
+{
+	glGenQueries(queryCount, queries);
+}
+
+void GpuTimer::unload()
+{
+	glDeleteQueries(queryCount, queries);
+	nextQuery = pending = 0;
+	running = false;
+}
+
+void GpuTimer::begin()
+{
+	if (queries[0] == 0 || running || pending == queryCount) // every query is still in flight - skip timing this frame
+		return;
+	glBeginQuery(GL_TIME_ELAPSED, queries[nextQuery]);
+	running = true;
+}
+
+void GpuTimer::end()
+{
+	if (!running)
+		return;
+	glEndQuery(GL_TIME_ELAPSED);
+	running = false;
+	nextQuery = (nextQuery + 1) % queryCount;
+	pending++;
+}
+
+// tag::collectGpuTime[]
+bool GpuTimer::collect(double &frameMs)
+{
+	if (pending == 0)
+		return false;
+
+	GLuint oldest = queries[(nextQuery - pending + queryCount) % queryCount];
+	GLint available = 0;
+	glGetQueryObjectiv(oldest, GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+		return false;
+
+	GLuint64 nanoseconds = 0;
+	glGetQueryObjectui64v(oldest, GL_QUERY_RESULT, &nanoseconds);
+	pending--;
+	frameMs = double(nanoseconds) / 1000000.0;
+	return true;
+}
+// end::collectGpuTime[]
+
+SceneTarget::SceneTarget() : framebuffer(0), targetWidth(0), targetHeight(0)
+{
+	renderbuffers[0] = renderbuffers[1] = 0;
+}
+
+void SceneTarget::resize(int width, int height)
+{
+	width = std::max(width, 1);
+	height = std::max(height, 1);
+	if (framebuffer != 0 && width == targetWidth && height == targetHeight)
+		return;
+
+	unload();
+	targetWidth = width;
+	targetHeight = height;
+
+	glGenRenderbuffers(2, renderbuffers);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		cerr << "Scene framebuffer incomplete at " << width << "x" << height << endl;
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	cout << "\nScene target resized to " << width << "x" << height << endl;
+}
+
+void SceneTarget::unload()
+{
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteRenderbuffers(2, renderbuffers);
+	framebuffer = 0;
+	renderbuffers[0] = renderbuffers[1] = 0;
+}
+
+void SceneTarget::bind(int sceneWidth, int sceneHeight)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, sceneWidth, sceneHeight);
+}
+
+// tag::presentScene[]
+void SceneTarget::present(int sceneWidth, int sceneHeight, GLuint outputFramebuffer) const
+{
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, outputFramebuffer);
+	glBlitFramebuffer(0, 0, sceneWidth, sceneHeight, 0, 0, targetWidth, targetHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR); // bilinear upscale
+	glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer);
+	glViewport(0, 0, targetWidth, targetHeight);
+}
+// end::presentScene[]
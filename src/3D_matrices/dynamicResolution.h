@@ -0,0 +1,87 @@
+#pragma once
+
+#include <GL/glew.h>
+
+// tag::resolutionController[]
+//Picks the scale to render the scene at, from how long the GPU took over recent frames.
+//
+//  - the frame time is smoothed, and after each change the controller waits a few frames, so the
+//    measurements reflect the new resolution before it decides again
+//  - the number of pixels goes with the square of the scale, so a frame that is 20% over the target
+//    scales by about sqrt(1 / 1.2)
+//  - it drops quickly when over the target, and only climbs back slowly once there is clear headroom,
+//    so it doesn't flicker between two sizes
+class ResolutionController
+{
+public:
+	ResolutionController();
+
+	void setTarget(float frameMs); // turns the controller on
+	void setFixedScale(float scale); // turns it off, and renders at this scale
+
+	float update(double gpuFrameMs); // feed in a measured frame - returns the scale to use next
+	float scale() const { return currentScale; }
+	bool dynamic() const { return enabled; }
+	float target() const { return targetMs; }
+
+	static const float minScale;
+	static const float maxScale;
+
+private:
+	bool enabled;
+	float targetMs;
+	float currentScale;
+	double smoothedMs;
+	int framesSinceChange;
+};
+// end::resolutionController[]
+
+// tag::gpuTimer[]
+//GL_TIME_ELAPSED queries around each frame, read back a few frames later so we never wait for the GPU
+class GpuTimer
+{
+public:
+	GpuTimer();
+
+	void load(); // GL thread only
+	void unload();
+
+	void begin();
+	void end();
+	bool collect(double &frameMs); // true if a finished frame was read - call until it returns false
+
+private:
+	static const int queryCount = 4; // frames in flight
+
+	GLuint queries[queryCount];
+	int nextQuery; // the one begin() uses next
+	int pending; // ended but not yet read
+	bool running;
+};
+// end::gpuTimer[]
+
+// tag::sceneTarget[]
+//An offscreen framebuffer the size of the window, which the scene is drawn into the bottom left
+//corner of, at whatever size the controller picked. present() stretches that corner over the window.
+//Changing the scale just changes the viewport - the buffers are only reallocated when the window size changes.
+class SceneTarget
+{
+public:
+	SceneTarget();
+
+	void resize(int width, int height); // GL thread only - the size of the window's drawable
+	void unload();
+
+	void bind(int sceneWidth, int sceneHeight); // draw the scene into the target, at this size
+	void present(int sceneWidth, int sceneHeight, GLuint outputFramebuffer) const; // upscale it into the output
+
+	int width() const { return targetWidth; }
+	int height() const { return targetHeight; }
+
+private:
+	GLuint framebuffer;
+	GLuint renderbuffers[2]; // colour and depth
+	int targetWidth;
+	int targetHeight;
+};
+// end::sceneTarget[]
@@ -1,9 +1,44 @@
 #version 330
 in vec4 fragmentColor;
+in vec3 viewPosition;
+in vec3 viewNormal;
 out vec4 outputColor;
+
+// the clustered light lists, built on the CPU each frame (see lightClusters.h)
+uniform samplerBuffer lightData;     // two texels per light: view space position and radius, then colour
+uniform usamplerBuffer clusterData;  // offset and count into lightIndices for each cluster
+uniform usamplerBuffer lightIndices;
+uniform ivec3 clusterGrid;           // tiles across, tiles up, depth slices
+uniform float clusterNear;
+uniform float clusterSliceScale;     // slices / log(far / near)
+uniform vec2 viewportSize;
+
 void main()
 {
 	float ambientStrength = 0.5f;
-	vec4 ambient = ambientStrength * fragmentColor;
-	 outputColor = ambient;
+	vec3 lighting = vec3(ambientStrength);
+
+	// which cluster is this fragment in?
+	ivec2 tile = clamp(ivec2(gl_FragCoord.xy / viewportSize * vec2(clusterGrid.xy)), ivec2(0), clusterGrid.xy - 1);
+	int slice = clamp(int(log(max(-viewPosition.z, clusterNear) / clusterNear) * clusterSliceScale), 0, clusterGrid.z - 1);
+	uvec2 cluster = texelFetch(clusterData, (slice * clusterGrid.y + tile.y) * clusterGrid.x + tile.x).rg;
+
+	// only the lights that can reach this cluster
+	vec3 normal = normalize(viewNormal);
+	for (uint i = 0u; i < cluster.y; i++)
+	{
+		int light = int(texelFetch(lightIndices, int(cluster.x + i)).r);
+		vec4 positionAndRadius = texelFetch(lightData, light * 2);
+		vec3 toLight = positionAndRadius.xyz - viewPosition;
+		float distanceSquared = dot(toLight, toLight);
+		float radiusSquared = positionAndRadius.w * positionAndRadius.w;
+		if (distanceSquared < radiusSquared)
+		{
+			float falloff = 1.0 - distanceSquared / radiusSquared; // smooth, and exactly zero at the radius
+			float diffuse = max(dot(normal, toLight * inversesqrt(distanceSquared)), 0.0);
+			lighting += texelFetch(lightData, light * 2 + 1).rgb * diffuse * falloff * falloff;
+		}
+	}
+
+	outputColor = vec4(fragmentColor.rgb * lighting, fragmentColor.a);
 }
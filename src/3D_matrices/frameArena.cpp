@@ -0,0 +1,64 @@
+#include "frameArena.h"
+
+#include <iostream>
+#include <cstdio>
+#include <cstdarg>
+
+using std::cerr;
+using std::endl;
+
+FrameArena::FrameArena(size_t capacity)
+	: memory(new uint8_t[capacity]), size(capacity), offset(0), highWater(0), overflowReported(false)
+{
+}
+
+FrameArena::~FrameArena()
+{
+	delete[] memory;
+}
+
+// tag::frameArenaAllocate[]
+void *FrameArena::allocate(size_t bytes, size_t alignment)
+{
+	size_t start = (offset + alignment - 1) & ~(alignment - 1);
+	if (start + bytes > size)
+	{
+		if (!overflowReported)
+		{
+			cerr << "\nFrameArena out of memory - " << bytes << " bytes requested, " << (size - offset) << " of " << size << " free." << endl;
+			overflowReported = true;
+		}
+		return nullptr;
+	}
+
+	offset = start + bytes;
+	if (offset > highWater)
+		highWater = offset;
+	return memory + start;
+}
+// end::frameArenaAllocate[]
+
+const char *FrameArena::format(const char *formatString, ...)
+{
+	va_list args;
+	va_start(args, formatString);
+	va_list argsCopy;
+	va_copy(argsCopy, args);
+	int length = vsnprintf(nullptr, 0, formatString, args);
+	va_end(args);
+
+	char *text = (length >= 0) ? allocateArray<char>(size_t(length) + 1) : nullptr;
+	if (text == nullptr)
+	{
+		va_end(argsCopy);
+		return "";
+	}
+	vsnprintf(text, size_t(length) + 1, formatString, argsCopy);
+	va_end(argsCopy);
+	return text;
+}
+
+void FrameArena::reset()
+{
+	offset = 0;
+}
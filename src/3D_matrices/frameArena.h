@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// tag::frameArena[]
+//A linear allocator for data that only lives for one frame.
+//
+//  - the backing memory is allocated once, up front
+//  - allocate() just bumps an offset, and reset() at the start of each frame throws everything away
+//  - nothing is destructed, so only use it for trivially destructible data (text, arrays of POD)
+//
+//This keeps transient per-frame data off the heap, so the steady-state loop does not allocate.
+class FrameArena
+{
+public:
+	explicit FrameArena(size_t capacity);
+	~FrameArena();
+
+	void *allocate(size_t bytes, size_t alignment = alignof(std::max_align_t)); // nullptr if the arena is full
+
+	template <typename T>
+	T *allocateArray(size_t count)
+	{
+		return static_cast<T *>(allocate(count * sizeof(T), alignof(T)));
+	}
+
+	const char *format(const char *formatString, ...); // printf into the arena - never null
+
+	void reset();
+
+	size_t bytesUsed() const { return offset; }
+	size_t highWaterMark() const { return highWater; }
+	size_t capacity() const { return size; }
+
+private:
+	FrameArena(const FrameArena &);
+	FrameArena &operator=(const FrameArena &);
+
+	uint8_t *memory;
+	size_t size;
+	size_t offset;
+	size_t highWater;
+	bool overflowReported;
+};
+// end::frameArena[]
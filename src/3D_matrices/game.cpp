@@ -0,0 +1,176 @@
+#include "game.h"
+#include "matchEvents.h"
+
+CourtLayout defaultCourtLayout()
+{
+	CourtLayout court;
+	court.halfWidth = 2.5f;
+	court.halfLength = 3.0f;
+	court.batPlane = 2.3f;
+	return court;
+}
+
+bool operator==(const CourtLayout &a, const CourtLayout &b)
+{
+	return a.halfWidth == b.halfWidth && a.halfLength == b.halfLength && a.batPlane == b.batPlane;
+}
+
+bool operator!=(const CourtLayout &a, const CourtLayout &b)
+{
+	return !(a == b);
+}
+
+GameState newGame(const CourtLayout &court)
+{
+	GameState state;
+	state.position1 = glm::vec3(0.0f, 0.0f, 0.0f);
+	state.velocity1 = glm::vec3(0.0f, 0.0f, 0.0f);
+	state.position2 = glm::vec3(0.0f, 0.0f, 0.0f);
+	state.velocity2 = glm::vec3(0.0f, 0.0f, 0.0f);
+	state.ballPosition = glm::vec3(0.0f, 0.0f, 0.0f);
+	state.ballVelocity = glm::vec3(2.0f, 0.0f, 1.0f);
+	state.rotateAngle = 1.0f;
+	state.redScore = 0;
+	state.blueScore = 0;
+	state.gameOver = false;
+	state.impactCount = 0;
+	state.court = court;
+	return state;
+}
+
+void setCourt(GameState &state, const CourtLayout &court)
+{
+	state.court = court;
+	clampBat(state.position1, court);
+	clampBat(state.position2, court);
+	//a ball left outside a side wall would bounce on every tick - one outside a goal just scores on the next one
+	float ballLimit = court.halfWidth - 0.1f;
+	state.ballPosition.x = glm::clamp(state.ballPosition.x, -ballLimit, ballLimit);
+}
+
+static void recordImpact(GameState &state, const glm::vec3 &position, const glm::vec3 &normal)
+{
+	ImpactEvent &impact = state.recentImpacts[state.impactCount % recentImpactCount];
+	impact.position = position;
+	impact.normal = normal;
+	state.impactCount++;
+}
+
+// tag::collisionTests[]
+//the court's floats are widened to double, as the constants they replace were - so the compiled-in court
+//gives the same results as it always has, bit for bit (the GPU arena checks against it, see gpuArena.h)
+bool clampBat(glm::vec3 &batPosition, const CourtLayout &court)
+{
+	if (batPosition.x + 0.5 > court.halfWidth)
+	{
+		batPosition.x = court.halfWidth - 0.5f;
+		return true;
+	}
+	else if (batPosition.x - 0.5 < -court.halfWidth)
+	{
+		batPosition.x = -court.halfWidth + 0.5f;
+		return true;
+	}
+	return false;
+}
+
+bool ballHitsSideWall(const glm::vec3 &ballPosition, const CourtLayout &court)
+{
+	return ballPosition.x + 0.1 > court.halfWidth || ballPosition.x - 0.1 < -court.halfWidth;
+}
+
+// If the outer edges of the ball are within the outer edges of the bat X coord, and the Z coords cross then that is a hit
+bool ballOverlapsBat(const glm::vec3 &ballPosition, const glm::vec3 &batPosition)
+{
+	return ballPosition.x + 0.1f > batPosition.x - 0.5f && ballPosition.x - 0.1f < batPosition.x + 0.5f;
+}
+// end::collisionTests[]
+
+// tag::updateSimulation[]
+void updateSimulation(GameState &state, double simLength, MatchEventWriter *events)
+{
+	//WARNING - we should calculate an appropriate amount of time to simulate - not always use a constant amount of time
+			// see, for example, http://headerphile.blogspot.co.uk/2014/07/part-9-no-more-delays.html
+
+	state.position1 += float(simLength) * state.velocity1;
+	state.position2 += float(simLength) * state.velocity2;
+	if (!state.gameOver)
+		state.rotateAngle += simLength * 2; // once the match is over the ball sits still, so the frame does too
+
+	state.ballPosition += float(simLength) * state.ballVelocity;
+
+	// Check for collisions between the bats and the boundaries
+	const CourtLayout &court = state.court;
+	clampBat(state.position1, court);
+	clampBat(state.position2, court);
+
+	// Check for collision with the ball and the bounds
+	if (ballHitsSideWall(state.ballPosition, court))
+	{
+		state.ballVelocity.x *= -1.0f;
+		recordImpact(state, state.ballPosition, glm::vec3(state.ballVelocity.x > 0.0f ? 1.0f : -1.0f, 0.0f, 0.0f));
+		if (events)
+			events->record(EVENT_WALL_BOUNCE, state.ballPosition.x, glm::length(state.ballVelocity));
+	}
+
+	if (state.ballPosition.z + 0.1 > court.halfLength)
+	{
+		resetBall(state, true, events);
+	}
+	if (state.ballPosition.z - 0.1 < -court.halfLength)
+	{
+		// Blue gets a point
+		resetBall(state, false, events);
+	}
+
+
+	// Check for collisions between the ball and the bats - only a change of direction counts as a hit
+	if (ballOverlapsBat(state.ballPosition, state.position1) && state.ballPosition.z - 0.1 < -court.batPlane)
+	{
+		if (state.ballVelocity.z != 1)
+		{
+			recordImpact(state, state.ballPosition, glm::vec3(0.0f, 0.0f, 1.0f));
+			if (events)
+				events->record(EVENT_RED_HIT, state.ballPosition.x, glm::length(state.ballVelocity));
+		}
+		state.ballVelocity.z = 1;
+	}
+	else if (ballOverlapsBat(state.ballPosition, state.position2) && state.ballPosition.z + 0.1 > court.batPlane)
+	{
+		if (state.ballVelocity.z != -1)
+		{
+			recordImpact(state, state.ballPosition, glm::vec3(0.0f, 0.0f, -1.0f));
+			if (events)
+				events->record(EVENT_BLUE_HIT, state.ballPosition.x, glm::length(state.ballVelocity));
+		}
+		state.ballVelocity.z = -1;
+	}
+
+	if (events)
+		events->nextTick();
+
+}
+// end::updateSimulation[]
+
+void resetBall(GameState &state, bool isRedPoint, MatchEventWriter *events)
+{
+	if (isRedPoint)
+		state.redScore++;
+	else
+		state.blueScore++;
+	if (events)
+		events->record(isRedPoint ? EVENT_RED_POINT : EVENT_BLUE_POINT, state.ballPosition.x, glm::length(state.ballVelocity));
+
+	if (state.redScore >= 5 || state.blueScore >= 5)
+	{
+		if (events)
+			events->record(isRedPoint ? EVENT_RED_WIN : EVENT_BLUE_WIN, state.ballPosition.x, glm::length(state.ballVelocity));
+		state.gameOver = true;
+		state.ballVelocity.x = 0.0f;
+		state.ballVelocity.z = 0.0f;
+	}
+
+	state.ballPosition.x = 0;
+	state.ballPosition.z = 0;
+
+}
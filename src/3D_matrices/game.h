@@ -0,0 +1,75 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS // suppress a warning in GLM 0.9.5
+#include <glm/glm.hpp>
+
+// tag::gameState[]
+//a ball hitting a bat or a wall - what the renderer needs to draw an effect there
+struct ImpactEvent
+{
+	glm::vec3 position;
+	glm::vec3 normal; // pointing back into the court, the way the ball bounced
+};
+
+const unsigned int recentImpactCount = 4;
+
+//the size of the court - set from the scene file (see scene.h), or the compiled-in court of 5 by 6
+//the bats are 1 wide and the ball 0.2 across whatever the court is, as their meshes are
+struct CourtLayout
+{
+	float halfWidth; // the side walls are at x = -halfWidth and halfWidth
+	float halfLength; // the goals are at z = -halfLength and halfLength
+	float batPlane; // the bats' faces are at z = -batPlane and batPlane
+};
+
+CourtLayout defaultCourtLayout();
+bool operator==(const CourtLayout &a, const CourtLayout &b);
+bool operator!=(const CourtLayout &a, const CourtLayout &b);
+
+//the translation vector we'll pass to our GLSL program
+// These are changed in update simulation, the velocity vectors are altered by keypress input to determine movement
+//
+//Everything the simulation needs lives in one struct, so it can be copied, benchmarked
+//and run many times over (headless matches) without touching any GL state
+struct GameState
+{
+	glm::vec3 position1; // red bat
+	glm::vec3 velocity1;
+
+	glm::vec3 position2; // blue bat
+	glm::vec3 velocity2;
+
+	glm::vec3 ballPosition;
+	glm::vec3 ballVelocity;
+
+	float rotateAngle;
+
+	// Score tracking
+	unsigned int redScore;
+	unsigned int blueScore;
+	bool gameOver;
+
+	// Collision events - a running count, and the last few, so a renderer that skips a state or two still sees them all
+	unsigned int impactCount;
+	ImpactEvent recentImpacts[recentImpactCount]; // impact number i is in recentImpacts[i % recentImpactCount]
+
+	CourtLayout court;
+};
+
+GameState newGame(const CourtLayout &court = defaultCourtLayout());
+void setCourt(GameState &state, const CourtLayout &court); // mid-match - the bats and ball are pulled back inside if it shrank
+// end::gameState[]
+
+class MatchEventWriter;
+
+//update simulation with an amount of time to simulate for (in seconds)
+//events, if given, gets the hits, bounces and points - see matchEvents.h
+void updateSimulation(GameState &state, double simLength = 0.02, MatchEventWriter *events = nullptr);
+void resetBall(GameState &state, bool isRedPoint, MatchEventWriter *events = nullptr);
+
+// tag::collisionTests[]
+//the individual tests updateSimulation is built from
+bool clampBat(glm::vec3 &batPosition, const CourtLayout &court = defaultCourtLayout()); // true if the bat was pushed back inside the court
+bool ballHitsSideWall(const glm::vec3 &ballPosition, const CourtLayout &court = defaultCourtLayout());
+bool ballOverlapsBat(const glm::vec3 &ballPosition, const glm::vec3 &batPosition); // do the x extents overlap?
+// end::collisionTests[]
@@ -0,0 +1,169 @@
+#include "glStateCache.h"
+
+#include <cstring>
+
+#include <glm/gtc/type_ptr.hpp>
+
+static const GLuint unknownBinding = ~0u;
+
+GLStateCache::GLStateCache() : uniformCount(0)
+{
+	invalidateBindings();
+	frameCounts.issued = frameCounts.skipped = frameCounts.draws = 0;
+	lastFrameCounts = frameCounts;
+}
+
+void GLStateCache::invalidateBindings()
+{
+	currentProgram = unknownBinding;
+	currentVertexArray = unknownBinding;
+	activeUnit = -1;
+	for (int i = 0; i < maxTextureUnits; i++)
+		boundTextures[i] = unknownBinding;
+	depthTest = -1;
+	blend = -1;
+}
+
+void GLStateCache::forgetProgram(GLuint program)
+{
+	for (int i = 0; i < uniformCount; )
+	{
+		if (uniforms[i].program == program)
+			uniforms[i] = uniforms[--uniformCount];
+		else
+			i++;
+	}
+	if (currentProgram == program)
+		currentProgram = unknownBinding;
+}
+
+// tag::shadowedBinds[]
+void GLStateCache::useProgram(GLuint program)
+{
+	if (program == currentProgram)
+	{
+		frameCounts.skipped++;
+		return;
+	}
+	glUseProgram(program);
+	currentProgram = program;
+	frameCounts.issued++;
+}
+
+void GLStateCache::bindVertexArray(GLuint vertexArray)
+{
+	if (vertexArray == currentVertexArray)
+	{
+		frameCounts.skipped++;
+		return;
+	}
+	glBindVertexArray(vertexArray);
+	currentVertexArray = vertexArray;
+	frameCounts.issued++;
+}
+// end::shadowedBinds[]
+
+void GLStateCache::bindTexture(GLint unit, GLenum target, GLuint texture)
+{
+	if (unit >= 0 && unit < maxTextureUnits && boundTextures[unit] == texture)
+	{
+		frameCounts.skipped++;
+		return;
+	}
+	if (unit != activeUnit)
+	{
+		glActiveTexture(GL_TEXTURE0 + unit);
+		activeUnit = unit;
+		frameCounts.issued++;
+	}
+	glBindTexture(target, texture);
+	if (unit >= 0 && unit < maxTextureUnits)
+		boundTextures[unit] = texture;
+	frameCounts.issued++;
+}
+
+void GLStateCache::setCapability(GLenum capability, bool enabled)
+{
+	int &shadow = (capability == GL_BLEND) ? blend : depthTest;
+	if (shadow == (enabled ? 1 : 0))
+	{
+		frameCounts.skipped++;
+		return;
+	}
+	if (enabled)
+		glEnable(capability);
+	else
+		glDisable(capability);
+	shadow = enabled ? 1 : 0;
+	frameCounts.issued++;
+}
+
+// tag::shadowedUniforms[]
+bool GLStateCache::uniformChanged(GLint location, const void *values, size_t bytes)
+{
+	if (location < 0) // not in the program - GL would ignore it anyway
+	{
+		frameCounts.skipped++;
+		return false;
+	}
+
+	ShadowUniform *shadow = nullptr;
+	for (int i = 0; i < uniformCount && shadow == nullptr; i++)
+		if (uniforms[i].program == currentProgram && uniforms[i].location == location)
+			shadow = &uniforms[i];
+
+	if (shadow != nullptr && std::memcmp(shadow->values, values, bytes) == 0)
+	{
+		frameCounts.skipped++;
+		return false;
+	}
+	if (shadow == nullptr && uniformCount < maxUniforms) // a full table just means this uniform isn't shadowed
+	{
+		shadow = &uniforms[uniformCount++];
+		shadow->program = currentProgram;
+		shadow->location = location;
+	}
+	if (shadow != nullptr)
+		std::memcpy(shadow->values, values, bytes);
+	frameCounts.issued++;
+	return true;
+}
+// end::shadowedUniforms[]
+
+void GLStateCache::uniform1i(GLint location, GLint value)
+{
+	if (uniformChanged(location, &value, sizeof(value)))
+		glUniform1i(location, value);
+}
+
+void GLStateCache::uniform1f(GLint location, GLfloat value)
+{
+	if (uniformChanged(location, &value, sizeof(value)))
+		glUniform1f(location, value);
+}
+
+void GLStateCache::uniform2f(GLint location, GLfloat x, GLfloat y)
+{
+	GLfloat values[2] = { x, y };
+	if (uniformChanged(location, values, sizeof(values)))
+		glUniform2f(location, x, y);
+}
+
+void GLStateCache::uniform3i(GLint location, GLint x, GLint y, GLint z)
+{
+	GLint values[3] = { x, y, z };
+	if (uniformChanged(location, values, sizeof(values)))
+		glUniform3i(location, x, y, z);
+}
+
+void GLStateCache::uniformMatrix4(GLint location, const glm::mat4 &matrix)
+{
+	if (uniformChanged(location, glm::value_ptr(matrix), 16 * sizeof(GLfloat)))
+		glUniformMatrix4fv(location, 1, false, glm::value_ptr(matrix));
+}
+
+void GLStateCache::endFrame()
+{
+	lastFrameCounts = frameCounts;
+	frameCounts.issued = frameCounts.skipped = frameCounts.draws = 0;
+}
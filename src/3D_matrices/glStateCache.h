@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <GL/glew.h>
+
+#define GLM_FORCE_RADIANS // suppress a warning in GLM 0.9.5
+#include <glm/glm.hpp>
+
+// tag::glStateCache[]
+//A shadow copy of the GL state the scene pass changes, so calls that wouldn't change anything are skipped.
+//
+//  - program, vertex array and texture bindings are remembered until invalidateBindings() - call it
+//    whenever code that doesn't go through the cache (the HUD, the particles, mesh uploads) may have
+//    changed them
+//  - uniform values belong to the program object, so they are remembered across frames: a projection
+//    matrix that hasn't changed since last frame is never uploaded again
+//  - every call counts as issued or skipped, so the saving can be shown
+class GLStateCache
+{
+public:
+	struct Counts
+	{
+		uint32_t issued; // GL calls made
+		uint32_t skipped; // GL calls that would have set what was already there
+		uint32_t draws;
+	};
+
+	GLStateCache();
+
+	void invalidateBindings();
+	void forgetProgram(GLuint program); // its uniforms, when it's deleted
+
+	void useProgram(GLuint program);
+	void bindVertexArray(GLuint vertexArray);
+	void bindTexture(GLint unit, GLenum target, GLuint texture);
+	void setCapability(GLenum capability, bool enabled); // GL_DEPTH_TEST or GL_BLEND
+
+	//the program must be current (useProgram) - these set a uniform of that program
+	void uniform1i(GLint location, GLint value);
+	void uniform1f(GLint location, GLfloat value);
+	void uniform2f(GLint location, GLfloat x, GLfloat y);
+	void uniform3i(GLint location, GLint x, GLint y, GLint z);
+	void uniformMatrix4(GLint location, const glm::mat4 &matrix);
+
+	void countDraw() { frameCounts.draws++; frameCounts.issued++; }
+
+	void endFrame(); // keep this frame's counts for counts(), and start new ones
+	const Counts &counts() const { return lastFrameCounts; }
+
+private:
+	static const int maxUniforms = 32;
+	static const int maxTextureUnits = 8;
+
+	struct ShadowUniform
+	{
+		GLuint program;
+		GLint location;
+		GLfloat values[16]; // integers are stored bit for bit
+	};
+
+	bool uniformChanged(GLint location, const void *values, size_t bytes); // updates the shadow and counts the call
+
+	GLuint currentProgram; // ~0u when unknown
+	GLuint currentVertexArray;
+	GLint activeUnit;
+	GLuint boundTextures[maxTextureUnits];
+	int depthTest; // -1 unknown, 0 off, 1 on
+	int blend;
+
+	ShadowUniform uniforms[maxUniforms];
+	int uniformCount;
+
+	Counts frameCounts;
+	Counts lastFrameCounts;
+};
+// end::glStateCache[]
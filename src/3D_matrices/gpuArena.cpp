@@ -0,0 +1,386 @@
+#include "gpuArena.h"
+
+#include <iostream>
+#include <cstddef>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include "renderer.h"
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+// tag::arenaRules[]
+uint32_t arenaCourtSeed(int court)
+{
+	return uint32_t(court * 2654435761u + 12345u);
+}
+
+void stepArenaCourt(GameState &state, BatAi &ai)
+{
+	if (state.gameOver)
+		state = newGame();
+	steerBats(state, ai);
+	updateSimulation(state, arenaTickLength);
+}
+// end::arenaRules[]
+
+GpuArena::GpuArena() : courtCount(0), tickCount(0), current(0),
+	simLengthLocation(-1), viewMatrixLocation(-1), projectionMatrixLocation(-1), courtColumnsLocation(-1), spinLocation(-1)
+{
+	for (int part = 0; part < ARENA_PARTS; part++)
+	{
+		meshes[part].vertexBuffer = 0;
+		meshes[part].first = 0;
+		meshes[part].count = 0;
+	}
+}
+
+// tag::loadArena[]
+bool GpuArena::load(const char *updateShaderPath, const char *vertexShaderPath, const char *fragmentShaderPath)
+{
+	if (!GLEW_VERSION_4_0)
+	{
+		cerr << "The GPU arena needs OpenGL 4.0 (doubles and precise in shaders) - not loaded" << endl;
+		return false;
+	}
+
+	std::vector<GpuShader> updateShaders;
+	updateShaders.push_back(createShader(GL_VERTEX_SHADER, loadShader(updateShaderPath)));
+	const char *varyings[] = { "outPosition1", "outVelocity1", "outPosition2", "outVelocity2", "outBallPosition", "outBallVelocity",
+		"outRotateAngle", "outAi", "outMatch", "outRandomState" };
+	updateProgram = createProgram(updateShaders, std::vector<const char *>(varyings, varyings + sizeof(varyings) / sizeof(varyings[0])), "arena update program");
+
+	std::vector<GpuShader> drawShaders;
+	drawShaders.push_back(createShader(GL_VERTEX_SHADER, loadShader(vertexShaderPath)));
+	drawShaders.push_back(createShader(GL_FRAGMENT_SHADER, loadShader(fragmentShaderPath)));
+	drawProgram = createProgram(drawShaders, std::vector<const char *>(), "arena draw program");
+
+	if (updateProgram.get() == 0 || drawProgram.get() == 0)
+	{
+		cerr << "GPU arena GLSL program creation error." << endl;
+		unload();
+		return false;
+	}
+
+	simLengthLocation = glGetUniformLocation(updateProgram.get(), "simLength");
+	viewMatrixLocation = glGetUniformLocation(drawProgram.get(), "viewMatrix");
+	projectionMatrixLocation = glGetUniformLocation(drawProgram.get(), "projectionMatrix");
+	courtColumnsLocation = glGetUniformLocation(drawProgram.get(), "courtColumns");
+	spinLocation = glGetUniformLocation(drawProgram.get(), "spin");
+
+	//the attributes are in the same order as the Court struct
+	const char *attributes[] = { "position1", "velocity1", "position2", "velocity2", "ballPosition", "ballVelocity", "rotateAngle", "ai", "match", "randomState" };
+	const GLint sizes[] = { 3, 3, 3, 3, 3, 3, 1, 3, 4, 1 };
+	const size_t offsets[] = { offsetof(Court, position1), offsetof(Court, velocity1), offsetof(Court, position2), offsetof(Court, velocity2),
+		offsetof(Court, ballPosition), offsetof(Court, ballVelocity), offsetof(Court, rotateAngle), offsetof(Court, ai), offsetof(Court, match), offsetof(Court, randomState) };
+	const int floatAttributes = 8; // the rest are unsigned ints
+
+	for (int i = 0; i < 2; i++)
+	{
+		courtBuffers[i] = GpuBuffer::create("arena courts");
+		updateVertexArrays[i] = GpuVertexArray::create("arena update");
+		glBindBuffer(GL_ARRAY_BUFFER, courtBuffers[i].get());
+		courtBuffers[i].upload(GL_ARRAY_BUFFER, maxCourts * sizeof(Court), nullptr, GL_DYNAMIC_COPY); // written and read by the GPU, apart from reset()
+
+		glBindVertexArray(updateVertexArrays[i].get());
+		for (int a = 0; a < int(sizeof(attributes) / sizeof(attributes[0])); a++)
+		{
+			GLint location = glGetAttribLocation(updateProgram.get(), attributes[a]);
+			glEnableVertexAttribArray(location);
+			if (a < floatAttributes)
+				glVertexAttribPointer(location, sizes[a], GL_FLOAT, GL_FALSE, sizeof(Court), (GLvoid *)offsets[a]);
+			else
+				glVertexAttribIPointer(location, sizes[a], GL_UNSIGNED_INT, sizeof(Court), (GLvoid *)offsets[a]);
+		}
+	}
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	cout << "GPU arena created OK! Up to " << maxCourts << " courts, " << 2 * maxCourts * sizeof(Court) / 1024 << " KB of buffers" << endl;
+	return true;
+}
+// end::loadArena[]
+
+void GpuArena::releaseDrawArrays()
+{
+	for (int part = 0; part < ARENA_PARTS; part++)
+	{
+		drawVertexArrays[part][0].reset();
+		drawVertexArrays[part][1].reset();
+	}
+}
+
+void GpuArena::unload()
+{
+	releaseDrawArrays();
+	for (int i = 0; i < 2; i++)
+	{
+		updateVertexArrays[i].reset();
+		courtBuffers[i].reset();
+	}
+	updateProgram.reset();
+	drawProgram.reset();
+	courtCount = 0;
+}
+
+// tag::resetArena[]
+//the one time the CPU writes the courts - the same starting state and seeds the CPU reference uses
+void GpuArena::reset(int courts)
+{
+	if (updateProgram.get() == 0)
+		return;
+	courtCount = std::max(0, std::min(courts, int(maxCourts)));
+	tickCount = 0;
+
+	GameState state = newGame();
+	std::vector<Court> initial(courtCount);
+	for (int i = 0; i < courtCount; i++)
+	{
+		Court &court = initial[i];
+		std::memcpy(court.position1, glm::value_ptr(state.position1), sizeof(court.position1));
+		std::memcpy(court.velocity1, glm::value_ptr(state.velocity1), sizeof(court.velocity1));
+		std::memcpy(court.position2, glm::value_ptr(state.position2), sizeof(court.position2));
+		std::memcpy(court.velocity2, glm::value_ptr(state.velocity2), sizeof(court.velocity2));
+		std::memcpy(court.ballPosition, glm::value_ptr(state.ballPosition), sizeof(court.ballPosition));
+		std::memcpy(court.ballVelocity, glm::value_ptr(state.ballVelocity), sizeof(court.ballVelocity));
+		court.rotateAngle = state.rotateAngle;
+
+		BatAi ai = newBatAi(arenaCourtSeed(i));
+		court.ai[0] = ai.aimError1;
+		court.ai[1] = ai.aimError2;
+		court.ai[2] = ai.lastBallDirection;
+		court.match[0] = state.redScore;
+		court.match[1] = state.blueScore;
+		court.match[2] = state.gameOver ? 1 : 0;
+		court.match[3] = state.impactCount;
+		court.randomState = ai.randomState;
+	}
+
+	current = 0;
+	glBindBuffer(GL_ARRAY_BUFFER, courtBuffers[current].get());
+	glBufferSubData(GL_ARRAY_BUFFER, 0, courtCount * sizeof(Court), initial.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+// end::resetArena[]
+
+// tag::stepArena[]
+void GpuArena::step(int ticks)
+{
+	if (updateProgram.get() == 0 || courtCount == 0 || ticks <= 0)
+		return;
+
+	glUseProgram(updateProgram.get());
+	glUniform1d(simLengthLocation, arenaTickLength);
+	glEnable(GL_RASTERIZER_DISCARD);
+	for (int tick = 0; tick < ticks; tick++)
+	{
+		//read from the current buffer, write into the other one
+		int next = 1 - current;
+		glBindVertexArray(updateVertexArrays[current].get());
+		glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, courtBuffers[next].get());
+		glBeginTransformFeedback(GL_POINTS);
+		glDrawArrays(GL_POINTS, 0, courtCount);
+		glEndTransformFeedback();
+		current = next;
+	}
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+	glBindVertexArray(0);
+	glDisable(GL_RASTERIZER_DISCARD);
+	glUseProgram(0);
+
+	tickCount += ticks;
+}
+// end::stepArena[]
+
+void GpuArena::readBack(std::vector<GameState> &states, std::vector<BatAi> &ais) const
+{
+	std::vector<Court> courts(courtCount);
+	if (courtCount > 0)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, courtBuffers[current].get());
+		glGetBufferSubData(GL_ARRAY_BUFFER, 0, courtCount * sizeof(Court), courts.data());
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	states.resize(courtCount);
+	ais.resize(courtCount);
+	for (int i = 0; i < courtCount; i++)
+	{
+		const Court &court = courts[i];
+		GameState &state = states[i];
+		std::memcpy(&state.position1.x, court.position1, sizeof(court.position1));
+		std::memcpy(&state.velocity1.x, court.velocity1, sizeof(court.velocity1));
+		std::memcpy(&state.position2.x, court.position2, sizeof(court.position2));
+		std::memcpy(&state.velocity2.x, court.velocity2, sizeof(court.velocity2));
+		std::memcpy(&state.ballPosition.x, court.ballPosition, sizeof(court.ballPosition));
+		std::memcpy(&state.ballVelocity.x, court.ballVelocity, sizeof(court.ballVelocity));
+		state.rotateAngle = court.rotateAngle;
+		state.redScore = court.match[0];
+		state.blueScore = court.match[1];
+		state.gameOver = court.match[2] != 0;
+		state.impactCount = court.match[3]; // recentImpacts aren't kept - nothing draws sparks in the arena
+		state.court = defaultCourtLayout(); // the shader plays the compiled-in court, whatever the scene file says
+
+		ais[i].aimError1 = court.ai[0];
+		ais[i].aimError2 = court.ai[1];
+		ais[i].lastBallDirection = court.ai[2];
+		ais[i].randomState = court.randomState;
+	}
+}
+
+// tag::drawArena[]
+//a vertex array for each part and each of the court buffers - the mesh per vertex, the court's position per instance
+void GpuArena::setMeshes(const Mesh &redBat, const Mesh &blueBat, const Mesh &ball)
+{
+	if (drawProgram.get() == 0)
+		return;
+	releaseDrawArrays();
+	meshes[RED_BAT] = redBat;
+	meshes[BLUE_BAT] = blueBat;
+	meshes[BALL] = ball;
+
+	const size_t partPositions[ARENA_PARTS] = { offsetof(Court, position1), offsetof(Court, position2), offsetof(Court, ballPosition) };
+	const GLsizei stride = 10 * sizeof(GLfloat);
+	GLint positionLocation = glGetAttribLocation(drawProgram.get(), "position");
+	GLint colorLocation = glGetAttribLocation(drawProgram.get(), "vertexColor");
+	GLint normalLocation = glGetAttribLocation(drawProgram.get(), "normal");
+	GLint objectPositionLocation = glGetAttribLocation(drawProgram.get(), "objectPosition");
+	GLint objectAngleLocation = glGetAttribLocation(drawProgram.get(), "objectAngle");
+
+	for (int part = 0; part < ARENA_PARTS; part++)
+	{
+		for (int i = 0; i < 2; i++)
+		{
+			drawVertexArrays[part][i] = GpuVertexArray::create("arena draw");
+			glBindVertexArray(drawVertexArrays[part][i].get());
+			glBindBuffer(GL_ARRAY_BUFFER, meshes[part].vertexBuffer);
+			glEnableVertexAttribArray(positionLocation);
+			glEnableVertexAttribArray(colorLocation);
+			glEnableVertexAttribArray(normalLocation);
+			glVertexAttribPointer(positionLocation, 3, GL_FLOAT, GL_FALSE, stride, (GLvoid *)(0 * sizeof(GLfloat)));
+			glVertexAttribPointer(colorLocation, 4, GL_FLOAT, GL_FALSE, stride, (GLvoid *)(3 * sizeof(GLfloat)));
+			glVertexAttribPointer(normalLocation, 3, GL_FLOAT, GL_FALSE, stride, (GLvoid *)(7 * sizeof(GLfloat)));
+
+			glBindBuffer(GL_ARRAY_BUFFER, courtBuffers[i].get());
+			glEnableVertexAttribArray(objectPositionLocation);
+			glEnableVertexAttribArray(objectAngleLocation);
+			glVertexAttribPointer(objectPositionLocation, 3, GL_FLOAT, GL_FALSE, sizeof(Court), (GLvoid *)partPositions[part]);
+			glVertexAttribPointer(objectAngleLocation, 1, GL_FLOAT, GL_FALSE, sizeof(Court), (GLvoid *)offsetof(Court, rotateAngle));
+			glVertexAttribDivisor(objectPositionLocation, 1);
+			glVertexAttribDivisor(objectAngleLocation, 1);
+		}
+	}
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GpuArena::draw(const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix)
+{
+	if (drawProgram.get() == 0 || courtCount == 0 || drawVertexArrays[0][0].get() == 0)
+		return;
+
+	glUseProgram(drawProgram.get());
+	glUniformMatrix4fv(viewMatrixLocation, 1, false, glm::value_ptr(viewMatrix));
+	glUniformMatrix4fv(projectionMatrixLocation, 1, false, glm::value_ptr(projectionMatrix));
+	glUniform1i(courtColumnsLocation, int(std::ceil(std::sqrt(double(courtCount)))));
+
+	//one instanced draw per part, for every court at once
+	for (int part = 0; part < ARENA_PARTS; part++)
+	{
+		glUniform1i(spinLocation, part == BALL ? 1 : 0);
+		glBindVertexArray(drawVertexArrays[part][current].get());
+		glDrawArraysInstanced(GL_TRIANGLES, meshes[part].first, meshes[part].count, courtCount);
+	}
+	glBindVertexArray(0);
+	glUseProgram(0);
+}
+// end::drawArena[]
+
+// tag::checkGpuArena[]
+bool checkGpuArena(int courtCount, int ticks)
+{
+	GpuArena arena;
+	if (!arena.load((assetDirectory + "arenaUpdateShader.glsl").c_str(), (assetDirectory + "arenaVertexShader.glsl").c_str(), (assetDirectory + "arenaFragmentShader.glsl").c_str()))
+		return false;
+	arena.reset(courtCount);
+	courtCount = arena.courts();
+
+	std::vector<GameState> states(courtCount, newGame());
+	std::vector<BatAi> ais(courtCount);
+	for (int i = 0; i < courtCount; i++)
+		ais[i] = newBatAi(arenaCourtSeed(i));
+
+	//compare every court a few times along the way, so a mismatch is caught near where it started
+	const int checkpoints = 8;
+	std::vector<GameState> gpuStates;
+	std::vector<BatAi> gpuAis;
+	int ticksDone = 0;
+	int mismatches = 0;
+	uint64_t matchesFinished = 0;
+	double cpuSeconds = 0.0, gpuSeconds = 0.0;
+	for (int checkpoint = 1; checkpoint <= checkpoints && mismatches == 0; checkpoint++)
+	{
+		int target = int(int64_t(ticks) * checkpoint / checkpoints);
+
+		auto start = std::chrono::steady_clock::now();
+		arena.step(target - ticksDone);
+		glFinish();
+		gpuSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < courtCount; i++)
+		{
+			for (int tick = ticksDone; tick < target; tick++)
+			{
+				if (states[i].gameOver)
+					matchesFinished++;
+				stepArenaCourt(states[i], ais[i]);
+			}
+		}
+		cpuSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		ticksDone = target;
+
+		//bit for bit - the same operations in the same order should give the same floats
+		arena.readBack(gpuStates, gpuAis);
+		for (int i = 0; i < courtCount; i++)
+		{
+			const GameState &cpu = states[i], &gpu = gpuStates[i];
+			bool same = std::memcmp(glm::value_ptr(cpu.position1), glm::value_ptr(gpu.position1), sizeof(glm::vec3)) == 0
+				&& std::memcmp(glm::value_ptr(cpu.velocity1), glm::value_ptr(gpu.velocity1), sizeof(glm::vec3)) == 0
+				&& std::memcmp(glm::value_ptr(cpu.position2), glm::value_ptr(gpu.position2), sizeof(glm::vec3)) == 0
+				&& std::memcmp(glm::value_ptr(cpu.velocity2), glm::value_ptr(gpu.velocity2), sizeof(glm::vec3)) == 0
+				&& std::memcmp(glm::value_ptr(cpu.ballPosition), glm::value_ptr(gpu.ballPosition), sizeof(glm::vec3)) == 0
+				&& std::memcmp(glm::value_ptr(cpu.ballVelocity), glm::value_ptr(gpu.ballVelocity), sizeof(glm::vec3)) == 0
+				&& std::memcmp(&cpu.rotateAngle, &gpu.rotateAngle, sizeof(float)) == 0
+				&& cpu.redScore == gpu.redScore && cpu.blueScore == gpu.blueScore && cpu.gameOver == gpu.gameOver && cpu.impactCount == gpu.impactCount
+				&& std::memcmp(&ais[i].aimError1, &gpuAis[i].aimError1, sizeof(float)) == 0
+				&& std::memcmp(&ais[i].aimError2, &gpuAis[i].aimError2, sizeof(float)) == 0
+				&& std::memcmp(&ais[i].lastBallDirection, &gpuAis[i].lastBallDirection, sizeof(float)) == 0
+				&& ais[i].randomState == gpuAis[i].randomState;
+			if (!same && mismatches++ < 4)
+			{
+				cerr << "Court " << i << " differs after " << ticksDone << " ticks: ball CPU (" << cpu.ballPosition.x << ", " << cpu.ballPosition.z
+					<< ") GPU (" << gpu.ballPosition.x << ", " << gpu.ballPosition.z << "), score CPU " << cpu.redScore << "-" << cpu.blueScore
+					<< " GPU " << gpu.redScore << "-" << gpu.blueScore << endl;
+			}
+		}
+	}
+	arena.unload();
+
+	cout << "GPU arena check: " << courtCount << " courts, " << ticksDone << " ticks, " << matchesFinished << " matches finished - GPU "
+		<< gpuSeconds * 1000.0 << " ms, CPU " << cpuSeconds * 1000.0 << " ms" << endl;
+	if (mismatches > 0)
+	{
+		cerr << "GPU arena check FAILED: " << mismatches << " courts differ from the CPU reference" << endl;
+		return false;
+	}
+	cout << "GPU arena check passed - every court matches the CPU reference bit for bit" << endl;
+	return true;
+}
+// end::checkGpuArena[]
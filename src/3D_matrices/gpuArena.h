@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+
+#define GLM_FORCE_RADIANS // suppress a warning in GLM 0.9.5
+#include <glm/glm.hpp>
+
+#include "game.h"
+#include "headlessMatch.h"
+#include "gpuResources.h"
+
+// tag::arenaRules[]
+//One court of the arena, advanced by one tick - the CPU reference the GPU arena has to agree with.
+//The bats are steered by the same AI as the headless matches, and a court whose match is over
+//starts a new one on its next tick, so an arena never runs down.
+const double arenaTickLength = 0.02; // seconds, the same as the game's fixed tick
+
+uint32_t arenaCourtSeed(int court); // each court's AI seed - the same as simulateMatches gives match number court
+void stepArenaCourt(GameState &state, BatAi &ai);
+// end::arenaRules[]
+
+// tag::gpuArena[]
+//Thousands of courts at once, with every court's ball and bats living in GPU buffers.
+//
+//  - like the particles, the courts are a pair of vertex buffers, one vertex per court: a tick is a vertex
+//    shader run over every court with transform feedback writing the results into the other buffer,
+//    rasterisation off, and then the two swap
+//  - arenaUpdateShader.glsl is updateSimulation() and steerBats() rewritten in GLSL, down to doing the
+//    comparisons the C++ does in double in double - so the results match the CPU bit for bit (see checkGpuArena)
+//  - draw() reads the bat and ball positions straight out of the latest buffer as instanced attributes,
+//    so nothing is copied back to the CPU
+//  - needs GL 4.0 for doubles and precise - without it, load() fails and the arena is just not there
+class GpuArena
+{
+public:
+	static const int maxCourts = 65536;
+
+	//a range of one of the renderer's vertex buffers - position, colour and normal, 10 floats per vertex
+	struct Mesh
+	{
+		GLuint vertexBuffer;
+		GLint first;
+		GLsizei count;
+	};
+
+	GpuArena();
+
+	bool load(const char *updateShaderPath, const char *vertexShaderPath, const char *fragmentShaderPath); // GL thread only
+	void unload();
+	bool loaded() const { return updateProgram.get() != 0; }
+
+	void reset(int courtCount); // every court at the start of a match, each with its own AI seed
+	void step(int ticks); // one transform feedback pass per tick
+	void readBack(std::vector<GameState> &states, std::vector<BatAi> &ais) const; // waits for the GPU - for checking, not every frame
+
+	void setMeshes(const Mesh &redBat, const Mesh &blueBat, const Mesh &ball);
+	void draw(const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix);
+
+	int courts() const { return courtCount; }
+	uint64_t ticks() const { return tickCount; }
+
+private:
+	GpuArena(const GpuArena &);
+	GpuArena &operator=(const GpuArena &);
+
+	//one court - the update shader's inputs and outputs, in this order
+	struct Court
+	{
+		GLfloat position1[3]; // red bat
+		GLfloat velocity1[3];
+		GLfloat position2[3]; // blue bat
+		GLfloat velocity2[3];
+		GLfloat ballPosition[3];
+		GLfloat ballVelocity[3];
+		GLfloat rotateAngle;
+		GLfloat ai[3]; // BatAi - aimError1, aimError2, lastBallDirection
+		GLuint match[4]; // redScore, blueScore, gameOver, impactCount
+		GLuint randomState;
+	};
+
+	enum { RED_BAT, BLUE_BAT, BALL, ARENA_PARTS };
+
+	void releaseDrawArrays();
+
+	int courtCount;
+	uint64_t tickCount;
+	int current; // which buffer holds the latest state
+
+	GpuProgram updateProgram;
+	GpuProgram drawProgram;
+	GpuBuffer courtBuffers[2];
+	GpuVertexArray updateVertexArrays[2]; // read buffer i in the update pass
+	GpuVertexArray drawVertexArrays[ARENA_PARTS][2]; // draw each part with its instances read from buffer i
+	Mesh meshes[ARENA_PARTS];
+
+	GLint simLengthLocation;
+	GLint viewMatrixLocation, projectionMatrixLocation, courtColumnsLocation, spinLocation;
+};
+// end::gpuArena[]
+
+// tag::checkGpuArena[]
+//steps courtCount courts for ticks ticks on the GPU and on the CPU, and compares every court bit for bit
+//- needs a current GL context
+bool checkGpuArena(int courtCount, int ticks);
+// end::checkGpuArena[]
@@ -0,0 +1,133 @@
+#include "gpuResources.h"
+
+#include <iostream>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+GpuResources gpuResources;
+
+GpuResources::GpuResources() : budgetBytes(0)
+{
+	for (int type = 0; type < GPU_RESOURCE_TYPES; type++)
+	{
+		liveCounts[type] = 0;
+		liveBytes[type] = 0;
+	}
+}
+
+const char *gpuResourceTypeName(GpuResourceType type)
+{
+	switch (type)
+	{
+	case GPU_BUFFER: return "buffer";
+	case GPU_VERTEX_ARRAY: return "vertex array";
+	case GPU_SHADER: return "shader";
+	case GPU_PROGRAM: return "program";
+	default: return "?";
+	}
+}
+
+GLuint createGpuObject(GpuResourceType type)
+{
+	GLuint name = 0;
+	if (type == GPU_BUFFER)
+		glGenBuffers(1, &name);
+	else if (type == GPU_VERTEX_ARRAY)
+		glGenVertexArrays(1, &name);
+	return name;
+}
+
+void deleteGpuObject(GpuResourceType type, GLuint name)
+{
+	switch (type)
+	{
+	case GPU_BUFFER: glDeleteBuffers(1, &name); break;
+	case GPU_VERTEX_ARRAY: glDeleteVertexArrays(1, &name); break;
+	case GPU_SHADER: glDeleteShader(name); break;
+	case GPU_PROGRAM: glDeleteProgram(name); break;
+	default: break;
+	}
+}
+
+// tag::trackGpuResources[]
+uint32_t GpuResources::add(GpuResourceType type, GLuint name, const char *label)
+{
+	Record record;
+	record.type = type;
+	record.name = name;
+	record.label = label;
+	record.bytes = 0;
+	record.live = true;
+	liveCounts[type]++;
+
+	if (!freeSlots.empty())
+	{
+		uint32_t slot = freeSlots.back();
+		freeSlots.pop_back();
+		records[slot] = record;
+		return slot;
+	}
+	records.push_back(record);
+	return uint32_t(records.size() - 1);
+}
+
+void GpuResources::remove(uint32_t slot)
+{
+	Record &record = records[slot];
+	liveCounts[record.type]--;
+	liveBytes[record.type] -= record.bytes;
+	record.live = false;
+	freeSlots.push_back(slot);
+}
+
+void GpuResources::setBytes(uint32_t slot, size_t bytes)
+{
+	Record &record = records[slot];
+	liveBytes[record.type] += bytes - record.bytes;
+	record.bytes = bytes;
+}
+// end::trackGpuResources[]
+
+size_t GpuResources::totalBytes() const
+{
+	size_t total = 0;
+	for (int type = 0; type < GPU_RESOURCE_TYPES; type++)
+		total += liveBytes[type];
+	return total;
+}
+
+void GpuResources::printUsage(const char *heading) const
+{
+	cout << heading << ":";
+	for (int type = 0; type < GPU_RESOURCE_TYPES; type++)
+		cout << " " << liveCounts[type] << " " << gpuResourceTypeName(GpuResourceType(type)) << (liveCounts[type] == 1 ? "" : "s")
+			<< (type == GPU_BUFFER ? " (" + std::to_string(liveBytes[type] / 1024) + " KB)" : "") << (type + 1 < GPU_RESOURCE_TYPES ? "," : "");
+	if (budgetBytes != 0)
+		cout << " - budget " << budgetBytes / 1024 << " KB";
+	cout << endl;
+}
+
+// tag::reportGpuLeaks[]
+int GpuResources::reportLeaks() const
+{
+	int leaks = 0;
+	for (size_t slot = 0; slot < records.size(); slot++)
+	{
+		const Record &record = records[slot];
+		if (!record.live)
+			continue;
+		cerr << "GPU leak: " << gpuResourceTypeName(record.type) << " " << record.name << " (" << record.label << ")";
+		if (record.type == GPU_BUFFER)
+			cerr << ", " << record.bytes << " bytes";
+		cerr << endl;
+		leaks++;
+	}
+	if (leaks == 0)
+		cout << "No GPU resources leaked OK!" << endl;
+	else
+		cerr << leaks << " GPU resources were never released" << endl;
+	return leaks;
+}
+// end::reportGpuLeaks[]
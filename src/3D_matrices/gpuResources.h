@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+
+// tag::gpuResourceTypes[]
+enum GpuResourceType
+{
+	GPU_BUFFER,
+	GPU_VERTEX_ARRAY,
+	GPU_SHADER,
+	GPU_PROGRAM,
+	GPU_RESOURCE_TYPES
+};
+// end::gpuResourceTypes[]
+
+// tag::gpuResources[]
+//Every buffer, vertex array, shader and program the game creates is registered here, by the handle that owns it
+//(see GpuHandle below), so we know at any time how many of each are alive and how many bytes the buffers hold.
+//
+//  - the budget is for buffer bytes - the driver doesn't tell us what a vertex array, shader or program costs,
+//    so those are only counted. 0 means no budget. Only things that can be streamed back in (the mesh levels,
+//    see MeshStreamer) are evicted to stay under it
+//  - anything still registered at shutdown, after everything has been unloaded, is a leak - reportLeaks() lists it
+//  - GL thread only, like the objects themselves
+class GpuResources
+{
+public:
+	GpuResources();
+
+	uint32_t add(GpuResourceType type, GLuint name, const char *label); // label must outlive the resource - a string literal
+	void remove(uint32_t slot);
+	void setBytes(uint32_t slot, size_t bytes);
+
+	int count(GpuResourceType type) const { return liveCounts[type]; }
+	size_t bytes(GpuResourceType type) const { return liveBytes[type]; }
+	size_t totalBytes() const;
+
+	void setBudget(size_t bytes) { budgetBytes = bytes; }
+	size_t budget() const { return budgetBytes; }
+	bool overBudget(size_t extraBytes = 0) const { return budgetBytes != 0 && totalBytes() + extraBytes > budgetBytes; }
+
+	void printUsage(const char *heading) const;
+	int reportLeaks() const; // lists every resource still alive, and returns how many there are
+
+private:
+	struct Record
+	{
+		GpuResourceType type;
+		GLuint name;
+		const char *label;
+		size_t bytes;
+		bool live;
+	};
+
+	std::vector<Record> records;
+	std::vector<uint32_t> freeSlots; // records to reuse, so creating and deleting in a loop doesn't grow the list
+	int liveCounts[GPU_RESOURCE_TYPES];
+	size_t liveBytes[GPU_RESOURCE_TYPES];
+	size_t budgetBytes;
+};
+
+extern GpuResources gpuResources;
+
+const char *gpuResourceTypeName(GpuResourceType type);
+GLuint createGpuObject(GpuResourceType type); // buffers and vertex arrays - shaders and programs are adopted from createShader/createProgram
+void deleteGpuObject(GpuResourceType type, GLuint name);
+// end::gpuResources[]
+
+// tag::gpuHandle[]
+//Owns one GL object: deletes it when the handle goes out of scope or is reset, and keeps gpuResources up to date.
+//Handles can be moved but not copied, so there is only ever one owner.
+template <GpuResourceType type>
+class GpuHandle
+{
+public:
+	GpuHandle() : name(0), slot(0) {}
+	~GpuHandle() { reset(); }
+
+	GpuHandle(GpuHandle &&other) noexcept : name(other.name), slot(other.slot) { other.name = 0; }
+	GpuHandle &operator=(GpuHandle &&other) noexcept
+	{
+		if (this != &other)
+		{
+			reset();
+			name = other.name;
+			slot = other.slot;
+			other.name = 0;
+		}
+		return *this;
+	}
+
+	static GpuHandle create(const char *label) { return adopt(createGpuObject(type), label); }
+	static GpuHandle adopt(GLuint name, const char *label) // takes ownership of an object made some other way
+	{
+		GpuHandle handle;
+		handle.name = name;
+		if (name != 0)
+			handle.slot = gpuResources.add(type, name, label);
+		return handle;
+	}
+
+	GLuint get() const { return name; }
+	void reset()
+	{
+		if (name == 0)
+			return;
+		deleteGpuObject(type, name);
+		gpuResources.remove(slot);
+		name = 0;
+	}
+
+	//buffers only - glBufferData on the buffer bound to target, which must be this one, and count the bytes
+	void upload(GLenum target, size_t bytes, const void *data, GLenum usage)
+	{
+		glBufferData(target, GLsizeiptr(bytes), data, usage);
+		if (name != 0)
+			gpuResources.setBytes(slot, bytes);
+	}
+
+	GpuHandle(const GpuHandle &) = delete;
+	GpuHandle &operator=(const GpuHandle &) = delete;
+
+private:
+	GLuint name;
+	uint32_t slot;
+};
+
+typedef GpuHandle<GPU_BUFFER> GpuBuffer;
+typedef GpuHandle<GPU_VERTEX_ARRAY> GpuVertexArray;
+typedef GpuHandle<GPU_SHADER> GpuShader;
+typedef GpuHandle<GPU_PROGRAM> GpuProgram;
+// end::gpuHandle[]
@@ -0,0 +1,108 @@
+#include "headlessMatch.h"
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+static float randomFloat(uint32_t &randomState, float low, float high)
+{
+	randomState = randomState * 1664525u + 1013904223u; //LCG - deterministic across compilers, unlike std::rand
+	return low + (high - low) * float(randomState >> 8) / float(1 << 24);
+}
+
+BatAi newBatAi(uint32_t seed)
+{
+	BatAi ai;
+	ai.randomState = seed;
+	ai.aimError1 = 0.0f;
+	ai.aimError2 = 0.0f;
+	ai.lastBallDirection = 0.0f;
+	return ai;
+}
+
+static float steerTowards(float batX, float targetX)
+{
+	const float batSpeed = 3.0f;
+	if (targetX > batX + 0.05f)
+		return batSpeed;
+	if (targetX < batX - 0.05f)
+		return -batSpeed;
+	return 0.0f;
+}
+
+void steerBats(GameState &state, BatAi &ai)
+{
+	if (state.ballVelocity.z != ai.lastBallDirection)
+	{
+		ai.lastBallDirection = state.ballVelocity.z;
+		ai.aimError1 = randomFloat(ai.randomState, -0.9f, 0.9f);
+		ai.aimError2 = randomFloat(ai.randomState, -0.9f, 0.9f);
+	}
+	state.velocity1.x = steerTowards(state.position1.x, state.ballPosition.x + ai.aimError1);
+	state.velocity2.x = steerTowards(state.position2.x, state.ballPosition.x + ai.aimError2);
+}
+
+uint64_t playHeadlessMatch(uint32_t seed, MatchEventWriter *events)
+{
+	const uint64_t maxTicks = 1000000; // in case a change to the rules makes a rally endless
+	GameState state = newGame();
+	BatAi ai = newBatAi(seed);
+	uint64_t ticks = 0;
+	while (!state.gameOver && ticks < maxTicks)
+	{
+		steerBats(state, ai);
+		updateSimulation(state, headlessTickLength, events);
+		ticks++;
+	}
+	return ticks;
+}
+
+// tag::simulateMatches[]
+bool simulateMatches(uint64_t count, const std::string &filePath, int threadCount)
+{
+	MatchEventLog log;
+	if (!log.open(filePath))
+		return false;
+
+	threadCount = std::max(1, threadCount);
+	cout << "Simulating " << count << " matches on " << threadCount << " threads, appending events to " << filePath << endl;
+	auto start = std::chrono::steady_clock::now();
+
+	//threads take matches in small batches, so they all finish at about the same time
+	const uint64_t batchSize = 256;
+	std::atomic<uint64_t> nextMatch(0);
+	std::atomic<uint64_t> totalTicks(0);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < threadCount; t++)
+	{
+		threads.push_back(std::thread([&]() {
+			MatchEventWriter writer(log); // one per thread - only whole blocks meet in the log
+			uint64_t ticks = 0;
+			for (uint64_t first = nextMatch.fetch_add(batchSize); first < count; first = nextMatch.fetch_add(batchSize))
+			{
+				for (uint64_t match = first; match < std::min(first + batchSize, count); match++)
+				{
+					writer.beginMatch(match, defaultCourtLayout().halfWidth, headlessTickLength);
+					ticks += playHeadlessMatch(uint32_t(match * 2654435761u + 12345u), &writer); // a different rally for every match
+				}
+			}
+			totalTicks += ticks;
+		}));
+	}
+	for (std::thread &thread : threads)
+		thread.join();
+	log.close();
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	cout << count << " matches, " << totalTicks.load() << " ticks and " << log.events() << " events in " << seconds << " s ("
+		<< (seconds > 0.0 ? double(count) / seconds : 0.0) << " matches/s), " << log.bytes() << " bytes written" << endl;
+	return true;
+}
+// end::simulateMatches[]
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "game.h"
+#include "matchEvents.h"
+
+// tag::batAi[]
+//Both bats chase the ball, aiming a little off it. A new aiming error is picked every time the
+//ball changes direction; when it is bigger than the bat's reach the shot is missed, so matches finish.
+struct BatAi
+{
+	uint32_t randomState;
+	float aimError1;
+	float aimError2;
+	float lastBallDirection;
+};
+
+BatAi newBatAi(uint32_t seed = 12345);
+void steerBats(GameState &state, BatAi &ai);
+// end::batAi[]
+
+// tag::headlessMatch[]
+const double headlessTickLength = 0.02; // seconds, the same as the game's fixed tick
+
+//plays one match to the end on the default court, with no window - returns the number of ticks it took
+uint64_t playHeadlessMatch(uint32_t seed = 12345, MatchEventWriter *events = nullptr);
+
+//plays matches [0, count) across several threads, each with its own writer, appending every event to filePath
+bool simulateMatches(uint64_t count, const std::string &filePath, int threadCount);
+// end::headlessMatch[]
@@ -0,0 +1,12 @@
+#version 330
+in vec2 fragmentTexCoord;
+in vec4 fragmentColor;
+out vec4 outputColor;
+
+uniform sampler2D glyphAtlas; // coverage in the red channel - solid quads use a fully covered cell
+
+void main()
+{
+	float coverage = texture(glyphAtlas, fragmentTexCoord).r;
+	outputColor = vec4(fragmentColor.rgb, fragmentColor.a * coverage);
+}
@@ -0,0 +1,307 @@
+#include "hudLayer.h"
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstddef>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "renderer.h"
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+// tag::glyphs[]
+//a 5x7 font - one byte per row, the low 5 bits are the pixels, left to right
+//lower case letters are drawn with the upper case glyphs, anything missing is drawn as a space
+struct Glyph
+{
+	char character;
+	uint8_t rows[7];
+};
+
+static const Glyph glyphs[] = {
+	{ '0', { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E } },
+	{ '1', { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+	{ '2', { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F } },
+	{ '3', { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E } },
+	{ '4', { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 } },
+	{ '5', { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E } },
+	{ '6', { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E } },
+	{ '7', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 } },
+	{ '8', { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E } },
+	{ '9', { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C } },
+	{ 'A', { 0x0E, 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11 } },
+	{ 'B', { 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E } },
+	{ 'C', { 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E } },
+	{ 'D', { 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C } },
+	{ 'E', { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F } },
+	{ 'F', { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 } },
+	{ 'G', { 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F } },
+	{ 'H', { 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 } },
+	{ 'I', { 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+	{ 'J', { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C } },
+	{ 'K', { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 } },
+	{ 'L', { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F } },
+	{ 'M', { 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 } },
+	{ 'N', { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 } },
+	{ 'O', { 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E } },
+	{ 'P', { 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 } },
+	{ 'Q', { 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D } },
+	{ 'R', { 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 } },
+	{ 'S', { 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E } },
+	{ 'T', { 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 } },
+	{ 'U', { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E } },
+	{ 'V', { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 } },
+	{ 'W', { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A } },
+	{ 'X', { 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 } },
+	{ 'Y', { 0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04 } },
+	{ 'Z', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F } },
+	{ '.', { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C } },
+	{ ',', { 0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08 } },
+	{ ':', { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 } },
+	{ '-', { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 } },
+	{ '+', { 0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00 } },
+	{ '=', { 0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00 } },
+	{ '/', { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 } },
+	{ '%', { 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 } },
+	{ '(', { 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02 } },
+	{ ')', { 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08 } },
+	{ '!', { 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04 } },
+	{ '?', { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 } },
+	{ '_', { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F } },
+};
+// end::glyphs[]
+
+//the atlas is a 16x8 grid of 8x8 pixel cells, one per ASCII code
+static const int atlasCellSize = 8;
+static const int atlasColumns = 16;
+static const int atlasRows = 8;
+static const int atlasWidth = atlasColumns * atlasCellSize;
+static const int atlasHeight = atlasRows * atlasCellSize;
+static const int glyphWidth = 5;
+static const int glyphHeight = 7;
+static const char solidCell = 127; // DEL has no glyph, so its cell is filled in for the solid quads
+
+HudLayer::HudLayer() : vertices(nullptr), quads(0), overflowReported(false), viewportWidth(1), viewportHeight(1),
+	projectionMatrixLocation(-1), glyphAtlasLocation(-1), atlasTexture(0)
+{
+}
+
+HudLayer::~HudLayer()
+{
+	delete[] vertices;
+}
+
+// tag::createGlyphAtlas[]
+void HudLayer::createGlyphAtlas()
+{
+	std::vector<GLubyte> pixels(atlasWidth * atlasHeight, 0);
+	for (size_t g = 0; g < sizeof(glyphs) / sizeof(glyphs[0]); g++)
+	{
+		int cellX = (glyphs[g].character % atlasColumns) * atlasCellSize;
+		int cellY = (glyphs[g].character / atlasColumns) * atlasCellSize;
+		for (int row = 0; row < glyphHeight; row++)
+			for (int column = 0; column < glyphWidth; column++)
+				if (glyphs[g].rows[row] & (0x10 >> column))
+					pixels[(cellY + row) * atlasWidth + cellX + column] = 255;
+	}
+	int solidX = (solidCell % atlasColumns) * atlasCellSize;
+	int solidY = (solidCell / atlasColumns) * atlasCellSize;
+	for (int row = 0; row < atlasCellSize; row++)
+		std::memset(&pixels[(solidY + row) * atlasWidth + solidX], 255, atlasCellSize);
+
+	glGenTextures(1, &atlasTexture);
+	glBindTexture(GL_TEXTURE_2D, atlasTexture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, atlasWidth, atlasHeight, 0, GL_RED, GL_UNSIGNED_BYTE, pixels.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST); // crisp pixels at whole number scales
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+// end::createGlyphAtlas[]
+
+// tag::loadHud[]
+bool HudLayer::load(const char *vertexShaderPath, const char *fragmentShaderPath)
+{
+	std::vector<GpuShader> shaderList;
+	shaderList.push_back(createShader(GL_VERTEX_SHADER, loadShader(vertexShaderPath)));
+	shaderList.push_back(createShader(GL_FRAGMENT_SHADER, loadShader(fragmentShaderPath)));
+	program = createProgram(shaderList, std::vector<const char *>(), "HUD program");
+	if (program.get() == 0)
+	{
+		cerr << "HUD GLSL program creation error." << endl;
+		return false;
+	}
+
+	GLint positionLocation = glGetAttribLocation(program.get(), "position");
+	GLint texCoordLocation = glGetAttribLocation(program.get(), "texCoord");
+	GLint vertexColorLocation = glGetAttribLocation(program.get(), "vertexColor");
+	projectionMatrixLocation = glGetUniformLocation(program.get(), "projectionMatrix");
+	glyphAtlasLocation = glGetUniformLocation(program.get(), "glyphAtlas");
+
+	createGlyphAtlas();
+
+	vertices = new HudVertex[maxQuads * 4];
+
+	//the index buffer never changes - two triangles per quad
+	std::vector<GLushort> indices(maxQuads * 6);
+	for (size_t q = 0; q < maxQuads; q++)
+	{
+		GLushort first = GLushort(q * 4);
+		GLushort quadIndices[6] = { first, GLushort(first + 1), GLushort(first + 2), first, GLushort(first + 2), GLushort(first + 3) };
+		std::memcpy(&indices[q * 6], quadIndices, sizeof(quadIndices));
+	}
+
+	vertexArrayObject = GpuVertexArray::create("HUD");
+	glBindVertexArray(vertexArrayObject.get());
+
+		vertexBufferObject = GpuBuffer::create("HUD vertices");
+		glBindBuffer(GL_ARRAY_BUFFER, vertexBufferObject.get());
+		vertexBufferObject.upload(GL_ARRAY_BUFFER, maxQuads * 4 * sizeof(HudVertex), nullptr, GL_STREAM_DRAW);
+
+		indexBufferObject = GpuBuffer::create("HUD indices");
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferObject.get());
+		indexBufferObject.upload(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), indices.data(), GL_STATIC_DRAW);
+
+		glEnableVertexAttribArray(positionLocation);
+		glEnableVertexAttribArray(texCoordLocation);
+		glEnableVertexAttribArray(vertexColorLocation);
+		glVertexAttribPointer(positionLocation, 2, GL_FLOAT, GL_FALSE, sizeof(HudVertex), (GLvoid *)offsetof(HudVertex, x));
+		glVertexAttribPointer(texCoordLocation, 2, GL_FLOAT, GL_FALSE, sizeof(HudVertex), (GLvoid *)offsetof(HudVertex, u));
+		glVertexAttribPointer(vertexColorLocation, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(HudVertex), (GLvoid *)offsetof(HudVertex, color));
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	cout << "HUD layer created OK! " << maxQuads << " quads, glyph atlas " << atlasWidth << "x" << atlasHeight << endl;
+	return true;
+}
+// end::loadHud[]
+
+void HudLayer::unload()
+{
+	vertexArrayObject.reset();
+	vertexBufferObject.reset();
+	indexBufferObject.reset();
+	glDeleteTextures(1, &atlasTexture);
+	program.reset();
+	atlasTexture = 0;
+	delete[] vertices;
+	vertices = nullptr;
+}
+
+void HudLayer::begin(int width, int height)
+{
+	quads = 0;
+	viewportWidth = width;
+	viewportHeight = height;
+}
+
+void HudLayer::addTexturedQuad(float x, float y, float width, float height, float u0, float v0, float u1, float v1, const uint8_t color[4])
+{
+	if (vertices == nullptr)
+		return;
+	if (quads == maxQuads)
+	{
+		if (!overflowReported)
+			cerr << "HUD layer is full (" << maxQuads << " quads) - the rest of the HUD is not drawn" << endl;
+		overflowReported = true;
+		return;
+	}
+
+	HudVertex *quad = &vertices[quads * 4];
+	const float corners[4][4] = {
+		{ x,         y,          u0, v0 },
+		{ x + width, y,          u1, v0 },
+		{ x + width, y + height, u1, v1 },
+		{ x,         y + height, u0, v1 },
+	};
+	for (int i = 0; i < 4; i++)
+	{
+		quad[i].x = corners[i][0];
+		quad[i].y = corners[i][1];
+		quad[i].u = corners[i][2];
+		quad[i].v = corners[i][3];
+		std::memcpy(quad[i].color, color, 4);
+	}
+	quads++;
+}
+
+void HudLayer::addQuad(float x, float y, float width, float height, const uint8_t color[4])
+{
+	//every corner samples the middle of the solid cell
+	float u = ((solidCell % atlasColumns) * atlasCellSize + atlasCellSize * 0.5f) / atlasWidth;
+	float v = ((solidCell / atlasColumns) * atlasCellSize + atlasCellSize * 0.5f) / atlasHeight;
+	addTexturedQuad(x, y, width, height, u, v, u, v, color);
+}
+
+// tag::addText[]
+float HudLayer::addText(float x, float y, float scale, const char *text, const uint8_t color[4])
+{
+	float startX = x;
+	const float advance = (glyphWidth + 1) * scale;
+	for (const char *c = text; *c != '\0'; c++)
+	{
+		if (*c == '\n')
+		{
+			x = startX;
+			y += lineHeight(scale);
+			continue;
+		}
+		char character = (*c >= 'a' && *c <= 'z') ? char(*c - 'a' + 'A') : *c;
+		if (character > ' ' && character < solidCell)
+		{
+			float u0 = float((character % atlasColumns) * atlasCellSize) / atlasWidth;
+			float v0 = float((character / atlasColumns) * atlasCellSize) / atlasHeight;
+			float u1 = u0 + float(glyphWidth) / atlasWidth;
+			float v1 = v0 + float(glyphHeight) / atlasHeight;
+			addTexturedQuad(x, y, glyphWidth * scale, glyphHeight * scale, u0, v0, u1, v1, color);
+		}
+		x += advance;
+	}
+	return x;
+}
+// end::addText[]
+
+// tag::drawHud[]
+void HudLayer::draw()
+{
+	if (quads == 0 || program.get() == 0)
+		return;
+
+	glUseProgram(program.get());
+	glm::mat4 projectionMatrix = glm::ortho(0.0f, float(viewportWidth), float(viewportHeight), 0.0f); // y down, like the screen
+	glUniformMatrix4fv(projectionMatrixLocation, 1, false, glm::value_ptr(projectionMatrix));
+	glUniform1i(glyphAtlasLocation, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, atlasTexture);
+
+	//orphan the buffer, so we never wait for the GPU to finish with last frame's HUD, then upload this frame's
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBufferObject.get());
+	glBufferData(GL_ARRAY_BUFFER, maxQuads * 4 * sizeof(HudVertex), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, quads * 4 * sizeof(HudVertex), vertices);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	glBindVertexArray(vertexArrayObject.get());
+	glDrawElements(GL_TRIANGLES, GLsizei(quads * 6), GL_UNSIGNED_SHORT, (GLvoid *)0); // the whole HUD, in one draw
+
+	glBindVertexArray(0);
+	glDisable(GL_BLEND);
+	glEnable(GL_DEPTH_TEST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glUseProgram(0);
+}
+// end::drawHud[]
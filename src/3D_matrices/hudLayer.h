@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <GL/glew.h>
+
+#include "gpuResources.h"
+
+// tag::hudLayer[]
+//A 2D overlay, drawn over the 3D scene with its own orthographic projection, in pixels.
+//
+//  - every quad (solid blocks and text alike) goes into one vertex array on the CPU during the frame
+//  - draw() streams the whole array into one dynamic vertex buffer and submits it with a single
+//    glDrawElements - so the HUD costs one draw call however much we show
+//  - text comes from a small built-in 5x7 font, packed into a glyph atlas texture at load time;
+//    solid quads sample a fully covered cell of the same atlas, so they need no state change
+class HudLayer
+{
+public:
+	static const size_t maxQuads = 4096;
+
+	HudLayer();
+	~HudLayer();
+
+	bool load(const char *vertexShaderPath, const char *fragmentShaderPath); // GL thread only
+	void unload();
+
+	void begin(int width, int height); // start a new frame - coordinates are pixels, from the top left
+	void addQuad(float x, float y, float width, float height, const uint8_t color[4]);
+	float addText(float x, float y, float scale, const char *text, const uint8_t color[4]); // returns the x after the text
+	void draw(); // one upload, one draw call
+
+	size_t quadCount() const { return quads; }
+	static float lineHeight(float scale) { return 9.0f * scale; }
+
+private:
+	HudLayer(const HudLayer &);
+	HudLayer &operator=(const HudLayer &);
+
+	struct HudVertex
+	{
+		GLfloat x, y;
+		GLfloat u, v;
+		GLubyte color[4];
+	};
+
+	void addTexturedQuad(float x, float y, float width, float height, float u0, float v0, float u1, float v1, const uint8_t color[4]);
+	void createGlyphAtlas();
+
+	HudVertex *vertices; // 4 per quad, allocated once in load()
+	size_t quads;
+	bool overflowReported;
+	int viewportWidth;
+	int viewportHeight;
+
+	GpuProgram program;
+	GLint projectionMatrixLocation;
+	GLint glyphAtlasLocation;
+	GLuint atlasTexture;
+	GpuBuffer vertexBufferObject;
+	GpuBuffer indexBufferObject;
+	GpuVertexArray vertexArrayObject;
+};
+// end::hudLayer[]
@@ -0,0 +1,15 @@
+#version 330
+in vec2 position; // pixels, origin at the top left
+in vec2 texCoord;
+in vec4 vertexColor;
+out vec2 fragmentTexCoord;
+out vec4 fragmentColor;
+
+uniform mat4 projectionMatrix = mat4(1.0);
+
+void main()
+{
+		gl_Position = projectionMatrix * vec4(position, 0.0, 1.0);
+		fragmentTexCoord = texCoord;
+		fragmentColor = vertexColor;
+}
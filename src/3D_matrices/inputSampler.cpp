@@ -0,0 +1,97 @@
+#include "inputSampler.h"
+
+#include <iostream>
+#include <chrono>
+
+using std::cerr;
+using std::endl;
+
+InputSampler::InputSampler() : dropped(0), sampled(0), lastEvent(0), windowChanged(false), waiting(false)
+{
+}
+
+void InputSampler::start()
+{
+	SDL_SetEventFilter(&InputSampler::filterEvent, this);
+}
+
+void InputSampler::stop()
+{
+	SDL_SetEventFilter(nullptr, nullptr);
+}
+
+void InputSampler::pump()
+{
+	SDL_PumpEvents(); // calls filterEvent for every new event, on this thread
+	markSampled();
+}
+
+void InputSampler::markSampled()
+{
+	{
+		std::lock_guard<std::mutex> lock(sampleMutex);
+		sampled.store(SDL_GetPerformanceCounter(), std::memory_order_release); // anything that arrives later gets a later timestamp
+	}
+	sampleCondition.notify_all();
+}
+
+// tag::waitForEvents[]
+//SDL_WaitEventTimeout only wakes for an event that reaches SDL's queue, and filterEvent normally keeps
+//everything out of it - so while we wait, it lets the events through as well as queueing them for us,
+//and they are thrown away afterwards
+bool InputSampler::waitForEvents(int timeoutMs)
+{
+	waiting.store(true);
+	bool woken = SDL_WaitEventTimeout(nullptr, timeoutMs) == 1;
+	waiting.store(false);
+	SDL_FlushEvents(SDL_FIRSTEVENT, SDL_LASTEVENT); // already queued for the simulation - these were only the alarm clock
+	markSampled();
+	return woken;
+}
+// end::waitForEvents[]
+
+bool InputSampler::waitForSample(Uint64 until, int timeoutMs)
+{
+	std::unique_lock<std::mutex> lock(sampleMutex);
+	return sampleCondition.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this, until] { return sampled.load(std::memory_order_acquire) >= until; });
+}
+
+// tag::filterEvent[]
+int SDLCALL InputSampler::filterEvent(void *userdata, SDL_Event *event)
+{
+	InputSampler *sampler = static_cast<InputSampler *>(userdata);
+
+	InputEvent input;
+	input.timestamp = SDL_GetPerformanceCounter();
+	input.key = 0;
+	switch (event->type)
+	{
+	case SDL_QUIT:
+		input.type = INPUT_QUIT;
+		break;
+	case SDL_KEYDOWN:
+	case SDL_KEYUP:
+		if (event->key.repeat)
+			return 0; // we ignore key-repeat events
+		input.type = (event->type == SDL_KEYDOWN) ? INPUT_KEY_DOWN : INPUT_KEY_UP;
+		input.key = event->key.keysym.sym;
+		break;
+	case SDL_WINDOWEVENT:
+		//the window needs drawing again, even if nothing in the game has changed
+		if (event->window.event == SDL_WINDOWEVENT_EXPOSED || event->window.event == SDL_WINDOWEVENT_SIZE_CHANGED
+			|| event->window.event == SDL_WINDOWEVENT_SHOWN || event->window.event == SDL_WINDOWEVENT_RESTORED)
+		{
+			sampler->windowChanged.store(true);
+			return sampler->waiting.load() ? 1 : 0;
+		}
+		return 0;
+	default:
+		return 0; // nothing else is used - drop it, rather than let SDL's queue fill up
+	}
+
+	if (!sampler->queue.push(input) && sampler->dropped.fetch_add(1, std::memory_order_relaxed) == 0)
+		cerr << "Input queue is full - events are being dropped" << endl;
+	sampler->lastEvent.store(input.timestamp, std::memory_order_release);
+	return sampler->waiting.load() ? 1 : 0;
+}
+// end::filterEvent[]
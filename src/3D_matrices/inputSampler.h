@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <condition_variable>
+
+#include <SDL2/SDL.h>
+
+#include "spscQueue.h"
+
+// tag::inputEvent[]
+enum InputEventType
+{
+	INPUT_KEY_DOWN,
+	INPUT_KEY_UP,
+	INPUT_QUIT
+};
+
+struct InputEvent
+{
+	Uint64 timestamp; // SDL_GetPerformanceCounter() when SDL received the event
+	InputEventType type;
+	SDL_Keycode key;
+};
+// end::inputEvent[]
+
+// tag::inputSampler[]
+//Timestamps input events as SDL receives them, and queues them for the simulation.
+//
+//  - an SDL event filter sees every event as it is pumped, stamps it with the high resolution
+//    counter and pushes it into a lock-free single-producer/single-consumer queue
+//  - SDL only lets the thread that created the window pump events, so that thread is the producer;
+//    pump() can be called several times a frame, so timestamps stay close to the key press even
+//    when rendering is slow
+//  - the consumer drains the queue in timestamp order, applying each event at the tick it falls in;
+//    sampledUntil() tells it how far the queue is complete, so it never runs a tick too early
+//  - nothing is left in SDL's own queue, so SDL_PollEvent is not needed
+//  - when there's nothing to draw, waitForEvents() sleeps in SDL until an event arrives - while it
+//    waits, the events we use are let into SDL's queue too, just so they wake it up
+class InputSampler
+{
+public:
+	InputSampler();
+
+	void start(); // installs the event filter - call after SDL_Init
+	void stop();
+
+	void pump(); // window thread only
+	bool waitForEvents(int timeoutMs); // window thread only - sleeps until an event arrives (true) or the time is up (false), then pumps
+	Uint64 sampledUntil() const { return sampled.load(std::memory_order_acquire); } // every event before this time has been queued
+	bool waitForSample(Uint64 until, int timeoutMs); // blocks until sampledUntil() reaches until - false if the time ran out first
+	Uint64 lastEventTime() const { return lastEvent.load(std::memory_order_acquire); } // the timestamp of the newest event queued
+	bool takeWindowChanged() { return windowChanged.exchange(false); } // was the window exposed or resized since the last call?
+
+	SpscQueue<InputEvent, 1024> &events() { return queue; }
+	uint64_t droppedEvents() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+	static int SDLCALL filterEvent(void *userdata, SDL_Event *event);
+	void markSampled();
+
+	SpscQueue<InputEvent, 1024> queue;
+	std::atomic<uint64_t> dropped; // events lost because the consumer fell behind
+	std::atomic<Uint64> sampled;
+	std::atomic<Uint64> lastEvent;
+	std::atomic<bool> windowChanged;
+	std::atomic<bool> waiting; // inside waitForEvents - let events through to SDL, so they end the wait
+
+	std::mutex sampleMutex; // only so waitForSample can sleep until the next pump
+	std::condition_variable sampleCondition;
+};
+// end::inputSampler[]
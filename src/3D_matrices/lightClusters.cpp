@@ -0,0 +1,208 @@
+#include "lightClusters.h"
+
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+LightClusters::LightClusters() : gridX(0), gridY(0), gridSlices(0), nearPlane(0.1f), farPlane(100.0f), lights(0), indices(0),
+	maxClusterLights(0), overflowReported(false), lightTexture(0), clusterTexture(0), indexTexture(0), locationsProgram(0)
+{
+	lightData.resize(maxLights * 2);
+	lightRanges.resize(maxLights);
+	lightIndices.resize(maxLightIndices);
+	setGrid(16, 9, 24);
+}
+
+void LightClusters::setGrid(int tilesX, int tilesY, int slices)
+{
+	gridX = std::max(1, tilesX);
+	gridY = std::max(1, tilesY);
+	gridSlices = std::max(1, slices);
+	clusterData.assign(gridX * gridY * gridSlices * 2, 0);
+	clusterFill.assign(gridX * gridY * gridSlices, 0);
+}
+
+//slices are spaced exponentially, so near and far clusters cover a similar amount of the screen's depth range
+int LightClusters::sliceForDepth(float depth) const
+{
+	if (depth <= nearPlane)
+		return 0;
+	int slice = int(std::log(depth / nearPlane) / std::log(farPlane / nearPlane) * gridSlices);
+	return std::min(slice, gridSlices - 1);
+}
+
+// tag::assignLights[]
+void LightClusters::assign(const PointLight *sceneLights, int lightCount, const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix, float nearPlane, float farPlane)
+{
+	this->nearPlane = nearPlane;
+	this->farPlane = farPlane;
+	lights = std::min(lightCount, int(maxLights));
+	std::fill(clusterData.begin(), clusterData.end(), 0);
+
+	//find the block of clusters each light's sphere touches, and count the lights in each cluster
+	for (int l = 0; l < lights; l++)
+	{
+		const PointLight &light = sceneLights[l];
+		glm::vec3 center = glm::vec3(viewMatrix * glm::vec4(light.position, 1.0f));
+		lightData[l * 2] = glm::vec4(center, light.radius);
+		lightData[l * 2 + 1] = glm::vec4(light.color, 0.0f);
+
+		ClusterRange &range = lightRanges[l];
+		range.firstSlice = 1; // hidden until shown otherwise
+		range.lastSlice = 0;
+
+		float closest = -center.z - light.radius; // the camera looks down -z
+		float furthest = -center.z + light.radius;
+		if (furthest < nearPlane || closest > farPlane)
+			continue;
+
+		//screen bounds of the sphere, from the corners of its bounding box
+		//a sphere that reaches the near plane could cover any part of the screen
+		glm::vec2 low(-1.0f), high(1.0f);
+		if (closest > nearPlane)
+		{
+			low = glm::vec2(1.0f);
+			high = glm::vec2(-1.0f);
+			for (int corner = 0; corner < 8; corner++)
+			{
+				glm::vec3 offset((corner & 1) ? light.radius : -light.radius, (corner & 2) ? light.radius : -light.radius, (corner & 4) ? light.radius : -light.radius);
+				glm::vec4 clip = projectionMatrix * glm::vec4(center + offset, 1.0f);
+				glm::vec2 ndc = glm::vec2(clip) / clip.w;
+				low = glm::min(low, ndc);
+				high = glm::max(high, ndc);
+			}
+			if (high.x < -1.0f || high.y < -1.0f || low.x > 1.0f || low.y > 1.0f)
+				continue;
+		}
+
+		range.firstX = glm::clamp(int((low.x * 0.5f + 0.5f) * gridX), 0, gridX - 1);
+		range.lastX = glm::clamp(int((high.x * 0.5f + 0.5f) * gridX), 0, gridX - 1);
+		range.firstY = glm::clamp(int((low.y * 0.5f + 0.5f) * gridY), 0, gridY - 1);
+		range.lastY = glm::clamp(int((high.y * 0.5f + 0.5f) * gridY), 0, gridY - 1);
+		range.firstSlice = sliceForDepth(closest);
+		range.lastSlice = sliceForDepth(furthest);
+
+		for (int z = range.firstSlice; z <= range.lastSlice; z++)
+			for (int y = range.firstY; y <= range.lastY; y++)
+				for (int x = range.firstX; x <= range.lastX; x++)
+					clusterData[((z * gridY + y) * gridX + x) * 2 + 1]++;
+	}
+
+	//turn the counts into offsets into the index list - clusters that don't fit lose their lights
+	size_t offset = 0;
+	maxClusterLights = 0;
+	for (size_t c = 0; c < clusterFill.size(); c++)
+	{
+		GLuint count = clusterData[c * 2 + 1];
+		if (offset + count > maxLightIndices)
+		{
+			if (!overflowReported)
+				cerr << "Too many lights per cluster - only " << maxLightIndices << " light references fit, some lights are not drawn" << endl;
+			overflowReported = true;
+			count = GLuint(maxLightIndices - offset);
+		}
+		clusterData[c * 2] = GLuint(offset);
+		clusterData[c * 2 + 1] = count;
+		clusterFill[c] = 0;
+		offset += count;
+		maxClusterLights = std::max(maxClusterLights, count);
+	}
+	indices = offset;
+
+	//then write each light into the lists of the clusters it touches
+	for (int l = 0; l < lights; l++)
+	{
+		const ClusterRange &range = lightRanges[l];
+		for (int z = range.firstSlice; z <= range.lastSlice; z++)
+			for (int y = range.firstY; y <= range.lastY; y++)
+				for (int x = range.firstX; x <= range.lastX; x++)
+				{
+					int c = (z * gridY + y) * gridX + x;
+					if (clusterFill[c] < clusterData[c * 2 + 1])
+						lightIndices[clusterData[c * 2] + clusterFill[c]++] = GLushort(l);
+				}
+	}
+}
+// end::assignLights[]
+
+// tag::loadLightClusters[]
+static void createBufferTexture(GpuBuffer &buffer, GLuint &texture, GLenum format, size_t bytes, const char *label)
+{
+	buffer = GpuBuffer::create(label);
+	glBindBuffer(GL_TEXTURE_BUFFER, buffer.get());
+	buffer.upload(GL_TEXTURE_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_BUFFER, texture);
+	glTexBuffer(GL_TEXTURE_BUFFER, format, buffer.get());
+}
+
+bool LightClusters::load()
+{
+	createBufferTexture(lightBuffer, lightTexture, GL_RGBA32F, lightData.size() * sizeof(glm::vec4), "lights");
+	createBufferTexture(clusterBuffer, clusterTexture, GL_RG32UI, clusterData.size() * sizeof(GLuint), "light clusters");
+	createBufferTexture(indexBuffer, indexTexture, GL_R16UI, lightIndices.size() * sizeof(GLushort), "light indices");
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	cout << "Light clusters created OK! " << gridX << "x" << gridY << "x" << gridSlices << " clusters, up to " << maxLights << " lights" << endl;
+	return true;
+}
+// end::loadLightClusters[]
+
+void LightClusters::unload()
+{
+	GLuint textures[3] = { lightTexture, clusterTexture, indexTexture };
+	glDeleteTextures(3, textures);
+	lightTexture = clusterTexture = indexTexture = 0;
+	lightBuffer.reset();
+	clusterBuffer.reset();
+	indexBuffer.reset();
+	locationsProgram = 0;
+}
+
+// tag::uploadLightClusters[]
+//each buffer is orphaned and refilled, so the driver never waits for last frame's draws to finish with it
+void LightClusters::upload()
+{
+	glBindBuffer(GL_TEXTURE_BUFFER, lightBuffer.get());
+	lightBuffer.upload(GL_TEXTURE_BUFFER, lightData.size() * sizeof(glm::vec4), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_TEXTURE_BUFFER, 0, lights * 2 * sizeof(glm::vec4), lightData.data());
+
+	//the grid can change size, so the cluster buffer is always respecified at its current size
+	glBindBuffer(GL_TEXTURE_BUFFER, clusterBuffer.get());
+	clusterBuffer.upload(GL_TEXTURE_BUFFER, clusterData.size() * sizeof(GLuint), clusterData.data(), GL_STREAM_DRAW);
+
+	glBindBuffer(GL_TEXTURE_BUFFER, indexBuffer.get());
+	indexBuffer.upload(GL_TEXTURE_BUFFER, lightIndices.size() * sizeof(GLushort), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_TEXTURE_BUFFER, 0, indices * sizeof(GLushort), lightIndices.data());
+
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+// end::uploadLightClusters[]
+
+//the program must be current - the uniforms hardly ever change, so the state cache skips almost all of this
+void LightClusters::bind(GLStateCache &state, GLuint program, GLint firstTextureUnit)
+{
+	if (program != locationsProgram)
+	{
+		const char *names[6] = { "lightData", "clusterData", "lightIndices", "clusterGrid", "clusterNear", "clusterSliceScale" };
+		for (int i = 0; i < 6; i++)
+			uniformLocations[i] = glGetUniformLocation(program, names[i]);
+		locationsProgram = program;
+	}
+
+	GLuint textures[3] = { lightTexture, clusterTexture, indexTexture };
+	for (int i = 0; i < 3; i++)
+	{
+		state.bindTexture(firstTextureUnit + i, GL_TEXTURE_BUFFER, textures[i]);
+		state.uniform1i(uniformLocations[i], firstTextureUnit + i);
+	}
+
+	state.uniform3i(uniformLocations[3], gridX, gridY, gridSlices);
+	state.uniform1f(uniformLocations[4], nearPlane);
+	state.uniform1f(uniformLocations[5], float(gridSlices) / std::log(farPlane / nearPlane));
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+
+#define GLM_FORCE_RADIANS // suppress a warning in GLM 0.9.5
+#include <glm/glm.hpp>
+
+#include "glStateCache.h"
+#include "gpuResources.h"
+
+// tag::pointLight[]
+struct PointLight
+{
+	glm::vec3 position; // world space
+	float radius; // no light reaches past this distance
+	glm::vec3 color; // already multiplied by the intensity
+};
+// end::pointLight[]
+
+// tag::lightClusters[]
+//Clustered forward lighting: the view frustum is cut into a grid of clusters - screen tiles in x and y,
+//and slices in depth that get thicker further from the camera. Each frame, assign() works out which
+//clusters each light's sphere of influence touches, and builds a list of lights per cluster.
+//
+//  - the lights, the per-cluster (offset, count) pairs and the light index lists go to the GPU as
+//    texture buffers (GL 3.3 has no storage buffers)
+//  - the fragment shader finds its cluster from gl_FragCoord and its view space depth, and only
+//    loops over that cluster's lights, so the cost per pixel follows the lights nearby,
+//    not the number of lights in the scene
+//  - all the arrays are allocated once, in the constructor, so assigning lights doesn't allocate
+class LightClusters
+{
+public:
+	static const int maxLights = 1024;
+	static const size_t maxLightIndices = 256 * 1024; // light references across all clusters
+
+	LightClusters();
+
+	void setGrid(int tilesX, int tilesY, int slices); // 1, 1, 1 puts every light in one cluster - plain forward lighting
+	void assign(const PointLight *lights, int lightCount, const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix, float nearPlane, float farPlane);
+
+	bool load(); // GL thread only - creates the buffers and textures
+	void unload();
+	void upload(); // GL thread only - copies the last assign() into the buffers
+	void bind(GLStateCache &state, GLuint program, GLint firstTextureUnit); // binds the three buffer textures and sets the cluster uniforms
+
+	int tilesX() const { return gridX; }
+	int tilesY() const { return gridY; }
+	int slices() const { return gridSlices; }
+	int lightCount() const { return lights; }
+	size_t indexCount() const { return indices; }
+	unsigned int busiestCluster() const { return maxClusterLights; } // most lights any one cluster has to shade
+
+private:
+	LightClusters(const LightClusters &);
+	LightClusters &operator=(const LightClusters &);
+
+	struct ClusterRange
+	{
+		int firstX, lastX;
+		int firstY, lastY;
+		int firstSlice, lastSlice; // firstSlice > lastSlice when the light can't be seen
+	};
+
+	int sliceForDepth(float depth) const;
+
+	int gridX, gridY, gridSlices;
+	float nearPlane, farPlane;
+	int lights;
+	size_t indices;
+	unsigned int maxClusterLights;
+	bool overflowReported;
+
+	std::vector<glm::vec4> lightData; // two texels per light: view space position and radius, then colour
+	std::vector<ClusterRange> lightRanges;
+	std::vector<GLuint> clusterData; // offset and count for each cluster
+	std::vector<GLuint> clusterFill; // lights written to each cluster so far
+	std::vector<GLushort> lightIndices;
+
+	GpuBuffer lightBuffer, clusterBuffer, indexBuffer;
+	GLuint lightTexture, clusterTexture, indexTexture;
+
+	GLuint locationsProgram; // the program uniformLocations were looked up in
+	GLint uniformLocations[6];
+};
+// end::lightClusters[]
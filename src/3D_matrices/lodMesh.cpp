@@ -0,0 +1,271 @@
+#include "lodMesh.h"
+
+#include <iostream>
+#include <fstream>
+#include <cmath>
+#include <algorithm>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+// screen coverage thresholds for each generated level, finest first
+const float lodScreenCoverage[] = { 0.25f, 0.1f, 0.04f, 0.0f };
+const int lodLevelCount = sizeof(lodScreenCoverage) / sizeof(lodScreenCoverage[0]);
+
+static PackedVertex packVertex(glm::vec3 position, glm::vec3 normal, glm::vec4 color)
+{
+	PackedVertex vertex;
+	vertex.position[0] = position.x;
+	vertex.position[1] = position.y;
+	vertex.position[2] = position.z;
+	for (int i = 0; i < 4; i++)
+		vertex.color[i] = uint8_t(glm::clamp(color[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+	for (int i = 0; i < 3; i++)
+		vertex.normal[i] = int8_t(std::floor(glm::clamp(normal[i], -1.0f, 1.0f) * 127.0f + 0.5f));
+	vertex.normal[3] = 0;
+	return vertex;
+}
+
+static uint32_t alignOffset(uint32_t offset)
+{
+	return (offset + LOD_MESH_ALIGNMENT - 1) & ~(LOD_MESH_ALIGNMENT - 1);
+}
+
+// tag::writeLodMesh[]
+bool writeLodMesh(const std::string &filePath, const LodMesh &mesh)
+{
+	if (mesh.levels.empty() || mesh.levels.size() > LOD_MESH_MAX_LEVELS)
+	{
+		cerr << "Mesh could not be written to " << filePath << " - it needs between 1 and " << LOD_MESH_MAX_LEVELS << " levels." << endl;
+		return false;
+	}
+
+	LodMeshHeader header;
+	header.magic = LOD_MESH_MAGIC;
+	header.version = LOD_MESH_VERSION;
+	header.lodCount = uint32_t(mesh.levels.size());
+	header.boundingCenter[0] = mesh.boundingCenter.x;
+	header.boundingCenter[1] = mesh.boundingCenter.y;
+	header.boundingCenter[2] = mesh.boundingCenter.z;
+	header.boundingRadius = mesh.boundingRadius;
+
+	// lay out the blobs after the level table
+	std::vector<LodMeshLevel> levels(mesh.levels.size());
+	uint32_t offset = alignOffset(uint32_t(sizeof(LodMeshHeader) + levels.size() * sizeof(LodMeshLevel)));
+	for (size_t i = 0; i < mesh.levels.size(); i++)
+	{
+		const LodMeshLevelData &data = mesh.levels[i];
+		LodMeshLevel &level = levels[i];
+		level.vertexCount = uint32_t(data.vertices.size());
+		level.indexCount = uint32_t(data.indices.size());
+		level.indexSize = data.vertices.size() < 65536 ? 2 : 4;
+		level.minScreenCoverage = data.minScreenCoverage;
+		level.vertexOffset = offset;
+		offset = alignOffset(offset + level.vertexCount * sizeof(PackedVertex));
+		level.indexOffset = offset;
+		offset = alignOffset(offset + level.indexCount * level.indexSize);
+	}
+
+	std::ofstream fileStream(filePath, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!fileStream)
+	{
+		cerr << "Mesh could not be written - cannot open file " << filePath << endl;
+		return false;
+	}
+
+	std::vector<char> padding(LOD_MESH_ALIGNMENT, 0);
+	auto padTo = [&](uint32_t target) {
+		uint32_t position = uint32_t(fileStream.tellp());
+		fileStream.write(padding.data(), target - position);
+	};
+
+	fileStream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	fileStream.write(reinterpret_cast<const char *>(levels.data()), levels.size() * sizeof(LodMeshLevel));
+	for (size_t i = 0; i < mesh.levels.size(); i++)
+	{
+		const LodMeshLevelData &data = mesh.levels[i];
+		padTo(levels[i].vertexOffset);
+		fileStream.write(reinterpret_cast<const char *>(data.vertices.data()), data.vertices.size() * sizeof(PackedVertex));
+		padTo(levels[i].indexOffset);
+		if (levels[i].indexSize == 2)
+		{
+			std::vector<uint16_t> shortIndices(data.indices.begin(), data.indices.end());
+			fileStream.write(reinterpret_cast<const char *>(shortIndices.data()), shortIndices.size() * sizeof(uint16_t));
+		}
+		else
+		{
+			fileStream.write(reinterpret_cast<const char *>(data.indices.data()), data.indices.size() * sizeof(uint32_t));
+		}
+	}
+	padTo(offset);
+
+	if (!fileStream)
+	{
+		cerr << "Mesh could not be written - write to " << filePath << " failed." << endl;
+		return false;
+	}
+	cout << "Mesh written to " << filePath << " (" << header.lodCount << " levels, " << offset << " bytes)" << endl;
+	return true;
+}
+// end::writeLodMesh[]
+
+bool validateLodMeshHeader(const LodMeshHeader &header, const std::string &filePath)
+{
+	if (header.magic != LOD_MESH_MAGIC)
+	{
+		cerr << "Mesh could not be loaded - " << filePath << " is not a .lodmesh file." << endl;
+		return false;
+	}
+	if (header.version != LOD_MESH_VERSION)
+	{
+		cerr << "Mesh could not be loaded - " << filePath << " is version " << header.version << ", expected " << LOD_MESH_VERSION << "." << endl;
+		return false;
+	}
+	if (header.lodCount == 0 || header.lodCount > LOD_MESH_MAX_LEVELS)
+	{
+		cerr << "Mesh could not be loaded - " << filePath << " has " << header.lodCount << " levels." << endl;
+		return false;
+	}
+	return true;
+}
+
+// tag::generateBatMesh[]
+//A rounded box: a cube subdivided into a grid on every face, with each vertex pushed out onto
+//the surface of a box with rounded edges. Coarser levels use fewer subdivisions, and the
+//coarsest is a plain box.
+LodMesh generateBatMesh(glm::vec3 halfExtents, float cornerRadius, glm::vec4 faceColor, glm::vec4 sideColor)
+{
+	const int subdivisions[] = { 24, 10, 4, 1 };
+	glm::vec3 inner = halfExtents - glm::vec3(cornerRadius);
+
+	LodMesh mesh;
+	mesh.boundingCenter = glm::vec3(0.0f);
+	mesh.boundingRadius = glm::length(halfExtents);
+
+	for (int lod = 0; lod < lodLevelCount; lod++)
+	{
+		int segments = subdivisions[lod];
+		LodMeshLevelData level;
+		level.minScreenCoverage = lodScreenCoverage[lod];
+
+		for (int face = 0; face < 6; face++)
+		{
+			int axis = face / 2; // the axis the face points along
+			float sign = (face % 2) ? 1.0f : -1.0f;
+			int uAxis = (axis + 1) % 3;
+			int vAxis = (axis + 2) % 3;
+			glm::vec4 color = (axis == 0) ? sideColor : faceColor; // x facing ends match the original black sides
+
+			uint32_t firstVertex = uint32_t(level.vertices.size());
+			for (int j = 0; j <= segments; j++)
+			{
+				for (int i = 0; i <= segments; i++)
+				{
+					glm::vec3 cube(0.0f);
+					cube[axis] = sign;
+					cube[uAxis] = -1.0f + 2.0f * i / segments;
+					cube[vAxis] = -1.0f + 2.0f * j / segments;
+
+					glm::vec3 point(cube.x * halfExtents.x, cube.y * halfExtents.y, cube.z * halfExtents.z);
+					glm::vec3 normal(0.0f);
+					normal[axis] = sign;
+					if (segments > 1)
+					{
+						glm::vec3 core = glm::clamp(point, -inner, inner);
+						glm::vec3 offset = point - core;
+						float offsetLength = glm::length(offset);
+						if (offsetLength > 0.0f)
+						{
+							point = core + offset * (cornerRadius / offsetLength);
+							normal = offset / offsetLength; // points out from the rounded edge
+						}
+					}
+					level.vertices.push_back(packVertex(point, normal, color));
+				}
+			}
+
+			// wind every face counter clockwise when viewed from outside
+			bool flip = (sign < 0.0f);
+			for (int j = 0; j < segments; j++)
+			{
+				for (int i = 0; i < segments; i++)
+				{
+					uint32_t a = firstVertex + j * (segments + 1) + i;
+					uint32_t b = a + 1;
+					uint32_t c = a + (segments + 1);
+					uint32_t d = c + 1;
+					uint32_t quad[6] = { a, b, d, a, d, c };
+					if (flip)
+					{
+						std::swap(quad[1], quad[2]);
+						std::swap(quad[4], quad[5]);
+					}
+					level.indices.insert(level.indices.end(), quad, quad + 6);
+				}
+			}
+		}
+		mesh.levels.push_back(level);
+	}
+	return mesh;
+}
+// end::generateBatMesh[]
+
+// tag::generateBallMesh[]
+//A UV sphere, with alternating coloured bands so the rotation is still visible
+LodMesh generateBallMesh(float radius, glm::vec4 color1, glm::vec4 color2)
+{
+	const int rings[] = { 48, 20, 10, 4 };
+	const float pi = 3.14159265358979f;
+
+	LodMesh mesh;
+	mesh.boundingCenter = glm::vec3(0.0f);
+	mesh.boundingRadius = radius;
+
+	for (int lod = 0; lod < lodLevelCount; lod++)
+	{
+		int ringCount = rings[lod];
+		int sectorCount = ringCount * 2;
+		LodMeshLevelData level;
+		level.minScreenCoverage = lodScreenCoverage[lod];
+
+		for (int ring = 0; ring <= ringCount; ring++)
+		{
+			float phi = pi * ring / ringCount;
+			for (int sector = 0; sector <= sectorCount; sector++)
+			{
+				float theta = 2.0f * pi * sector / sectorCount;
+				glm::vec3 point(radius * std::sin(phi) * std::cos(theta), radius * std::cos(phi), radius * std::sin(phi) * std::sin(theta));
+				bool band = ((sector * 8 / sectorCount) % 2) == 0;
+				level.vertices.push_back(packVertex(point, point / radius, band ? color1 : color2));
+			}
+		}
+
+		for (int ring = 0; ring < ringCount; ring++)
+		{
+			for (int sector = 0; sector < sectorCount; sector++)
+			{
+				uint32_t a = ring * (sectorCount + 1) + sector;
+				uint32_t b = a + (sectorCount + 1);
+				uint32_t quad[6] = { a, b, a + 1, a + 1, b, b + 1 };
+				level.indices.insert(level.indices.end(), quad, quad + 6);
+			}
+		}
+		mesh.levels.push_back(level);
+	}
+	return mesh;
+}
+// end::generateBallMesh[]
+
+bool writeDefaultMeshes()
+{
+	glm::vec3 batHalfExtents(0.5f, 0.25f, 0.1f);
+	glm::vec4 black(0.0f, 0.0f, 0.0f, 1.0f);
+	glm::vec4 white(1.0f, 1.0f, 1.0f, 1.0f);
+
+	bool ok = true;
+	ok = writeLodMesh("redBat.lodmesh", generateBatMesh(batHalfExtents, 0.08f, glm::vec4(1.0f, 0.0f, 0.0f, 1.0f), black)) && ok;
+	ok = writeLodMesh("blueBat.lodmesh", generateBatMesh(batHalfExtents, 0.08f, glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), white)) && ok;
+	ok = writeLodMesh("ball.lodmesh", generateBallMesh(0.1f, glm::vec4(0.0f, 1.0f, 0.0f, 1.0f), white)) && ok;
+	return ok;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define GLM_FORCE_RADIANS // suppress a warning in GLM 0.9.5
+#include <glm/glm.hpp>
+
+// tag::lodMeshFormat[]
+// A .lodmesh file holds one mesh at several levels of detail, finest first:
+//
+//   LodMeshHeader
+//   LodMeshLevel[lodCount]
+//   vertex and index blobs, each starting on a LOD_MESH_ALIGNMENT boundary
+//
+// Vertices are a float3 position, a normalised ubyte4 colour and a normalised byte3 normal, padded to
+// four bytes (20 bytes, rather than the 40 bytes used by the compiled-in arrays). Indices are 16 bit when a level has fewer than 65536 vertices.
+// All values are little endian.
+const uint32_t LOD_MESH_MAGIC = 0x4D444F4C; // "LODM"
+const uint32_t LOD_MESH_VERSION = 2; // 2 added the normals
+const uint32_t LOD_MESH_MAX_LEVELS = 8;
+const uint32_t LOD_MESH_ALIGNMENT = 16;
+
+struct LodMeshHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t lodCount;
+	float boundingCenter[3]; // bounding sphere in model space, used to pick a level from screen size
+	float boundingRadius;
+};
+
+struct LodMeshLevel
+{
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t indexSize; // 2 or 4 bytes
+	uint32_t vertexOffset; // byte offset from the start of the file
+	uint32_t indexOffset;
+	float minScreenCoverage; // fraction of the viewport height the bounding sphere must cover to use this level
+};
+
+struct PackedVertex
+{
+	float position[3];
+	uint8_t color[4];
+	int8_t normal[4]; // the fourth byte is padding
+};
+// end::lodMeshFormat[]
+
+// CPU side mesh, as produced by the generators and consumed by writeLodMesh
+struct LodMeshLevelData
+{
+	std::vector<PackedVertex> vertices;
+	std::vector<uint32_t> indices;
+	float minScreenCoverage;
+};
+
+struct LodMesh
+{
+	glm::vec3 boundingCenter;
+	float boundingRadius;
+	std::vector<LodMeshLevelData> levels; // finest first
+};
+
+bool writeLodMesh(const std::string &filePath, const LodMesh &mesh);
+bool validateLodMeshHeader(const LodMeshHeader &header, const std::string &filePath);
+
+// Procedural replacements for the cube bats and ball. Each call builds a full LOD chain.
+LodMesh generateBatMesh(glm::vec3 halfExtents, float cornerRadius, glm::vec4 faceColor, glm::vec4 sideColor);
+LodMesh generateBallMesh(float radius, glm::vec4 color1, glm::vec4 color2);
+
+// write the bat and ball meshes the game streams at startup into the working directory
+bool writeDefaultMeshes();
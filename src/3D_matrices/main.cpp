@@ -10,19 +10,38 @@
 // tag::includes[]
 #include <iostream>
 #include <fstream>
-#include <iterator>
-#include <vector>
 #include <algorithm>
 #include <string>
 #include <cassert>
+#include <cstdlib>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <mutex>
 
 #include <GL/glew.h>
 #include <SDL2/SDL.h>
 
-#define GLM_FORCE_RADIANS // suppress a warning in GLM 0.9.5
-#include <glm/glm.hpp>
-#include <glm/gtc/type_ptr.hpp>
-#include <glm/gtc/matrix_transform.hpp>
+#include "game.h"
+#include "renderer.h"
+#include "lodMesh.h"
+#include "frameArena.h"
+#include "allocTracker.h"
+#include "inputSampler.h"
+#include "tripleBuffer.h"
+#include "netSession.h"
+#include "headlessMatch.h"
+#include "gpuArena.h"
+#include "gpuResources.h"
+#include "scene.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
 // end::includes[]
 
 // tag::using[]
@@ -35,388 +54,106 @@ using std::max;
 using std::string;
 // end::using[]
 
-void resetBall(bool isRedPoint);
-
 // tag::globalVariables[]
 std::string exeName;
 SDL_Window *win; //pointer to the SDL_Window
 SDL_GLContext context; //the SDL_GLContext
 int frameCount = 0;
-std::string frameLine = "";
+FrameArena frameArena(64 * 1024); // transient per-frame data - reset at the start of every frame
 // end::globalVariables[]
 
-// tag::loadShader[]
-std::string loadShader(const string filePath) {
-    std::ifstream fileStream(filePath, std::ios::in | std::ios::binary);
-	if (fileStream)
-	{
-		string fileData( (std::istreambuf_iterator<char>(fileStream)),
-		                 (std::istreambuf_iterator<char>()          ));
-
-		cout << "Shader Loaded from " << filePath << endl;
-		return fileData;
-	}
-	else
-	{
-        cerr << "Shader could not be loaded - cannot read file " << filePath << ". File does not exist." << endl;
-        return "";
-	}
-}
-// end::loadShader[]
-
 //our variables
-bool done = false;
-
-// tag::vertexData[]
-//the data about our geometry
-const GLfloat vertexData[] = {
-#pragma region
-	// ============================ Red + Black Paddle ===============================
-	//	  X			Y      Z       R       G       B       A
-		// Front Side
-		-0.5f,	  0.25f,   -2.5f,   1.0f,   0.0f,   0.0f,   1.0f, // 1
-		 0.5f,    0.25f,   -2.5f,   1.0f,   0.0f,   0.0f,   1.0f, // 2
-		 0.5f,   -0.25f,   -2.5f,   1.0f,   0.0f,   0.0f,   1.0f, // 3 
-		-0.5f,   -0.25f,   -2.5f,   1.0f,   0.0f,   0.0f,   1.0f, // 4
-		-0.5f,	  0.25f,   -2.5f,   1.0f,   0.0f,   0.0f,   1.0f, // 1
-		 0.5f,   -0.25f,   -2.5f,   1.0f,   0.0f,   0.0f,   1.0f, // 3
-
-		// Back Side
-		-0.5f,	  0.25f,   -2.3f,   1.0f,   0.0f,   0.0f,   1.0f, // 5
-		 0.5f,    0.25f,   -2.3f,   1.0f,   0.0f,   0.0f,   1.0f, // 6
-		 0.5f,   -0.25f,   -2.3f,   1.0f,   0.0f,   0.0f,   1.0f, // 7 
-		-0.5f,   -0.25f,   -2.3f,   1.0f,   0.0f,   0.0f,   1.0f, // 8
-		-0.5f,	  0.25f,   -2.3f,   1.0f,   0.0f,   0.0f,   1.0f, // 5
-		 0.5f,   -0.25f,   -2.3f,   1.0f,   0.0f,   0.0f,   1.0f, // 7
-
-		// Left Side
-		-0.5f,	  0.25f,   -2.5f,   0.0f,   0.0f,   0.0f,   1.0f, // 1
-		-0.5f,   -0.25f,   -2.5f,   0.0f,   0.0f,   0.0f,   1.0f, // 4
-		-0.5f,   -0.25f,   -2.3f,   0.0f,   0.0f,   0.0f,   1.0f, // 8
-		-0.5f,	  0.25f,   -2.5f,   0.0f,   0.0f,   0.0f,   1.0f, // 1
-		-0.5f,   -0.25f,   -2.3f,   0.0f,   0.0f,   0.0f,   1.0f, // 8
-		-0.5f,	  0.25f,   -2.3f,   0.0f,   0.0f,   0.0f,   1.0f, // 5
-
-		// Right Side
-		 0.5f,    0.25f,   -2.5f,   0.0f,   0.0f,   0.0f,   1.0f, // 2
-		 0.5f,   -0.25f,   -2.5f,   0.0f,   0.0f,   0.0f,   1.0f, // 3
-		 0.5f,   -0.25f,   -2.3f,   0.0f,   0.0f,   0.0f,   1.0f, // 7
-		 0.5f,    0.25f,   -2.5f,   0.0f,   0.0f,   0.0f,   1.0f, // 2
-		 0.5f,   -0.25f,   -2.3f,   0.0f,   0.0f,   0.0f,   1.0f, // 7
-		 0.5f,    0.25f,   -2.3f,   0.0f,   0.0f,   0.0f,   1.0f, // 6
-
-		// Top Side
-		-0.5f,	  0.25f,   -2.5f,   1.0f,   0.0f,   0.0f,   1.0f, // 1
-		 0.5f,    0.25f,   -2.5f,   1.0f,   0.0f,   0.0f,   1.0f, // 2
-		-0.5f,	  0.25f,   -2.3f,   1.0f,   0.0f,   0.0f,   1.0f, // 5
-		 0.5f,    0.25f,   -2.5f,   1.0f,   0.0f,   0.0f,   1.0f, // 2
-		-0.5f,	  0.25f,   -2.3f,   1.0f,   0.0f,   0.0f,   1.0f, // 5
-		 0.5f,    0.25f,   -2.3f,   1.0f,   0.0f,   0.0f,   1.0f, // 6
-
-		// Bottom Side
-		 0.5f,   -0.25f,   -2.5f,   1.0f,   0.0f,   0.0f,   1.0f, // 3 
-		-0.5f,   -0.25f,   -2.5f,   1.0f,   0.0f,   0.0f,   1.0f, // 4
-		-0.5f,   -0.25f,   -2.3f,   1.0f,   0.0f,   0.0f,   1.0f, // 8
-		 0.5f,   -0.25f,   -2.5f,   1.0f,   0.0f,   0.0f,   1.0f, // 3 
-		-0.5f,   -0.25f,   -2.3f,   1.0f,   0.0f,   0.0f,   1.0f, // 8
-		 0.5f,   -0.25f,   -2.3f,   1.0f,   0.0f,   0.0f,   1.0f, // 7
-	// ============================ End of Cube 1 ===============================
-	#pragma endregion Red + Black Paddle
-
-#pragma region
-	// ============================ Blue + White paddle ===============================
-	//	  X			Y      Z       R       G       B       A
-	// Front Side
-		-0.5f,	  0.25f,   2.3f,   0.0f,   0.0f,   1.0f,   1.0f, // 1
-		 0.5f,    0.25f,   2.3f,   0.0f,   0.0f,   1.0f,   1.0f, // 2
-		 0.5f,   -0.25f,   2.3f,   0.0f,   0.0f,   1.0f,   1.0f, // 3 
-		-0.5f,   -0.25f,   2.3f,   0.0f,   0.0f,   1.0f,   1.0f, // 4
-		-0.5f,	  0.25f,   2.3f,   0.0f,   0.0f,   1.0f,   1.0f, // 1
-		 0.5f,   -0.25f,   2.3f,   0.0f,   0.0f,   1.0f,   1.0f, // 3
-
-	// Back Side
-		-0.5f,	  0.25f,   2.5f,   0.0f,   0.0f,   1.0f,   1.0f, // 5
-		 0.5f,    0.25f,   2.5f,   0.0f,   0.0f,   1.0f,   1.0f, // 6
-		 0.5f,   -0.25f,   2.5f,   0.0f,   0.0f,   1.0f,   1.0f, // 7 
-		-0.5f,   -0.25f,   2.5f,   0.0f,   0.0f,   1.0f,   1.0f, // 8
-		-0.5f,	  0.25f,   2.5f,   0.0f,   0.0f,   1.0f,   1.0f, // 5
- 		 0.5f,   -0.25f,   2.5f,   0.0f,   0.0f,   1.0f,   1.0f, // 7
-
-	// Left Side
-		-0.5f,	  0.25f,   2.3f,   1.0f,   1.0f,   1.0f,   1.0f, // 1
-		-0.5f,   -0.25f,   2.3f,   1.0f,   1.0f,   1.0f,   1.0f, // 4
-		-0.5f,   -0.25f,   2.5f,   1.0f,   1.0f,   1.0f,   1.0f, // 8
-		-0.5f,	  0.25f,   2.3f,   1.0f,   1.0f,   1.0f,   1.0f, // 1
-		-0.5f,   -0.25f,   2.5f,   1.0f,   1.0f,   1.0f,   1.0f, // 8
-		-0.5f,	  0.25f,   2.5f,   1.0f,   1.0f,   1.0f,   1.0f, // 5
-
-	// Right Side
-		 0.5f,    0.25f,   2.3f,   1.0f,   1.0f,   1.0f,   1.0f, // 2
-		 0.5f,   -0.25f,   2.3f,   1.0f,   1.0f,   1.0f,   1.0f, // 3
-		 0.5f,   -0.25f,   2.5f,   1.0f,   1.0f,   1.0f,   1.0f, // 7
-		 0.5f,    0.25f,   2.3f,   1.0f,   1.0f,   1.0f,   1.0f, // 2
-		 0.5f,   -0.25f,   2.5f,   1.0f,   1.0f,   1.0f,   1.0f, // 7
-		 0.5f,    0.25f,   2.5f,   1.0f,   1.0f,   1.0f,   1.0f, // 6
-
-	// Top Side
-		-0.5f,	  0.25f,   2.3f,   0.0f,   0.0f,   1.0f,   1.0f, // 1
-		 0.5f,    0.25f,   2.3f,   0.0f,   0.0f,   1.0f,   1.0f, // 2
-		-0.5f,	  0.25f,   2.5f,   0.0f,   0.0f,   1.0f,   1.0f, // 5
-		 0.5f,    0.25f,   2.3f,   0.0f,   0.0f,   1.0f,   1.0f, // 2
-		-0.5f,    0.25f,   2.5f,   0.0f,   0.0f,   1.0f,   1.0f, // 5
-		 0.5f,    0.25f,   2.5f,   0.0f,   0.0f,   1.0f,   1.0f, // 6
-
-	// Bottom Side
-		 0.5f,   -0.25f,   2.3f,   0.0f,   0.0f,   1.0f,   1.0f, // 3 
-		-0.5f,   -0.25f,   2.3f,   0.0f,   0.0f,   1.0f,   1.0f, // 4
-		-0.5f,   -0.25f,   2.5f,   0.0f,   0.0f,   1.0f,   1.0f, // 8
-		 0.5f,   -0.25f,   2.3f,   0.0f,   0.0f,   1.0f,   1.0f, // 3 
-		-0.5f,   -0.25f,   2.5f,   0.0f,   0.0f,   1.0f,   1.0f, // 8
-		 0.5f,   -0.25f,   2.5f,   0.0f,   0.0f,   1.0f,   1.0f, // 7
-	// ============================ End of Cube 2 ===============================
-#pragma endregion Blue + White Paddle
-};
-
-const GLfloat boundsVertexData[] = {
-#pragma region 
-	// ============================= Left / Right Boundary ===========================
-		-0.05f,  0.5f,  -3.0f, 0.0f, 0.0f, 0.0f, 1.0f, // 1
-		 0.05f,  0.5f,  -3.0f, 0.0f, 0.0f, 0.0f, 1.0f, // 2
-		 0.05f, -0.25f, -3.0f, 0.0f, 0.0f, 0.0f, 1.0f, // 3 
-		-0.05f, -0.25f, -3.0f, 0.0f, 0.0f, 0.0f, 1.0f, // 4
-		-0.05f,  0.5f,  -3.0f, 0.0f, 0.0f, 0.0f, 1.0f, // 1
-		 0.05f, -0.25f, -3.0f, 0.0f, 0.0f, 0.0f, 1.0f, // 3
-
-// Back Side
-		-0.05f,  0.5f,  3.0f, 0.2f, 0.2f, 0.2f, 1.0f, // 5
-		 0.05f,  0.5f,  3.0f, 0.2f, 0.2f, 0.2f, 1.0f, // 6
-		 0.05f, -0.25f, 3.0f, 0.2f, 0.2f, 0.2f, 1.0f, // 7 
-		-0.05f, -0.25f, 3.0f, 0.2f, 0.2f, 0.2f, 1.0f, // 8
-		-0.05f,  0.5f,  3.0f, 0.2f, 0.2f, 0.2f, 1.0f, // 5
-		 0.05f, -0.25f, 3.0f, 0.2f, 0.2f, 0.2f, 1.0f, // 7
-
-// Left Side
-		-0.05f,  0.5f,  -3.0f, 0.0f, 0.5f, 0.7f, 1.0f, // 1
-		-0.05f, -0.25f, -3.0f, 0.0f, 0.5f, 0.7f, 1.0f, // 4
-		-0.05f, -0.25f,  3.0f, 0.0f, 0.5f, 0.7f, 1.0f, // 8
-		-0.05f,  0.5f,  -3.0f, 0.0f, 0.5f, 0.7f, 1.0f, // 1
-		-0.05f, -0.25f,  3.0f, 0.0f, 0.5f, 0.7f, 1.0f, // 8
-		-0.05f,  0.5f,   3.0f, 0.0f, 0.5f, 0.7f, 1.0f, // 5
-
-// Right Side
-		0.05f,  0.5f,  -3.0f, 0.0f, 0.5f, 0.7f, 1.0f, // 2
-		0.05f, -0.25f, -3.0f, 0.0f, 0.5f, 0.7f, 1.0f, // 3
-		0.05f, -0.25f,  3.0f, 0.0f, 0.5f, 0.7f, 1.0f, // 7
-		0.05f,  0.5f,  -3.0f, 0.0f, 0.5f, 0.7f, 1.0f, // 2
-		0.05f, -0.25f,  3.0f, 0.0f, 0.5f, 0.7f, 1.0f, // 7
-		0.05f,  0.5f,   3.0f, 0.0f, 0.5f, 0.7f, 1.0f, // 6
-
-// Top Side
-		-0.05f, 0.5f, -3.0f, 0.0f, 0.0f, 0.0f, 1.0f, // 1
-		 0.05f, 0.5f, -3.0f, 0.0f, 0.0f, 0.0f, 1.0f, // 2
-		-0.05f, 0.5f,  3.0f, 0.0f, 0.0f, 0.0f, 1.0f, // 5
-		 0.05f, 0.5f, -3.0f, 0.0f, 0.0f, 0.0f, 1.0f, // 2
-		-0.05f, 0.5f,  3.0f, 0.0f, 0.0f, 0.0f, 1.0f, // 5
-		 0.05f, 0.5f,  3.0f, 0.0f, 0.0f, 0.0f, 1.0f, // 6
-
-// Bottom Side
-		-0.05f, -0.25f, -3.0f, 0.0f, 0.0f, 0.0f, 1.0f, // 3 
-		-0.05f, -0.25f, -3.0f, 0.0f, 0.0f, 0.0f, 1.0f, // 4
-		-0.05f, -0.25f,  3.0f, 0.0f, 0.0f, 0.0f, 1.0f, // 8
-		 0.05f, -0.25f, -3.0f, 0.0f, 0.0f, 0.0f, 1.0f, // 3 
-		-0.05f, -0.25f,  3.0f, 0.0f, 0.0f, 0.0f, 1.0f, // 8
-		 0.05f, -0.25f,  3.0f, 0.0f, 0.0f, 0.0f, 1.0f, // 7
-
-	#pragma endregion Left / Right Boundary
-
-#pragma region
-// ============================= Top / Bottom Boundary ===========================
-// Front Side
-	-2.5f,  0.5f,  -0.1f,  0.2f,  0.2f,  0.2f, 1.0f, // 1
-	 2.5f,  0.5f,  -0.1f,  0.2f,  0.2f,  0.2f, 1.0f, // 2
-	 2.5f, -0.25f, -0.1f,  0.2f,  0.2f,  0.2f, 1.0f, // 3 
-	-2.5f, -0.25f, -0.1f,  0.2f,  0.2f,  0.2f, 1.0f, // 4
-	-2.5f,  0.5f,  -0.1f,  0.2f,  0.2f,  0.2f, 1.0f, // 1
-	 2.5f, -0.25f, -0.1f,  0.2f,  0.2f,  0.2f, 1.0f, // 3
-
-// Back Side
-	-2.5f,  0.5f,  0.1f, 0.2f, 0.2f, 0.2f, 1.0f, // 5
-	 2.5f,  0.5f,  0.1f, 0.2f, 0.2f, 0.2f, 1.0f, // 6
-	 2.5f, -0.25f, 0.1f, 0.2f, 0.2f, 0.2f, 1.0f, // 7 
-	-2.5f, -0.25f, 0.1f, 0.2f, 0.2f, 0.2f, 1.0f, // 8
-	-2.5f,  0.5f,  0.1f, 0.2f, 0.2f, 0.2f, 1.0f, // 5
-	 2.5f, -0.25f, 0.1f, 0.2f, 0.2f, 0.2f, 1.0f, // 7
-
- // Left Side
-	-2.5f,  0.5f,  -0.1f, 0.0f, 0.5f, 0.7f, 1.0f, // 1
-	-2.5f, -0.25f, -0.1f, 0.0f, 0.5f, 0.7f, 1.0f, // 4
-	-2.5f, -0.25f,  0.1f, 0.0f, 0.5f, 0.7f, 1.0f, // 8
-	-2.5f,  0.5f,  -0.1f, 0.0f, 0.5f, 0.7f, 1.0f, // 1
-	-2.5f, -0.25f,  0.1f, 0.0f, 0.5f, 0.7f, 1.0f, // 8
-	-2.5f,  0.5f,   0.1f, 0.0f, 0.5f, 0.7f, 1.0f, // 5
-
-// Right Side
-	2.5f,  0.5f,  -0.1f,  0.0f,  0.5f, 0.7f, 1.0f, // 2
-	2.5f, -0.25f, -0.1f,  0.0f,  0.5f, 0.7f, 1.0f, // 3
-	2.5f,  0.5f,   0.1f,  0.0f,  0.5f, 0.7f, 1.0f, // 7
-	2.5f,  0.5f,  -0.1f,  0.0f,  0.5f, 0.7f, 1.0f, // 2
-	2.5f, -0.25f,  0.1f,  0.0f,  0.5f, 0.7f, 1.0f, // 7
-	2.5f,  0.5f,   0.1f,  0.0f,  0.5f, 0.7f, 1.0f, // 6
-
-// Top Side
-	-2.5f, 0.5f, -0.1f, 0.0f, 0.0f, 0.0f, 1.0f, // 1
-	 2.5f, 0.5f, -0.1f, 0.0f, 0.0f, 0.0f, 1.0f, // 2
-	-2.5f, 0.5f,  0.1f, 0.0f, 0.0f, 0.0f, 1.0f, // 5
-	 2.5f, 0.5f, -0.1f, 0.0f, 0.0f, 0.0f, 1.0f, // 2
-	-2.5f, 0.5f,  0.1f, 0.0f, 0.0f, 0.0f, 1.0f, // 5
-	 2.5f, 0.5f,  0.1f, 0.0f, 0.0f, 0.0f, 1.0f, // 6
-
-// Bottom Side
-	-2.5f, -0.25f, -0.1f,  0.0f,  0.0f, 0.0f, 1.0f, // 3 
-	-2.5f, -0.25f, -0.1f,  0.0f,  0.0f, 0.0f, 1.0f, // 4
-	-2.5f, -0.25f,  0.1f,  0.0f,  0.0f, 0.0f, 1.0f, // 8
-	 2.5f, -0.25f, -0.1f,  0.0f,  0.0f, 0.0f, 1.0f, // 3 
-	-2.5f, -0.25f,  0.1f,  0.0f,  0.0f, 0.0f, 1.0f, // 8
-  	 2.5f, -0.25f,  0.1f,  0.0f,  0.0f, 0.0f, 1.0f, // 7
-#pragma endregion Top / Bottom Bounds
-};
-
-const GLfloat ballVertexData[] = {
-#pragma region 
-
-	//	  X			Y      Z       R       G       B       A
-	// Front Side
-		-0.1f,  0.1f, -0.1f, 0.0f, 1.0f, 0.0f, 1.0f, // 1
-		 0.1f,  0.1f, -0.1f, 0.0f, 1.0f, 0.0f, 1.0f, // 2
-		 0.1f, -0.1f, -0.1f, 0.0f, 1.0f, 0.0f, 1.0f, // 3 
-		-0.1f, -0.1f, -0.1f, 0.0f, 1.0f, 0.0f, 1.0f, // 4
-		-0.1f,  0.1f, -0.1f, 0.0f, 1.0f, 0.0f, 1.0f, // 1
-		 0.1f, -0.1f, -0.1f, 0.0f, 1.0f, 0.0f, 1.0f, // 3
-
-												// Back Side
-		-0.1f,  0.1f, 0.1f, 1.0f, 1.0f, 1.0f, 1.0f, // 5
-		 0.1f,  0.1f, 0.1f, 1.0f, 1.0f, 1.0f, 1.0f, // 6
-		 0.1f, -0.1f, 0.1f, 1.0f, 1.0f, 1.0f, 1.0f, // 7 
-		-0.1f, -0.1f, 0.1f, 1.0f, 1.0f, 1.0f, 1.0f, // 8
-		-0.1f,  0.1f, 0.1f, 1.0f, 1.0f, 1.0f, 1.0f, // 5
-		 0.1f, -0.1f, 0.1f, 1.0f, 1.0f, 1.0f, 1.0f, // 7
-
-											   // Left Side
-		-0.1f,  0.1f, -0.1f, 0.0f, 0.0f, 0.0f, 1.0f, // 1
-		-0.1f, -0.1f, -0.1f, 0.0f, 0.0f, 0.0f, 1.0f, // 4
-		-0.1f, -0.1f,  0.1f, 0.0f, 0.0f, 0.0f, 1.0f, // 8
-		-0.1f,  0.1f, -0.1f, 0.0f, 0.0f, 0.0f, 1.0f, // 1
-		-0.1f, -0.1f,  0.1f, 0.0f, 0.0f, 0.0f, 1.0f, // 8
-		-0.1f,  0.1f,  0.1f, 0.0f, 0.0f, 0.0f, 1.0f, // 5
-
-												 // Right Side
-		 0.1f,  0.1f, -0.1f,  0.0f,  0.0f,  1.0f,  1.0f, // 2
-		 0.1f, -0.1f, -0.1f,  0.0f,  0.0f,  1.0f,  1.0f, // 3
-		 0.1f, -0.1f,  0.1f,  0.0f,  0.0f,  1.0f,  1.0f, // 7
-		 0.1f,  0.1f, -0.1f,  0.0f,  0.0f,  1.0f,  1.0f, // 2
-		 0.1f, -0.1f,  0.1f,  0.0f,  0.0f,  1.0f,  1.0f, // 7
-		 0.1f,  0.1f,  0.1f,  0.0f,  0.0f,  1.0f,  1.0f, // 6
-
-													// Top Side
-		-0.1f,  0.1f,  -0.1f,  1.0f,  1.0f,  0.0f,  1.0f, // 1
-		 0.1f,  0.1f,  -0.1f,  1.0f,  1.0f,  0.0f,  1.0f, // 2
-		-0.1f,  0.1f,   0.1f,  1.0f,  1.0f,  0.0f,  1.0f, // 5
-		 0.1f,  0.1f,  -0.1f,  1.0f,  1.0f,  0.0f,  1.0f, // 2
-		-0.1f,  0.1f,   0.1f,  1.0f,  1.0f,  0.0f,  1.0f, // 5
-		 0.1f,  0.1f,   0.1f,  1.0f,  1.0f,  0.0f,  1.0f, // 6
-
-													 // Bottom Side
-		 0.1f,  -0.1f, -0.1f,  1.0f,  0.0f,  0.0f,  1.0f, // 3 
-		-0.1f,  -0.1f, -0.1f,  1.0f,  0.0f,  0.0f,  1.0f, // 4
-		-0.1f,  -0.1f,  0.1f,  1.0f,  0.0f,  0.0f,  1.0f, // 8
-		 0.1f,  -0.1f, -0.1f,  1.0f,  0.0f,  0.0f,  1.0f, // 3 
-		-0.1f,  -0.1f,  0.1f,  1.0f,  0.0f,  0.0f,  1.0f, // 8
-		 0.1f,  -0.1f,  0.1f,  1.0f,  0.0f,  0.0f,  1.0f, // 7
-
-#pragma endregion Ball Data
-};
-
-const GLfloat scoreVertexData[] = {
-#pragma region
-	// Red score block
-	-0.025f,	0.025f,   0.0f,   1.0f,   0.0f,   0.0f,   1.0f, // 1
-	 0.025f,    0.025f,   0.0f,   1.0f,   0.0f,   0.0f,   1.0f, // 2
-	 0.025f,   -0.025f,   0.0f,   1.0f,   0.0f,   0.0f,   1.0f, // 3 
-	-0.025f,   -0.025f,   0.0f,   1.0f,   0.0f,   0.0f,   1.0f, // 4
-	-0.025f,	0.025f,   0.0f,   1.0f,   0.0f,   0.0f,   1.0f, // 1
-	 0.025f,   -0.025f,   0.0f,   1.0f,   0.0f,   0.0f,   1.0f, // 3
-
-	// Blue score block
-	-0.025f,	0.025f,   0.0f,   0.0f,   0.0f,   1.0f,   1.0f, // 1
-	 0.025f,    0.025f,   0.0f,   0.0f,   0.0f,   1.0f,   1.0f, // 2
-	 0.025f,   -0.025f,   0.0f,   0.0f,   0.0f,   1.0f,   1.0f, // 3 
-	-0.025f,   -0.025f,   0.0f,   0.0f,   0.0f,   1.0f,   1.0f, // 4
-	-0.025f,	0.025f,   0.0f,   0.0f,   0.0f,   1.0f,   1.0f, // 1
-	 0.025f,   -0.025f,   0.0f,   0.0f,   0.0f,   1.0f,   1.0f, // 3
-#pragma endregion Score Blocks
-};
+std::atomic<bool> done(false); // set by either thread
 
-// end::vertexData[]
+//owned by the simulation thread, once it has started
+GameState game = newGame(); // see game.h
 
-// tag::gameState[]
-//the translation vector we'll pass to our GLSL program
-// These are changed in update simulation, the velocity vectors are altered by keypress input to determine movement
-glm::vec3 position1 = { 0.0f, 0.0f, 0.0f};
-glm::vec3 velocity1 = { 0.0f, 0.0f, 0.0f};
+InputSampler inputSampler; // see inputSampler.h
 
-glm::vec3 position2 = { 0.0f, 0.0f , 0.0f};
-glm::vec3 velocity2 = { 0.0f, 0.0f, 0.0f };
+// tag::fixedStep[]
+// the simulation runs in fixed ticks of tickLength seconds, independent of the frame rate
+const double tickLength = 0.02;
+const int maxTicksPerFrame = 10; // after a long stall, drop time rather than try to catch up
+Uint64 tickCounterLength; // tickLength in SDL_GetPerformanceCounter() units
+Uint64 tickEnd; // counter value at the end of the next tick to simulate
+uint64_t simulationTick = 0;
+Uint64 inputAppliedUntil = 0; // every input event before this counter value has been given to the simulation
+// end::fixedStep[]
 
-glm::vec3 ballPosition = { 0.0f, 0.0f, 0.0f };
-glm::vec3 ballVelocity = { 2.0f, 0.0f, 1.0f};
-
-glm::vec3 boundPosition = { 0.0f, 0.0f , 0.0f };
-
-glm::vec3 scorePosition = { 0.0f, 0.0f, 0.0f };
-// end::gameState[]
-
-// tag::GLVariables[]
-//our GL and GLSL variables
-//programIDs
-GLuint theProgram; //GLuint that we'll fill in to refer to the GLSL program (only have 1 at this point)
-
-//attribute locations
-GLint positionLocation; //GLuint that we'll fill in with the location of the `position` attribute in the GLSL
-GLint vertexColorLocation; //GLuint that we'll fill in with the location of the `vertexColor` attribute in the GLSL
-
-//uniform location
-GLint modelMatrixLocation;
-GLint viewMatrixLocation;
-GLint projectionMatrixLocation;
-
-// These are for the bats
-GLuint vertexDataBufferObject;
-GLuint vertexArrayObject;
-
-// These are for the Ball
-GLuint vertexDataBufferObject2;
-GLuint vertexArrayObject2;
-
-// These are for the Bounds
-GLuint vertexDataBufferObject3;
-GLuint vertexArrayObject3;
-
-// These are for the score
-GLuint vertexDataBufferObject4;
-GLuint vertexArrayObject4;
-
-GLfloat rotateAngle = 1.0f;
 GLint camView = 1; // This will determine which view the camera uses and will change on keypress
 GLfloat speed = 3.0f; // This is here so that I can change the speed of the paddles easier, it also allows me to invert the keypress controls when tracking the opposite bat
+GLfloat batVelocity1 = 0.0f; // set by the keys in handleInput, and given to the bats at the start of each tick
+GLfloat batVelocity2 = 0.0f;
+
+// tag::networkGlobals[]
+// --net red|blue <local port> <peer host> <peer port> plays against another machine - see netSession.h
+UdpSocket netSocket;
+RollbackSession *netSession = nullptr; // null when both bats are played from this keyboard
+Uint64 netClockStart; // network times are milliseconds since this counter value
+NetStats lastNetStats;
+Uint64 lastNetStatsTime = 0;
+const double netStatsInterval = 5.0; // seconds between the "Net:" lines
+double netUpRate = 0.0; // bytes per second over the last interval, for the HUD
+double netDownRate = 0.0;
+// end::networkGlobals[]
+
+// tag::sceneGlobals[]
+// --scene <file> lays out the court - court.scene in the asset directory, unless given, and "none" for the compiled-in court.
+// The file is looked at again every sceneCheckInterval seconds, and whatever changed in it is applied as the game runs
+string scenePath = "court.scene";
+SceneFile sceneFile;
+Scene scene = defaultScene(); // as last applied
+const double sceneCheckInterval = 1.0;
+Uint64 lastSceneCheck = 0;
+bool sceneRedraw = false; // the walls or cameras changed - which the game state doesn't show
+
+std::mutex courtMutex; // a changed court, for the simulation thread to pick up between ticks
+CourtLayout pendingCourt;
+std::atomic<bool> courtPending(false);
+// end::sceneGlobals[]
+
+// tag::frameSnapshot[]
+//everything render() needs, copied out by the simulation thread after each batch of ticks
+struct FrameSnapshot
+{
+	GameState state;
+	int camView;
+	uint64_t tick;
+	Uint64 inputAppliedUntil;
+
+	bool networked; // the rest are only filled in when playing over the network
+	NetStats net;
+	double netUpRate;
+	double netDownRate;
+};
+
+FrameSnapshot takeSnapshot()
+{
+	FrameSnapshot snapshot;
+	snapshot.state = game;
+	snapshot.camView = camView;
+	snapshot.tick = simulationTick;
+	snapshot.inputAppliedUntil = inputAppliedUntil;
+	snapshot.networked = (netSession != nullptr);
+	if (snapshot.networked)
+		snapshot.net = netSession->stats();
+	snapshot.netUpRate = netUpRate;
+	snapshot.netDownRate = netDownRate;
+	return snapshot;
+}
 
-glm::mat4 modelMatrix;
+TripleBuffer<FrameSnapshot> snapshots(takeSnapshot()); // simulation thread writes, main (render) thread reads
+// end::frameSnapshot[]
 
-// Score tracking
-bool isRedPoint; // Who got that point? Gets passed to the reset ball function
-bool gameOver = false;
-GLuint redScore = 0;
-GLuint blueScore = 0;
-// end::GLVariables[]
+// tag::allocationCheck[]
+// --alloc-check runs the game for a while, then fails if the frame loop allocated after warm-up
+// (needs a build with ALLOC_TRACKING, see allocTracker.h)
+bool allocationCheck = false;
+bool allocationCheckStrict = false; // --alloc-check-strict also fails on malloc calls inside SDL and the GL driver
+bool allocationCheckPassed = true;
+const int allocationWarmupFrames = 300;
+const int allocationCheckFrames = 600;
+// end::allocationCheck[]
 
 
 // end Global Variables
@@ -444,7 +181,8 @@ void createWindow()
 	const char *exeNameCStr = exeNameEnd.c_str();
 
 	//create window
-	win = SDL_CreateWindow(exeNameCStr, 100, 100, 1000, 700, SDL_WINDOW_OPENGL); //same height and width makes the window square ...
+	//this is only the starting size - the window can be resized, and the renderer follows its drawable size every frame
+	win = SDL_CreateWindow(exeNameCStr, 100, 100, 1000, 700, SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI);
 
 	//error handling
 	if (win == nullptr)
@@ -504,242 +242,9 @@ void initGlew()
 }
 // end::initGlew[]
 
-// tag::createShader[]
-GLuint createShader(GLenum eShaderType, const std::string &strShaderFile)
-{
-	GLuint shader = glCreateShader(eShaderType);
-	//error check
-	const char *strFileData = strShaderFile.c_str();
-	glShaderSource(shader, 1, &strFileData, NULL);
-
-	glCompileShader(shader);
-
-	GLint status;
-	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
-	if (status == GL_FALSE)
-	{
-		GLint infoLogLength;
-		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLogLength);
-
-		GLchar *strInfoLog = new GLchar[infoLogLength + 1];
-		glGetShaderInfoLog(shader, infoLogLength, NULL, strInfoLog);
-
-		const char *strShaderType = NULL;
-		switch (eShaderType)
-		{
-		case GL_VERTEX_SHADER: strShaderType = "vertex"; break;
-		case GL_GEOMETRY_SHADER: strShaderType = "geometry"; break;
-		case GL_FRAGMENT_SHADER: strShaderType = "fragment"; break;
-		}
-
-		fprintf(stderr, "Compile failure in %s shader:\n%s\n", strShaderType, strInfoLog);
-		delete[] strInfoLog;
-	}
-
-	return shader;
-}
-// end::createShader[]
-
-// tag::createProgram[]
-GLuint createProgram(const std::vector<GLuint> &shaderList)
-{
-	GLuint program = glCreateProgram();
-
-	for (size_t iLoop = 0; iLoop < shaderList.size(); iLoop++)
-		glAttachShader(program, shaderList[iLoop]);
-
-	glLinkProgram(program);
-
-	GLint status;
-	glGetProgramiv(program, GL_LINK_STATUS, &status);
-	if (status == GL_FALSE)
-	{
-		GLint infoLogLength;
-		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &infoLogLength);
-
-		GLchar *strInfoLog = new GLchar[infoLogLength + 1];
-		glGetProgramInfoLog(program, infoLogLength, NULL, strInfoLog);
-		fprintf(stderr, "Linker failure: %s\n", strInfoLog);
-		delete[] strInfoLog;
-	}
-
-	for (size_t iLoop = 0; iLoop < shaderList.size(); iLoop++)
-		glDetachShader(program, shaderList[iLoop]);
-
-	return program;
-}
-// end::createProgram[]
-
-// tag::initializeProgram[]
-void initializeProgram()
-{
-	std::vector<GLuint> shaderList;
-
-	shaderList.push_back(createShader(GL_VERTEX_SHADER, loadShader("vertexShader.glsl")));
-	shaderList.push_back(createShader(GL_FRAGMENT_SHADER, loadShader("fragmentShader.glsl")));
-
-	theProgram = createProgram(shaderList);
-	if (theProgram == 0)
-	{
-		cerr << "GLSL program creation error." << std::endl;
-		SDL_Quit();
-		exit(1);
-	}
-	else {
-		cout << "GLSL program creation OK! GLUint is: " << theProgram << std::endl;
-	}
-
-	// tag::glGetAttribLocation[]
-	positionLocation = glGetAttribLocation(theProgram, "position");
-	vertexColorLocation = glGetAttribLocation(theProgram, "vertexColor");
-	// end::glGetAttribLocation[]
-
-	// tag::glGetUniformLocation[]
-	modelMatrixLocation = glGetUniformLocation(theProgram, "modelMatrix");
-	viewMatrixLocation = glGetUniformLocation(theProgram, "viewMatrix");
-	projectionMatrixLocation = glGetUniformLocation(theProgram, "projectionMatrix");
-
-	//only generates runtime code in debug mode
-	SDL_assert_release( modelMatrixLocation != -1);
-	SDL_assert_release( viewMatrixLocation != -1);
-	SDL_assert_release( projectionMatrixLocation != -1);
-	// end::glGetUniformLocation[]
-
-	//clean up shaders (we don't need them anymore as they are no in theProgram
-	for_each(shaderList.begin(), shaderList.end(), glDeleteShader);
-}
-// end::initializeProgram[]
-
-// tag::initializeVertexArrayObject[]
-//setup a GL object (a VertexArrayObject) that stores how to access data and from where
-void initializeVertexArrayObject()
-{
-	glGenVertexArrays(1, &vertexArrayObject); //create a Vertex Array Object
-	cout << "Vertex Array Object created OK! GLUint is: " << vertexArrayObject << std::endl;
-
-	glBindVertexArray(vertexArrayObject); //make the just created vertexArrayObject the active one
-
-		glBindBuffer(GL_ARRAY_BUFFER, vertexDataBufferObject); //bind vertexDataBufferObject
-
-		glEnableVertexAttribArray(positionLocation); //enable attribute at index positionLocation
-		glEnableVertexAttribArray(vertexColorLocation); //enable attribute at index vertexColorLocation
-
-		// tag::glVertexAttribPointer[]
-		glVertexAttribPointer(positionLocation,    3, GL_FLOAT, GL_FALSE, (7 * sizeof(GL_FLOAT)), (GLvoid *) (0 * sizeof(GLfloat))); //specify that position data contains four floats per vertex, and goes into attribute index positionLocation
-		glVertexAttribPointer(vertexColorLocation, 4, GL_FLOAT, GL_FALSE, (7 * sizeof(GL_FLOAT)), (GLvoid *) (3 * sizeof(GLfloat))); //specify that position data contains four floats per vertex, and goes into attribute index vertexColorLocation
-		// end::glVertexAttribPointer[]
-
-// ============================================= This is the second VAO -- To be used for the Ball ===================================================
-	glBindVertexArray(0); //unbind the vertexArrayObject so we can't change it
-
-		glGenVertexArrays(1, &vertexArrayObject2); //create a Vertex Array Object
-		cout << "Vertex Array Object 2 created OK! GLUint is: " << vertexArrayObject2 << std::endl;
-
-		glBindVertexArray(vertexArrayObject2); //make the just created vertexArrayObject the active one
-		glBindBuffer(GL_ARRAY_BUFFER, vertexDataBufferObject2); //bind vertexDataBufferObject
-
-		glEnableVertexAttribArray(positionLocation); //enable attribute at index positionLocation
-		glEnableVertexAttribArray(vertexColorLocation); //enable attribute at index vertexColorLocation
-
-		// tag::glVertexAttribPointer[]
-		glVertexAttribPointer(positionLocation, 3, GL_FLOAT, GL_FALSE, (7 * sizeof(GL_FLOAT)), (GLvoid *)(0 * sizeof(GLfloat))); //specify that position data contains four floats per vertex, and goes into attribute index positionLocation
-		glVertexAttribPointer(vertexColorLocation, 4, GL_FLOAT, GL_FALSE, (7 * sizeof(GL_FLOAT)), (GLvoid *)(3 * sizeof(GLfloat))); //specify that position data contains four floats per vertex, and goes into attribute index vertexColorLocation
-																																// end::glVertexAttribPointer[]
-	glBindVertexArray(0); //unbind the vertexArrayObject so we can't change it
-
-// ============================================= This is the third VAO -- To be used for the Bounds ===================================================
-	glBindVertexArray(0); //unbind the vertexArrayObject so we can't change it
-
-		glGenVertexArrays(1, &vertexArrayObject3); //create a Vertex Array Object
-		cout << "Vertex Array Object 3 created OK! GLUint is: " << vertexArrayObject3 << std::endl;
-
-		glBindVertexArray(vertexArrayObject3); //make the just created vertexArrayObject the active one
-		glBindBuffer(GL_ARRAY_BUFFER, vertexDataBufferObject3); //bind vertexDataBufferObject
-
-		glEnableVertexAttribArray(positionLocation); //enable attribute at index positionLocation
-		glEnableVertexAttribArray(vertexColorLocation); //enable attribute at index vertexColorLocation
-
-														// tag::glVertexAttribPointer[]
-		glVertexAttribPointer(positionLocation, 3, GL_FLOAT, GL_FALSE, (7 * sizeof(GL_FLOAT)), (GLvoid *)(0 * sizeof(GLfloat))); //specify that position data contains four floats per vertex, and goes into attribute index positionLocation
-		glVertexAttribPointer(vertexColorLocation, 4, GL_FLOAT, GL_FALSE, (7 * sizeof(GL_FLOAT)), (GLvoid *)(3 * sizeof(GLfloat))); //specify that position data contains four floats per vertex, and goes into attribute index vertexColorLocation
-	// end::glVertexAttribPointer[]
-	glBindVertexArray(0); //unbind the vertexArrayObject so we can't change it
-
-
-// ============================================= This is the fourth VAO -- To be used for the Score ===================================================
-	glBindVertexArray(0); //unbind the vertexArrayObject so we can't change it
-
-		glGenVertexArrays(1, &vertexArrayObject4); //create a Vertex Array Object
-		cout << "Vertex Array Object 4 created OK! GLUint is: " << vertexArrayObject4 << std::endl;
-
-		glBindVertexArray(vertexArrayObject4); //make the just created vertexArrayObject the active one
-		glBindBuffer(GL_ARRAY_BUFFER, vertexDataBufferObject4); //bind vertexDataBufferObject
-
-		glEnableVertexAttribArray(positionLocation); //enable attribute at index positionLocation
-		glEnableVertexAttribArray(vertexColorLocation); //enable attribute at index vertexColorLocation
-
-														// tag::glVertexAttribPointer[]
-		glVertexAttribPointer(positionLocation, 3, GL_FLOAT, GL_FALSE, (7 * sizeof(GL_FLOAT)), (GLvoid *)(0 * sizeof(GLfloat))); //specify that position data contains four floats per vertex, and goes into attribute index positionLocation
-		glVertexAttribPointer(vertexColorLocation, 4, GL_FLOAT, GL_FALSE, (7 * sizeof(GL_FLOAT)), (GLvoid *)(3 * sizeof(GLfloat))); //specify that position data contains four floats per vertex, and goes into attribute index vertexColorLocation
-																																	// end::glVertexAttribPointer[]
-	glBindVertexArray(0); //unbind the vertexArrayObject so we can't change it
-
-	//cleanup
-	glDisableVertexAttribArray(positionLocation); //disable vertex attribute at index positionLocation
-	glBindBuffer(GL_ARRAY_BUFFER, 0); //unbind array buffer
-
-}
-// end::initializeVertexArrayObject[]
-
-// tag::initializeVertexBuffer[]
-void initializeVertexBuffer()
-{
-	glGenBuffers(1, &vertexDataBufferObject);
-
-	glBindBuffer(GL_ARRAY_BUFFER, vertexDataBufferObject);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertexData), vertexData, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	cout << "vertexDataBufferObject created OK! GLUint is: " << vertexDataBufferObject << std::endl;
-
-
-	glGenBuffers(1, &vertexDataBufferObject2);
-
-	glBindBuffer(GL_ARRAY_BUFFER, vertexDataBufferObject2);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(ballVertexData), ballVertexData, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	cout << "vertexDataBufferObject 2 created OK! GLUint is: " << vertexDataBufferObject2 << std::endl;
-
-	glGenBuffers(1, &vertexDataBufferObject3);
-
-	glBindBuffer(GL_ARRAY_BUFFER, vertexDataBufferObject3);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(boundsVertexData), boundsVertexData, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	cout << "vertexDataBufferObject 3 created OK! GLUint is: " << vertexDataBufferObject3 << std::endl;
-
-	glGenBuffers(1, &vertexDataBufferObject4);
-
-	glBindBuffer(GL_ARRAY_BUFFER, vertexDataBufferObject4);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(scoreVertexData), scoreVertexData, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	cout << "vertexDataBufferObject 4 created OK! GLUint is: " << vertexDataBufferObject4 << std::endl;
-
-	initializeVertexArrayObject();
-}
-// end::initializeVertexBuffer[]
-
-// tag::loadAssets[]
-void loadAssets()
-{
-	initializeProgram(); //create GLSL Shaders, link into a GLSL program, and get IDs of attributes and variables
-
-	initializeVertexBuffer(); //load data into a vertex buffer
-
-	cout << "Loaded Assets OK!\n";
-}
-// end::loadAssets[]
 
 // tag::handleInput[]
-void handleInput()
+void handleInput(const InputEvent &event)
 {
 	//Event-based input handling
 	//The underlying OS is event-based, so **each** key-up or key-down (for example)
@@ -750,327 +255,601 @@ void handleInput()
 	//    - we want to catch based, and know the order
 	//  - or the user might key-down and key-up the same within a frame, and we still want something to happen (e.g. jump)
 	//  - the alternative is to Poll the current state with SDL_GetKeyboardState
+	//
+	//The events are collected by inputSampler (repeat events are already filtered out), and handed
+	//to us one at a time, at the simulation tick they happened in - see runSimulation
 
-	SDL_Event event; //somewhere to store an event
-
-	//NOTE: there may be multiple events per frame
-	while (SDL_PollEvent(&event)) //loop until SDL_PollEvent returns 0 (meaning no more events)
+	switch (event.type)
 	{
-		switch (event.type)
+	case INPUT_QUIT:
+		done = true; //set done flag if SDL wants to quit (i.e. if the OS has triggered a close event,
+						//  - such as window close, or SIGINT
+		break;
+
+		//keydown handling - we should to the opposite on key-up for direction controls (generally)
+	case INPUT_KEY_DOWN:
+		switch (event.key)
 		{
-		case SDL_QUIT:
-			done = true; //set donecreate remote branch flag if SDL wants to quit (i.e. if the OS has triggered a close event,
-							//  - such as window close, or SIGINT
-			break;
 
-			//keydown handling - we should to the opposite on key-up for direction controls (generally)
-		case SDL_KEYDOWN:
-			//Keydown can fire repeatable if key-repeat is on.
-			//  - the repeat flag is set on the keyboard event, if this is a repeat event
-			//  - in our case, we're going to ignore repeat events
-			//  - https://wiki.libsdl.org/SDL_KeyboardEvent
-			if (!event.key.repeat)
-				switch (event.key.keysym.sym)
-				{
-
-					//hit escape to exit
-					case SDLK_ESCAPE: done = true;
-
-							case SDLK_a:
-								// Move bat one left
-								velocity1.x -= speed;
-								break;
-							case SDLK_d:
-								// move bat one right
-								velocity1.x += speed;
-								break;
-							case SDLK_LEFT:
-								// move bat 2 left
-								velocity2.x -= speed;
-								break;
-							case SDLK_RIGHT:
-								// move bat 2 right
-								velocity2.x += speed;
-								break;
-
-					case SDLK_SPACE:
-						// Change Camera View
-						switch (camView) {
-							case 1:
-								camView = 2;
-								break;
-							case 2:
-								camView = 3;
-								break;
-							case 3:
-								camView = 4;
-								break;
-							case 4:
-								camView = 5;
-								break;
-							case 5:
-								camView = 1;
-								break;
-							default:
-								camView = 1;
-								break;
-						}
+			//hit escape to exit
+			case SDLK_ESCAPE: done = true;
+
+						case SDLK_a:
+							// Move bat one left
+							batVelocity1 -= speed;
+							break;
+						case SDLK_d:
+							// move bat one right
+							batVelocity1 += speed;
+							break;
+						case SDLK_LEFT:
+							// move bat 2 left
+							batVelocity2 -= speed;
+							break;
+						case SDLK_RIGHT:
+							// move bat 2 right
+							batVelocity2 += speed;
+							break;
+
+			case SDLK_SPACE:
+				// Change Camera View
+				switch (camView) {
+					case 1:
+						camView = 2;
 						break;
-				}
-			break;
-
-		case SDL_KEYUP:
-			//Keydown can fire repeatable if key-repeat is on.
-			//  - the repeat flag is set on the keyboard event, if this is a repeat event
-			//  - in our case, we're going to ignore repeat events
-			//  - https://wiki.libsdl.org/SDL_KeyboardEvent
-			if (!event.key.repeat)
-				switch (event.key.keysym.sym)
-				{
-					case SDLK_a:
-						// Reset bat 1 movement to stop it when key is released
-						velocity1.x += speed;
+					case 2:
+						camView = 3;
+						break;
+					case 3:
+						camView = 4;
 						break;
-					case SDLK_d:
-						// Reset bat 1 movement to stop it when key is released
-						velocity1.x -= speed;
+					case 4:
+						camView = 5;
 						break;
-					case SDLK_LEFT:
-						// Reset bat 2 movement to stop when key is released
-						velocity2.x += speed;
+					case 5:
+						camView = 1;
 						break;
-					case SDLK_RIGHT:
-						// Reset bat 2 movement to stop when key is released
-						velocity2.x -= speed;
+					default:
+						camView = 1;
 						break;
 				}
+				speed = (camView == 3) ? -3.0f : 3.0f; // the red tracking view looks back down the court, so invert the controls
+				break;
+		}
+		break;
 
-			break;
+	case INPUT_KEY_UP:
+		switch (event.key)
+		{
+			case SDLK_a:
+				// Reset bat 1 movement to stop it when key is released
+				batVelocity1 += speed;
+				break;
+			case SDLK_d:
+				// Reset bat 1 movement to stop it when key is released
+				batVelocity1 -= speed;
+				break;
+			case SDLK_LEFT:
+				// Reset bat 2 movement to stop when key is released
+				batVelocity2 += speed;
+				break;
+			case SDLK_RIGHT:
+				// Reset bat 2 movement to stop when key is released
+				batVelocity2 -= speed;
+				break;
 		}
+		break;
 	}
 }
 // end::handleInput[]
 
-// tag::updateSimulation[]
-void updateSimulation(double simLength = 0.02) //update simulation with an amount of time to simulate for (in seconds)
+// tag::localPlayerInput[]
+//when networked, either set of keys moves your own bat
+PlayerInput localPlayerInput()
 {
-	//WARNING - we should calculate an appropriate amount of time to simulate - not always use a constant amount of time
-			// see, for example, http://headerphile.blogspot.co.uk/2014/07/part-9-no-more-delays.html
-
-	position1 += float(simLength) * velocity1;
-	position2 += float(simLength) * velocity2;
-	rotateAngle += simLength * 2;
-
-	ballPosition += float(simLength) * ballVelocity;
-
-	// Check for collisions between the bats and the boundaries
-	if (position1.x + 0.5 > 2.5)
-		position1.x = 2.0f;
-	else if (position1.x - 0.5 < -2.5)
-		position1.x = -2.0f;
-
-	if (position2.x + 0.5 > 2.5)
-		position2.x = 2.0f;
-	else if (position2.x - 0.5 < -2.5)
-		position2.x = -2.0f;
+	float velocity = batVelocity1 + batVelocity2;
+	PlayerInput input;
+	input.move = (velocity > 0.0f) ? 1 : ((velocity < 0.0f) ? -1 : 0);
+	return input;
+}
+// end::localPlayerInput[]
 
-	// Check for collision with the ball and the bounds
-	if (ballPosition.x + 0.1 > 2.5 || ballPosition.x - 0.1 < -2.5)
-		ballVelocity.x *= -1.0f;
+double netTimeMs(Uint64 counter)
+{
+	return double(counter - netClockStart) * 1000.0 / double(SDL_GetPerformanceFrequency());
+}
 
-	if (ballPosition.z + 0.1 > 3.0)
-	{
-		resetBall(true);
-	}
-	if (ballPosition.z - 0.1 < -3.0)
+// tag::runSimulation[]
+//Simulate every tick that has finished by `until`. Before each tick, apply the input events whose
+//timestamps fall before its end, in the order they happened - so a key pressed and released
+//within one frame still moves the bat for the ticks in between, and the result doesn't depend
+//on how long the frames took.
+void runSimulation(Uint64 until)
+{
+	int ticksThisFrame = 0;
+	while (tickEnd <= until)
 	{
-		// Blue gets a point
-		resetBall(false);
-	}
+		if (ticksThisFrame == maxTicksPerFrame)
+		{
+			tickEnd = until + tickCounterLength; // too far behind (e.g. the window was dragged) - skip ahead
+			break;
+		}
 
+		if (netSession != nullptr && !netSession->canAdvance())
+			break; // too far ahead of the remote player's input - wait for it
 
-	// Check for collisions between the ball and the bats
-	// If the outer edges of the ball are within the outer edges of the bat X coord, and the Z coords cross then that is a hit
-	if ((ballPosition.x + 0.1f > position1.x - 0.5f && ballPosition.x - 0.1f < position1.x + 0.5f) && ballPosition.z - 0.1 < -2.3f)
-		ballVelocity.z = 1;
-	else if ((ballPosition.x + 0.1f > position2.x - 0.5f && ballPosition.x - 0.1f < position2.x + 0.5f) && ballPosition.z + 0.1 > 2.3f)
-		ballVelocity.z = -1;
+		const InputEvent *event;
+		while ((event = inputSampler.events().front()) != nullptr && event->timestamp < tickEnd)
+		{
+			handleInput(*event);
+			inputSampler.events().pop();
+		}
+		inputAppliedUntil = tickEnd;
 
+		if (netSession != nullptr)
+		{
+			netSession->advance(localPlayerInput(), netTimeMs(tickEnd)); // predicts the remote bat, and sends our input
+			game = netSession->state();
+		}
+		else
+		{
+			game.velocity1.x = batVelocity1;
+			game.velocity2.x = batVelocity2;
+			updateSimulation(game, tickLength); // this should ONLY SET VARIABLES according to simulation
+		}
+		simulationTick++;
+		tickEnd += tickCounterLength;
+		ticksThisFrame++;
+	}
 }
-// end::updateSimulation[]
+// end::runSimulation[]
 
-void resetBall(bool isRedPoint)
+// tag::pollNetwork[]
+//read the peer's packets (which may roll the game back and resimulate it), and report the traffic now and then
+//returns false while we can't simulate - not connected yet, or too far ahead of the peer
+bool pollNetwork(Uint64 now)
 {
-	if (isRedPoint)
-		redScore++;
-	else
-		blueScore++;
+	netSession->poll(netTimeMs(now));
+	game = netSession->state();
 
-	if (redScore >= 5 || blueScore >= 5)
+	double sinceReport = double(now - lastNetStatsTime) / double(SDL_GetPerformanceFrequency());
+	if (netSession->connected() && sinceReport >= netStatsInterval)
 	{
-		gameOver = true;
-		ballVelocity.x = 0.0f;
-		ballVelocity.z = 0.0f;
+		NetStats latest = netSession->stats();
+		netUpRate = (latest.bytesSent - lastNetStats.bytesSent) / sinceReport;
+		netDownRate = (latest.bytesReceived - lastNetStats.bytesReceived) / sinceReport;
+		cout << endl;
+		printNetStats("Net", latest, lastNetStats, sinceReport);
+		lastNetStats = latest;
+		lastNetStatsTime = now;
 	}
-
-	ballPosition.x = 0;
-	ballPosition.z = 0;
-
+	return netSession->canAdvance();
 }
+// end::pollNetwork[]
 
-// tag::preRender[]
-void preRender()
+// tag::takeCourt[]
+//networked matches stay on the court they started with - both sides have to play the same one, and the scene is only local
+void takePendingCourt()
 {
-
-	glEnable(GL_DEPTH_TEST);
-	glDepthFunc(GL_LEQUAL);
-	glViewport(0, 0, 1000, 700); //set viewpoint
-	glClearColor(0.2f, 0.0f, 0.2f, 1.0f); //set clear colour
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); //clear the window (technical the scissor box bounds)
+	if (!courtPending.exchange(false))
+		return;
+	std::lock_guard<std::mutex> lock(courtMutex);
+	if (netSession == nullptr)
+		setCourt(game, pendingCourt);
 }
-// end::preRender[]
+// end::takeCourt[]
 
-// tag::render[]
-void render()
+// tag::simulationThread[]
+//Runs the simulation alongside rendering, so frame N+1 is simulated while frame N is submitted.
+//A tick only runs once the main thread has sampled input past its end (so no event can arrive late),
+//and each batch of ticks is published as an immutable snapshot for render() to draw.
+void simulationThread()
 {
-	glUseProgram(theProgram); //installs the program object specified by program as part of current rendering state
-
-	glBindVertexArray(vertexArrayObject);
-
-	//set projectionMatrix - how we go from 3D to 2D
-	glUniformMatrix4fv(projectionMatrixLocation, 1, false, glm::value_ptr(glm::perspective(90.0f, 1.0f, 0.1f, 100.0f))); // http://stackoverflow.com/questions/8115352/glmperspective-explanation
+	trackAllocationsOnThisThread();
+	setAllocationPhase(ALLOCATION_PHASE_SIMULATION);
 
-	//set viewMatrix - how we control the view (viewpoint, view direction, etc)
-
-	// I learned Camera stuff from here http://learnopengl.com/#!Getting-started/Camera
-	switch (camView)
+	while (!done)
 	{
-		case 1:
-			speed = 3.0f;
-			glUniformMatrix4fv(viewMatrixLocation, 1, false, glm::value_ptr(glm::lookAt(glm::vec3(0.0f, 1.5f, 4.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f)))); // Standard behind blue view
-			break;
-		case 2:
-			speed = 3.0f;
-			glUniformMatrix4fv(viewMatrixLocation, 1, false, glm::value_ptr(glm::lookAt(glm::vec3(2.0f, 3.5f, 0.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f)))); // Above and look down view
-			break;
-		case 3:
-			speed = -3.0f;
-			glUniformMatrix4fv(viewMatrixLocation, 1, false, glm::value_ptr(glm::lookAt(glm::vec3(position1.x, position2.y + 1.5f, position1.z - 4.0f), position1, glm::vec3(0.0f, 1.0f, 0.0f)))); // Track Red -- Also the controls need inverting here
-			break;
-		case 4:
-			speed = 3.0f;
-			glUniformMatrix4fv(viewMatrixLocation, 1, false, glm::value_ptr(glm::lookAt(glm::vec3(position2.x, position2.y + 1.5f, position2.z + 4.0f), position2, glm::vec3(0.0f, 1.0f, 0.0f)))); // Track Blue
-			break;
-		case 5:
-			speed = 3.0f;
-			glUniformMatrix4fv(viewMatrixLocation, 1, false, glm::value_ptr(glm::lookAt(glm::vec3(ballPosition.x + 2.0f, ballPosition.y + 3.5f, ballPosition.z), ballPosition, glm::vec3(0.0f, 1.0f, 0.0f)))); // Track the ball
-			break;
-	}
-
-
-	// ==================================== Render the Bats ================================
-	modelMatrix = glm::translate(glm::mat4(1.0f), position1);
-	//modelMatrix = glm::rotate(modelMatrix, rotateAngle, glm::vec3(0, 0, 0));
-	glUniformMatrix4fv(modelMatrixLocation, 1, false, glm::value_ptr(modelMatrix));
-	glDrawArrays(GL_TRIANGLES, 0, 36);
-
-	modelMatrix = glm::translate(glm::mat4(1.0f), position2);
-	glUniformMatrix4fv(modelMatrixLocation, 1, false, glm::value_ptr(modelMatrix));
-	glDrawArrays(GL_TRIANGLES, 36, 78 );
-
-	// =================================== Render the Bounds ==================================
-	glBindVertexArray(vertexArrayObject3); 
-
-	// ====== Left and Right Bounds =====
-	boundPosition.z = 0.0f;
-	boundPosition.x = -2.5f;
-	modelMatrix = glm::translate(glm::mat4(1.0f), boundPosition);
-	glUniformMatrix4fv(modelMatrixLocation, 1, false, glm::value_ptr(modelMatrix));
-	glDrawArrays(GL_TRIANGLES, 0, 36);
-
-	boundPosition.x = 2.5f;
-	modelMatrix = glm::translate(glm::mat4(1.0f), boundPosition);
-	glUniformMatrix4fv(modelMatrixLocation, 1, false, glm::value_ptr(modelMatrix));
-	glDrawArrays(GL_TRIANGLES, 0, 36);
-
-	// ====== Top and Bottom Bounds ======
-	boundPosition.x = 0.0f;
-	boundPosition.z = -3.0f;
-	modelMatrix = glm::translate(glm::mat4(1.0f), boundPosition);
-	glUniformMatrix4fv(modelMatrixLocation, 1, false, glm::value_ptr(modelMatrix));
-	glDrawArrays(GL_TRIANGLES, 36, 78);
+		Uint64 now = SDL_GetPerformanceCounter();
+		if (now < tickEnd)
+		{
+			std::this_thread::sleep_for(std::chrono::microseconds((tickEnd - now) * 1000000 / SDL_GetPerformanceFrequency()));
+			continue;
+		}
 
-	boundPosition.z = 3.0f;
-	modelMatrix = glm::translate(glm::mat4(1.0f), boundPosition);
-	glUniformMatrix4fv(modelMatrixLocation, 1, false, glm::value_ptr(modelMatrix));
-	glDrawArrays(GL_TRIANGLES, 36, 78);
+		Uint64 sampledUntil = inputSampler.sampledUntil();
+		if (sampledUntil < tickEnd)
+		{
+			inputSampler.waitForSample(tickEnd, 50); // until the main thread pumps again - up to idleWaitMs when it's idle
+			continue;
+		}
 
-	// ==================================== Render the Ball ==================================
-	glBindVertexArray(vertexArrayObject2);
+		if (netSession != nullptr && !pollNetwork(now))
+		{
+			tickEnd = now + tickCounterLength; // don't build up ticks to catch up on while we wait
+			snapshots.writeBuffer() = takeSnapshot();
+			snapshots.publish();
+			continue;
+		}
 
-	modelMatrix = glm::translate(glm::mat4(1.0f), ballPosition);
-	modelMatrix = glm::rotate(modelMatrix, rotateAngle, glm::vec3(1, 1, 1));
-	glUniformMatrix4fv(modelMatrixLocation, 1, false, glm::value_ptr(modelMatrix));
-	glDrawArrays(GL_TRIANGLES, 0, 36);
+		takePendingCourt();
+		runSimulation(sampledUntil);
+		snapshots.writeBuffer() = takeSnapshot();
+		snapshots.publish();
+	}
+}
+// end::simulationThread[]
+
+// tag::idleFrames[]
+//A frame is only drawn when it would look different from the last one. Once nothing is moving - the match
+//is over, the bats are still, the sparks have died out and every input event has been simulated - the main
+//thread sleeps in SDL until an event arrives, instead of drawing the same frame over and over.
+int idleWaitMs = 100; // how long to sleep while nothing is moving, before looking again - 0 draws every frame, as before
+const int unchangedWaitMs = 1; // while the game is moving, but hasn't been simulated any further since the last frame
+FrameSnapshot lastDrawn = takeSnapshot();
+int lastDrawnWidth = 0;
+int lastDrawnHeight = 0;
+uint64_t framesSkipped = 0;
+
+bool frameChanged(const FrameSnapshot &snapshot, int drawableWidth, int drawableHeight)
+{
+	const GameState &state = snapshot.state;
+	const GameState &drawn = lastDrawn.state;
+	return frameCount == 0 || drawableWidth != lastDrawnWidth || drawableHeight != lastDrawnHeight || snapshot.camView != lastDrawn.camView
+		|| state.position1 != drawn.position1 || state.position2 != drawn.position2 || state.ballPosition != drawn.ballPosition
+		|| state.rotateAngle != drawn.rotateAngle || state.redScore != drawn.redScore || state.blueScore != drawn.blueScore
+		|| state.gameOver != drawn.gameOver || state.impactCount != drawn.impactCount || state.court != drawn.court;
+}
 
+//will the next frame be the same as this one, however long we wait, unless an event arrives?
+bool sceneIdle(const FrameSnapshot &snapshot)
+{
+	const GameState &state = snapshot.state;
+	return !snapshot.networked && state.gameOver && state.velocity1.x == 0.0f && state.velocity2.x == 0.0f
+		&& inputSampler.lastEventTime() < snapshot.inputAppliedUntil && !sceneAnimating();
+}
 
-	glUniformMatrix4fv(projectionMatrixLocation, 1, false, glm::value_ptr(glm::mat4(1.0f)));
-	glUniformMatrix4fv(viewMatrixLocation, 1, false, glm::value_ptr(glm::mat4(1.0f)));
+//true if the frame should be drawn - otherwise, sleeps until it's worth looking again
+bool needFrame(const FrameSnapshot &snapshot, int drawableWidth, int drawableHeight)
+{
+	bool windowChanged = inputSampler.takeWindowChanged();
+	if (idleWaitMs <= 0 || windowChanged || sceneRedraw || sceneAnimating() || frameChanged(snapshot, drawableWidth, drawableHeight))
+	{
+		sceneRedraw = false;
+		lastDrawn = snapshot;
+		lastDrawnWidth = drawableWidth;
+		lastDrawnHeight = drawableHeight;
+		return true;
+	}
+	framesSkipped++;
+	inputSampler.waitForEvents(sceneIdle(snapshot) ? idleWaitMs : unchangedWaitMs);
+	return false;
+}
+// end::idleFrames[]
 
-	glBindVertexArray(vertexArrayObject4);
+// tag::loadScene[]
+void loadScene()
+{
+	if (scenePath.empty())
+		return; // --scene none
+	bool absolute = scenePath[0] == '/' || scenePath[0] == '\\' || scenePath.find(':') != string::npos;
+	string path = absolute ? scenePath : assetDirectory + scenePath;
+	if (!std::ifstream(path).good())
+	{
+		cout << "No scene at " << path << " - playing on the compiled-in court" << endl;
+		return;
+	}
+	Scene loaded = scene;
+	if (sceneFile.load(path, loaded))
+		scene = loaded;
+	applyScene(scene); // before loadAssets, which builds the walls
+	if (netSession == nullptr)
+		setCourt(game, scene.court); // the simulation thread hasn't started yet
+	else if (scene.court != defaultCourtLayout())
+		cout << "The scene's court is only used for local matches - playing on the compiled-in court" << endl;
+}
 
-	// Red Score
-	scorePosition.y = 0.95f;
-	scorePosition.x = -0.95f;
-	for (int i = 0; i < redScore; i++)
+//every sceneCheckInterval, read the file again - if it has changed, apply only what changed in it
+void watchScene()
+{
+	Uint64 now = SDL_GetPerformanceCounter();
+	if (sceneFile.path().empty() || allocationCheck || double(now - lastSceneCheck) < sceneCheckInterval * double(SDL_GetPerformanceFrequency()))
+		return; // (reading a file allocates, so the allocation check doesn't look)
+	lastSceneCheck = now;
+	if (!sceneFile.changed())
+		return;
+	cout << endl; // off the end of the "Frame:" line
+	Scene changed = scene;
+	if (!sceneFile.reload(changed))
+		return; // a mistake in it - which has been reported, and we keep the last scene that worked
+
+	int uploads = sceneWallUploads();
+	Uint64 start = SDL_GetPerformanceCounter();
+	SceneDiff diff = applyScene(changed);
+	double applyMs = double(SDL_GetPerformanceCounter() - start) * 1000.0 / double(SDL_GetPerformanceFrequency());
+	if (diff.courtChanged)
 	{
-		modelMatrix = glm::translate(glm::mat4(1.0f), scorePosition);
-		//modelMatrix = glm::rotate(modelMatrix, rotateAngle, glm::vec3(0, 1, 0));
-		glUniformMatrix4fv(modelMatrixLocation, 1, false, glm::value_ptr(modelMatrix));
-		glDrawArrays(GL_TRIANGLES, 0, 6);
-		scorePosition.x += 0.08f;
+		std::lock_guard<std::mutex> lock(courtMutex);
+		pendingCourt = changed.court;
+		courtPending = true;
 	}
+	scene = changed;
+	sceneRedraw = true;
+
+	const char *line = frameArena.format("Scene %s changed:%s%s walls %d added, %d moved, %d reshaped, %d removed - %d uploaded in %.3f ms",
+		sceneFile.path().c_str(), diff.courtChanged ? " court," : "", diff.camerasChanged ? " cameras," : "", diff.count(SCENE_WALL_ADDED),
+		diff.count(SCENE_WALL_MOVED), diff.count(SCENE_WALL_RESHAPED), diff.count(SCENE_WALL_REMOVED), sceneWallUploads() - uploads, applyMs);
+	cout << line << endl;
+}
+// end::loadScene[]
+
+// tag::powerReport[]
+//how much CPU the whole process used, and how many frames were skipped - printed every powerReportInterval seconds
+const double powerReportInterval = 5.0;
+Uint64 lastPowerReport = 0;
+double lastCpuSeconds = 0.0;
+int lastReportFrames = 0;
+uint64_t lastReportSkipped = 0;
+double cpuPercent = 0.0; // of one core, so it can go over 100 with several threads busy - for the HUD
+
+//CPU time used by every thread of the process so far
+double processCpuSeconds()
+{
+#ifdef _WIN32
+	FILETIME created, exited, kernel, user;
+	if (!GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user))
+		return 0.0;
+	ULARGE_INTEGER kernelTime, userTime;
+	kernelTime.LowPart = kernel.dwLowDateTime;
+	kernelTime.HighPart = kernel.dwHighDateTime;
+	userTime.LowPart = user.dwLowDateTime;
+	userTime.HighPart = user.dwHighDateTime;
+	return double(kernelTime.QuadPart + userTime.QuadPart) * 1e-7; // in 100 ns units
+#else
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return double(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) + double(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+#endif
+}
 
-	// Blue Score	
-	scorePosition.x = 0.95f;
-	for (int i = 0; i < blueScore; i++)
+void reportPower()
+{
+	Uint64 now = SDL_GetPerformanceCounter();
+	double sinceReport = double(now - lastPowerReport) / double(SDL_GetPerformanceFrequency());
+	if (lastPowerReport != 0 && sinceReport < powerReportInterval)
+		return;
+	double cpuSeconds = processCpuSeconds();
+	if (lastPowerReport != 0)
 	{
-		modelMatrix = glm::translate(glm::mat4(1.0f), scorePosition);
-		//modelMatrix = glm::rotate(modelMatrix, rotateAngle, glm::vec3(0, 1, 0));
-		glUniformMatrix4fv(modelMatrixLocation, 1, false, glm::value_ptr(modelMatrix));
-		glDrawArrays(GL_TRIANGLES, 6, 12);
-		scorePosition.x -= 0.08f;
+		cpuPercent = (cpuSeconds - lastCpuSeconds) / sinceReport * 100.0;
+		const char *line = frameArena.format("Power: cpu %.1f%% of a core, %d frames drawn, %llu skipped in %.1f s", cpuPercent,
+			frameCount - lastReportFrames, (unsigned long long)(framesSkipped - lastReportSkipped), sinceReport);
+		cout << endl << line << endl;
 	}
+	lastPowerReport = now;
+	lastCpuSeconds = cpuSeconds;
+	lastReportFrames = frameCount;
+	lastReportSkipped = framesSkipped;
+}
+// end::powerReport[]
 
-	glBindVertexArray(0);
+// tag::hudText[]
+//the frame stats shown on the HUD - formatted into the frame arena, so building them doesn't allocate
+Uint64 lastFrameStart = 0;
+double smoothedFrameMs = 0.0;
 
-	glUseProgram(0); //clean up
+const char *buildHudText(const FrameSnapshot &snapshot)
+{
+	Uint64 now = SDL_GetPerformanceCounter();
+	if (lastFrameStart != 0)
+	{
+		double frameMs = double(now - lastFrameStart) * 1000.0 / double(SDL_GetPerformanceFrequency());
+		smoothedFrameMs += (frameMs - smoothedFrameMs) * 0.05; // smoothed, so the numbers are readable
+	}
+	lastFrameStart = now;
+
+	const char *text = frameArena.format("Frame %d  %.2f ms  %.0f fps\nTick %llu", frameCount, smoothedFrameMs,
+		smoothedFrameMs > 0.0 ? 1000.0 / smoothedFrameMs : 0.0, (unsigned long long)snapshot.tick);
+	RenderResolution resolution = renderResolution();
+	text = frameArena.format("%s\nScene %dx%d (%.0f%%%s)  gpu %.1f ms", text, resolution.sceneWidth, resolution.sceneHeight,
+		resolution.scale * 100.0f, resolution.dynamic ? ", dynamic" : "", resolution.gpuFrameMs);
+	GLStateCache::Counts calls = renderCallCounts();
+	text = frameArena.format("%s\nGL calls %u issued  %u skipped  %u draws", text, calls.issued, calls.skipped, calls.draws);
+	text = frameArena.format("%s\nFrames skipped %llu  cpu %.1f%%", text, (unsigned long long)framesSkipped, cpuPercent);
+	text = frameArena.format("%s\nGPU buffers %.1f MB", text, gpuResources.bytes(GPU_BUFFER) / (1024.0 * 1024.0));
+	if (gpuResources.budget() != 0)
+		text = frameArena.format("%s of %.1f MB", text, gpuResources.budget() / (1024.0 * 1024.0));
+	if (snapshot.networked)
+		text = frameArena.format("%s\nNet %.0f B/s up  %.0f B/s down  rtt %.0f ms\nRollbacks %llu  worst %llu ticks  resyncs %llu", text,
+			snapshot.netUpRate, snapshot.netDownRate, snapshot.net.roundTripMs, (unsigned long long)snapshot.net.rollbacks,
+			(unsigned long long)snapshot.net.worstRollbackTicks, (unsigned long long)snapshot.net.resyncs);
+	return text;
 }
-// end::render[]
+// end::hudText[]
 
 // tag::postRender[]
 void postRender()
 {
 	SDL_GL_SwapWindow(win);; //present the frame buffer to the display (swapBuffers)
-	frameLine += "Frame: " + std::to_string(frameCount++);
+	const char *frameLine = frameArena.format("Frame: %d", frameCount++); //no std::string - the frame loop should not touch the heap
 	cout << "\r" << frameLine << std::flush;
-	frameLine = "";
 }
 // end::postRender[]
 
+// tag::checkAllocations[]
+void checkAllocations()
+{
+	if (frameCount == allocationWarmupFrames)
+	{
+		resetAllocationCounts(); //everything up to here is start-up and streaming
+	}
+	else if (frameCount == allocationWarmupFrames + allocationCheckFrames)
+	{
+		allocationCheckPassed = reportAllocations(allocationCheckFrames, allocationCheckStrict);
+		cout << "Frame arena high water mark: " << frameArena.highWaterMark() << " of " << frameArena.capacity() << " bytes" << endl;
+		done = true;
+	}
+}
+// end::checkAllocations[]
+
 // tag::cleanUp[]
 void cleanUp()
 {
+	unloadAssets();
+	gpuResources.printUsage("\nGPU resources after unloading");
+	gpuResources.reportLeaks(); // everything should be gone by now - whatever isn't would pile up across reloads
+	inputSampler.stop();
+	delete netSession;
+	netSession = nullptr;
+	netSocket.close();
 	SDL_GL_DeleteContext(context);
 	SDL_DestroyWindow(win);
 	cout << "Cleaning up OK!\n";
 }
 // end::cleanUp[]
 
+// tag::renderOptions[]
+//options for the renderer, which can go anywhere on the command line:
+//  --lights <n>          how many coloured display lights to put around the arena (see renderer.cpp)
+//  --target-ms <ms>      the GPU time per frame dynamic resolution aims for
+//  --render-scale <s>    draw the scene at a fixed fraction of the window size instead
+//  --arena <courts>      play this many more courts behind the main one, simulated on the GPU (see gpuArena.h)
+//  --asset-pack <file>   load the assets from this pack, rather than assets.pack - "none" for the loose files
+//  --idle-ms <ms>        how long to sleep at a time once nothing is moving - 0 draws every frame, idle or not
+//  --gpu-budget <MB>     the most GPU buffer memory to use - mesh levels not in view are evicted to stay under it
+//  --scene <file>        lay the court out from this file, rather than court.scene - "none" for the compiled-in court
+bool isRenderOption(const string &option)
+{
+	return option == "--lights" || option == "--target-ms" || option == "--render-scale" || option == "--arena" || option == "--asset-pack"
+		|| option == "--idle-ms" || option == "--gpu-budget" || option == "--scene";
+}
+
+void parseRenderOptions(int argc, char *args[])
+{
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		string option = args[i];
+		if (option == "--lights")
+			setDisplayLightCount(std::atoi(args[++i]));
+		else if (option == "--target-ms")
+			setTargetFrameTime(float(std::atof(args[++i])));
+		else if (option == "--render-scale")
+			setRenderScale(float(std::atof(args[++i])));
+		else if (option == "--arena")
+			setArenaCourts(std::atoi(args[++i]));
+		else if (option == "--asset-pack")
+		{
+			string packPath = args[++i];
+			setAssetPackPath(packPath == "none" ? string() : packPath);
+		}
+		else if (option == "--idle-ms")
+			idleWaitMs = std::atoi(args[++i]);
+		else if (option == "--gpu-budget")
+			gpuResources.setBudget(size_t(std::max(0.0, std::atof(args[++i])) * 1024.0 * 1024.0));
+		else if (option == "--scene")
+		{
+			scenePath = args[++i];
+			if (scenePath == "none")
+				scenePath.clear();
+		}
+	}
+}
+// end::renderOptions[]
+
+// tag::networkOptions[]
+//  --latency <ms> --jitter <ms> --loss <fraction> --seed <n>, from args[first] onwards
+NetworkConditions parseNetworkConditions(int argc, char *args[], int first)
+{
+	NetworkConditions conditions;
+	for (int i = first; i + 1 < argc; i += 2)
+	{
+		string option = args[i];
+		double value = std::atof(args[i + 1]);
+		if (option == "--latency")
+			conditions.latencyMs = value;
+		else if (option == "--jitter")
+			conditions.jitterMs = value;
+		else if (option == "--loss")
+			conditions.lossRate = value;
+		else if (option == "--seed")
+			conditions.seed = uint32_t(value);
+		else if (!isRenderOption(option))
+			cerr << "Unknown network option " << option << " - ignored" << endl;
+	}
+	return conditions;
+}
+
+//  --net red|blue <local port> <peer host> <peer port> [network conditions]
+bool startNetworkSession(int argc, char *args[])
+{
+	if (argc < 6 || (string(args[2]) != "red" && string(args[2]) != "blue"))
+	{
+		cerr << "Usage: " << args[0] << " --net red|blue <local port> <peer host> <peer port> [--latency ms] [--jitter ms] [--loss fraction]" << endl;
+		return false;
+	}
+	PlayerSide side = (string(args[2]) == "red") ? RED_PLAYER : BLUE_PLAYER;
+	if (!netSocket.open(uint16_t(std::atoi(args[3]))) || !netSocket.setPeer(args[4], uint16_t(std::atoi(args[5]))))
+		return false;
+	netSocket.setConditions(parseNetworkConditions(argc, args, 6));
+
+	netSession = new RollbackSession(netSocket, side, tickLength);
+	cout << "Playing " << args[2] << ", waiting for " << args[4] << ":" << args[5] << endl;
+	return true;
+}
+// end::networkOptions[]
+
 // tag::main[]
 int main( int argc, char* args[] )
 {
 	exeName = args[0];
+
+	//write the streamed bat and ball meshes to the working directory, and exit
+	if (argc > 1 && string(args[1]) == "--generate-meshes")
+		return writeDefaultMeshes() ? 0 : 1;
+
+	//put every shader, mesh and vertex array into one file, which the game maps at startup instead of reading them one by one
+	//  --pack-assets <pack file> [--assets <dir>]
+	if (argc > 2 && string(args[1]) == "--pack-assets")
+	{
+		if (argc > 4 && string(args[3]) == "--assets")
+			assetDirectory = args[4];
+		return packAssets(args[2]) ? 0 : 1;
+	}
+
+	//match analytics, with no window: play matches between two AI bats and append their events to a file,
+	//or sum up a file of events - see matchEvents.h
+	//  --simulate-matches <count> <file> [threads]
+	//  --query-matches <file>
+	if (argc > 3 && string(args[1]) == "--simulate-matches")
+	{
+		int threads = (argc > 4) ? std::atoi(args[4]) : int(std::thread::hardware_concurrency());
+		return simulateMatches(std::strtoull(args[2], nullptr, 10), args[3], threads) ? 0 : 1;
+	}
+	if (argc > 2 && string(args[1]) == "--query-matches")
+		return queryMatchEvents(args[2]) ? 0 : 1;
+
+	if (argc > 1 && (string(args[1]) == "--alloc-check" || string(args[1]) == "--alloc-check-strict"))
+	{
+		if (!allocationTrackingEnabled())
+		{
+			cerr << "--alloc-check needs a build with allocation tracking - regenerate with premake5 --alloc-tracking" << endl;
+			return 1;
+		}
+		allocationCheck = true;
+		allocationCheckStrict = (string(args[1]) == "--alloc-check-strict");
+		idleWaitMs = 0; // the check counts frames, so they have to keep coming even after the match is over
+	}
+	parseRenderOptions(argc, args);
+
+	//play both sides of a networked match over loopback, headless, and check they agree
+	if (argc > 1 && string(args[1]) == "--net-loopback")
+		return runLoopbackTest(parseNetworkConditions(argc, args, 2), 3000) ? 0 : 1;
+
+	if (argc > 1 && string(args[1]) == "--net" && !startNetworkSession(argc, args))
+		return 1;
+
+	trackAllocationsOnThisThread();
+
 	//setup
 	//- do just once
 	initialise();
@@ -1080,31 +859,67 @@ int main( int argc, char* args[] )
 
 	initGlew();
 
-	glViewport(0, 0, 1000, 700); //should check what the actual window res is?
+	//step courts on the GPU and on the CPU side by side, and check they agree - needs the window's GL context
+	//  --gpu-arena-check <courts> <ticks>
+	if (argc > 3 && string(args[1]) == "--gpu-arena-check")
+	{
+		bool passed = checkGpuArena(std::atoi(args[2]), std::atoi(args[3]));
+		SDL_GL_DeleteContext(context);
+		SDL_DestroyWindow(win);
+		SDL_Quit();
+		return passed ? 0 : 1;
+	}
 
 	//do stuff that only needs to happen once
 	//- create shaders
 	//- load vertex data
+	loadScene();
 	loadAssets();
+	gpuResources.printUsage("GPU resources loaded");
+
+	inputSampler.start();
+	tickCounterLength = Uint64(tickLength * SDL_GetPerformanceFrequency());
+	tickEnd = SDL_GetPerformanceCounter() + tickCounterLength;
+	netClockStart = lastNetStatsTime = SDL_GetPerformanceCounter();
+	std::thread simulation(simulationThread); // from here on, only the simulation thread touches game
 
 	while (!done) //loop until done flag is set)
 	{
-		handleInput(); // this should ONLY SET VARIABLES
-
-		updateSimulation(); // this should ONLY SET VARIABLES according to simulation
-
+		frameArena.reset();
+
+		setAllocationPhase(ALLOCATION_PHASE_INPUT);
+		inputSampler.pump(); // timestamps and queues the events - they are applied on the simulation thread
+		watchScene();
+
+		setAllocationPhase(ALLOCATION_PHASE_PRE_RENDER);
+		reportPower();
+		snapshots.update(); // pick up the newest published snapshot, if there is one
+		const FrameSnapshot &snapshot = snapshots.readBuffer();
+		int drawableWidth, drawableHeight;
+		SDL_GL_GetDrawableSize(win, &drawableWidth, &drawableHeight); // in pixels, which can differ from the window size on high DPI displays
+		if (!needFrame(snapshot, drawableWidth, drawableHeight))
+			continue; // the same as the frame on screen - it has already slept until something might have changed
+		setDrawableSize(drawableWidth, drawableHeight);
 		preRender();
 
-		render(); // this should render the world state according to VARIABLES -
+		setAllocationPhase(ALLOCATION_PHASE_RENDER);
+		render(snapshot.state, snapshot.camView, buildHudText(snapshot)); // this should render the world state according to VARIABLES -
+		inputSampler.pump(); // sample again before the swap blocks, so timestamps stay accurate under heavy render load
 
+		setAllocationPhase(ALLOCATION_PHASE_POST_RENDER);
 		postRender();
 
+		setAllocationPhase(ALLOCATION_PHASE_SETUP);
+		if (allocationCheck)
+			checkAllocations();
 	}
 
+	simulation.join();
+
 	//cleanup and exit
 	cleanUp();
 	SDL_Quit();
 
-	return 0;
+	return allocationCheckPassed ? 0 : 1;
 }
 // end::main[]
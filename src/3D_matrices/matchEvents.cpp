@@ -0,0 +1,433 @@
+#include "matchEvents.h"
+
+#include <iostream>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+// tag::columnEncodings[]
+static void putVarint(std::vector<uint8_t> &out, uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		out.push_back(uint8_t(value) | 0x80);
+		value >>= 7;
+	}
+	out.push_back(uint8_t(value));
+}
+
+static uint64_t zigzag(int64_t value) // small negative numbers become small positive ones
+{
+	return (uint64_t(value) << 1) ^ uint64_t(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value)
+{
+	return int64_t(value >> 1) ^ -int64_t(value & 1);
+}
+
+static bool isPoint(uint8_t type)
+{
+	return type == EVENT_RED_POINT || type == EVENT_BLUE_POINT;
+}
+// end::columnEncodings[]
+
+static uint32_t checksum(const uint8_t *data, size_t bytes, uint32_t hash = 2166136261u)
+{
+	for (size_t i = 0; i < bytes; i++)
+		hash = (hash ^ data[i]) * 16777619u;
+	return hash;
+}
+
+//the header with its checksum field as 0, then the columns after it
+static uint32_t blockChecksum(MatchEventBlockHeader header, const uint8_t *columns, size_t columnBytes)
+{
+	header.checksum = 0;
+	uint32_t hash = checksum(reinterpret_cast<const uint8_t *>(&header), sizeof(header));
+	return checksum(columns, columnBytes, hash);
+}
+
+//the most a column can take for eventCount events - two varints an event (a match run is two), of at most 10 bytes each
+static uint64_t maxColumnBytes(uint32_t eventCount)
+{
+	return uint64_t(eventCount) * 2 * 10;
+}
+
+MatchEventLog::MatchEventLog() : eventsWritten(0), bytesWritten(0), failed(false)
+{
+}
+
+MatchEventLog::~MatchEventLog()
+{
+	close();
+}
+
+bool MatchEventLog::open(const std::string &filePath)
+{
+	fileStream.open(filePath, std::ios::out | std::ios::binary | std::ios::app);
+	if (!fileStream)
+	{
+		cerr << "Match events could not be written - cannot open file " << filePath << endl;
+		return false;
+	}
+	return true;
+}
+
+void MatchEventLog::close()
+{
+	if (fileStream.is_open())
+		fileStream.close();
+}
+
+void MatchEventLog::appendBlock(const std::vector<uint8_t> &block, uint32_t eventCount)
+{
+	std::lock_guard<std::mutex> lock(appendMutex);
+	if (fileStream.is_open())
+	{
+		fileStream.write(reinterpret_cast<const char *>(block.data()), block.size());
+		if (!fileStream && !failed)
+		{
+			cerr << "Writing match events failed - the rest are lost" << endl;
+			failed = true;
+		}
+	}
+	eventsWritten += eventCount;
+	bytesWritten += block.size();
+}
+
+MatchEventWriter::MatchEventWriter(MatchEventLog &log) : log(log), match(0), tick(0), rally(0), courtHalfWidth(0.0f), tickLength(0.0f), count(0)
+{
+	matches.resize(blockEvents);
+	ticks.resize(blockEvents);
+	types.resize(blockEvents);
+	xs.resize(blockEvents);
+	speeds.resize(blockEvents);
+	rallies.resize(blockEvents);
+	encoded.reserve(blockEvents * 8);
+}
+
+MatchEventWriter::~MatchEventWriter()
+{
+	flush();
+}
+
+void MatchEventWriter::beginMatch(uint64_t matchId, float courtHalfWidth, double tickLength)
+{
+	if (courtHalfWidth != this->courtHalfWidth || float(tickLength) != this->tickLength)
+	{
+		flush(); // the events so far were measured against the old ones
+		this->courtHalfWidth = courtHalfWidth;
+		this->tickLength = float(tickLength);
+	}
+	match = matchId;
+	tick = 0;
+	rally = 0;
+}
+
+// tag::recordMatchEvent[]
+void MatchEventWriter::record(MatchEventType type, float x, float speed)
+{
+	if (type == EVENT_RED_HIT || type == EVENT_BLUE_HIT)
+		rally++;
+
+	matches[count] = match;
+	ticks[count] = tick;
+	types[count] = uint8_t(type);
+	xs[count] = int32_t(std::floor(x * 100.0f + 0.5f));
+	speeds[count] = int32_t(std::floor(speed * 100.0f + 0.5f));
+	rallies[count] = isPoint(uint8_t(type)) ? rally : 0;
+	if (isPoint(uint8_t(type)))
+		rally = 0;
+
+	if (++count == blockEvents)
+		flush();
+}
+// end::recordMatchEvent[]
+
+// tag::encodeBlock[]
+void MatchEventWriter::flush()
+{
+	if (count == 0)
+		return;
+
+	MatchEventBlockHeader header;
+	header.magic = MATCH_EVENTS_MAGIC;
+	header.version = MATCH_EVENTS_VERSION;
+	header.columnCount = MATCH_EVENTS_COLUMNS;
+	header.eventCount = count;
+	header.courtHalfWidth = courtHalfWidth;
+	header.tickLength = tickLength;
+
+	encoded.resize(sizeof(header)); // filled in last, when the column sizes are known
+	size_t columnStart = encoded.size();
+	auto endColumn = [&](int column) {
+		header.columnBytes[column] = uint32_t(encoded.size() - columnStart);
+		columnStart = encoded.size();
+	};
+
+	//match ids, as runs
+	uint64_t previousMatch = 0;
+	for (uint32_t i = 0; i < count; )
+	{
+		uint32_t run = 1;
+		while (i + run < count && matches[i + run] == matches[i])
+			run++;
+		putVarint(encoded, zigzag(int64_t(matches[i] - previousMatch)));
+		putVarint(encoded, run);
+		previousMatch = matches[i];
+		i += run;
+	}
+	endColumn(0);
+
+	//ticks, from the previous event of the same match
+	for (uint32_t i = 0; i < count; i++)
+		putVarint(encoded, (i > 0 && matches[i] == matches[i - 1]) ? ticks[i] - ticks[i - 1] : ticks[i]);
+	endColumn(1);
+
+	//types, two to a byte
+	for (uint32_t i = 0; i < count; i += 2)
+		encoded.push_back(uint8_t(types[i] | ((i + 1 < count ? types[i + 1] : 0) << 4)));
+	endColumn(2);
+
+	for (uint32_t i = 0; i < count; i++)
+		putVarint(encoded, zigzag(xs[i]));
+	endColumn(3);
+
+	int32_t previousSpeed = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		putVarint(encoded, zigzag(speeds[i] - previousSpeed));
+		previousSpeed = speeds[i];
+	}
+	endColumn(4);
+
+	for (uint32_t i = 0; i < count; i++)
+		if (isPoint(types[i]))
+			putVarint(encoded, rallies[i]);
+	endColumn(5);
+
+	header.checksum = blockChecksum(header, encoded.data() + sizeof(header), encoded.size() - sizeof(header));
+	std::memcpy(encoded.data(), &header, sizeof(header));
+	log.appendBlock(encoded, count);
+	count = 0;
+}
+// end::encodeBlock[]
+
+//reads varints out of one column, and notices if it runs off the end
+struct ColumnReader
+{
+	const uint8_t *next;
+	const uint8_t *end;
+	bool ok;
+
+	ColumnReader(const uint8_t *begin, size_t bytes) : next(begin), end(begin + bytes), ok(true) {}
+
+	uint64_t varint()
+	{
+		uint64_t value = 0;
+		for (int shift = 0; shift < 64; shift += 7)
+		{
+			if (next == end)
+			{
+				ok = false;
+				return 0;
+			}
+			uint8_t byte = *next++;
+			value |= uint64_t(byte & 0x7f) << shift;
+			if (!(byte & 0x80))
+				return value;
+		}
+		ok = false;
+		return value;
+	}
+};
+
+bool MatchEventReader::open(const std::string &filePath)
+{
+	path = filePath;
+	totalBytes = 0;
+	fileStream.open(filePath, std::ios::in | std::ios::binary);
+	if (!fileStream)
+	{
+		cerr << "Match events could not be read - cannot open file " << filePath << endl;
+		return false;
+	}
+	return true;
+}
+
+// tag::decodeBlock[]
+bool MatchEventReader::readBlock(std::vector<MatchEvent> &events)
+{
+	events.clear();
+	fileStream.read(reinterpret_cast<char *>(&header), sizeof(header));
+	if (fileStream.gcount() == 0)
+		return false; // the end of the file
+	if (fileStream.gcount() != sizeof(header) || header.magic != MATCH_EVENTS_MAGIC || header.version != MATCH_EVENTS_VERSION
+		|| header.columnCount != MATCH_EVENTS_COLUMNS)
+	{
+		cerr << path << " has a damaged or unknown block after " << totalBytes << " bytes - ignoring the rest" << endl;
+		return false;
+	}
+
+	//the checksum can only be tested once the columns are read, so the sizes are checked first - a damaged
+	//count would otherwise have the reader try to allocate gigabytes
+	bool sizesOk = header.eventCount > 0 && header.eventCount <= MatchEventWriter::blockEvents
+		&& header.courtHalfWidth > 0.0f && std::isfinite(header.courtHalfWidth) && header.tickLength > 0.0f && std::isfinite(header.tickLength);
+	size_t columnTotal = 0;
+	for (int c = 0; c < MATCH_EVENTS_COLUMNS && sizesOk; c++)
+	{
+		sizesOk = header.columnBytes[c] <= maxColumnBytes(header.eventCount);
+		columnTotal += header.columnBytes[c];
+	}
+	if (!sizesOk)
+	{
+		cerr << path << " has a damaged block after " << totalBytes << " bytes - ignoring the rest" << endl;
+		return false;
+	}
+
+	columns.resize(columnTotal);
+	fileStream.read(reinterpret_cast<char *>(columns.data()), columnTotal);
+	if (size_t(fileStream.gcount()) != columnTotal || blockChecksum(header, columns.data(), columnTotal) != header.checksum)
+	{
+		cerr << path << " has an incomplete or damaged block after " << totalBytes << " bytes - ignoring the rest" << endl;
+		return false;
+	}
+	totalBytes += sizeof(header) + columnTotal;
+
+	const uint8_t *start = columns.data();
+	ColumnReader matchColumn(start, header.columnBytes[0]);
+	start += header.columnBytes[0];
+	ColumnReader tickColumn(start, header.columnBytes[1]);
+	start += header.columnBytes[1];
+	const uint8_t *typeColumn = start;
+	start += header.columnBytes[2];
+	ColumnReader xColumn(start, header.columnBytes[3]);
+	start += header.columnBytes[3];
+	ColumnReader speedColumn(start, header.columnBytes[4]);
+	start += header.columnBytes[4];
+	ColumnReader rallyColumn(start, header.columnBytes[5]);
+
+	if (header.columnBytes[2] < (header.eventCount + 1) / 2)
+	{
+		cerr << path << " has a damaged block after " << totalBytes << " bytes - ignoring the rest" << endl;
+		return false;
+	}
+
+	events.resize(header.eventCount);
+	uint64_t match = 0;
+	uint64_t runLeft = 0;
+	int64_t speed = 0;
+	for (uint32_t i = 0; i < header.eventCount; i++)
+	{
+		MatchEvent &event = events[i];
+		bool newMatch = (runLeft == 0);
+		if (newMatch)
+		{
+			match += uint64_t(unzigzag(matchColumn.varint()));
+			runLeft = matchColumn.varint();
+		}
+		runLeft--;
+		event.match = match;
+		event.tick = uint32_t((newMatch ? 0 : events[i - 1].tick) + tickColumn.varint());
+
+		uint8_t type = (typeColumn[i / 2] >> ((i & 1) * 4)) & 0xf;
+		event.type = MatchEventType(std::min<uint8_t>(type, MATCH_EVENT_TYPES - 1));
+		event.x = float(unzigzag(xColumn.varint())) / 100.0f;
+		speed += unzigzag(speedColumn.varint());
+		event.speed = float(speed) / 100.0f;
+		event.rally = isPoint(type) ? uint32_t(rallyColumn.varint()) : 0;
+	}
+
+	if (!matchColumn.ok || !tickColumn.ok || !xColumn.ok || !speedColumn.ok || !rallyColumn.ok)
+	{
+		cerr << path << " has a damaged block after " << totalBytes << " bytes - ignoring the rest" << endl;
+		events.clear();
+		return false;
+	}
+	return true;
+}
+// end::decodeBlock[]
+
+// tag::queryMatchEvents[]
+//Everything is a running total, so the memory used doesn't grow with the file
+bool queryMatchEvents(const std::string &filePath)
+{
+	MatchEventReader reader;
+	if (!reader.open(filePath))
+		return false;
+
+	const char *typeNames[MATCH_EVENT_TYPES] = { "red bat hits", "blue bat hits", "wall bounces", "red points", "blue points", "red wins", "blue wins" };
+	const int rallyBuckets = 6;
+	const char *rallyNames[rallyBuckets] = { "0", "1", "2", "3-4", "5-8", "9+" };
+	const int hitBuckets = 10; // across the court, from wall to wall - each block says how wide its court is
+
+	uint64_t typeCounts[MATCH_EVENT_TYPES] = {};
+	uint64_t rallyCounts[rallyBuckets] = {};
+	uint64_t hitCounts[hitBuckets] = {};
+	uint64_t events = 0, blocks = 0, rallyTotal = 0, longestRally = 0;
+	double hitSpeedTotal = 0.0, matchSeconds = 0.0;
+
+	std::vector<MatchEvent> block;
+	while (reader.readBlock(block))
+	{
+		const float halfWidth = reader.block().courtHalfWidth;
+		const double tickLength = reader.block().tickLength;
+		blocks++;
+		events += block.size();
+		for (const MatchEvent &event : block)
+		{
+			typeCounts[event.type]++;
+			if (event.type == EVENT_RED_POINT || event.type == EVENT_BLUE_POINT)
+			{
+				rallyTotal += event.rally;
+				longestRally = std::max<uint64_t>(longestRally, event.rally);
+				int bucket = event.rally < 3 ? int(event.rally) : event.rally < 5 ? 3 : event.rally < 9 ? 4 : 5;
+				rallyCounts[bucket]++;
+			}
+			else if (event.type == EVENT_RED_HIT || event.type == EVENT_BLUE_HIT)
+			{
+				hitSpeedTotal += event.speed;
+				int bucket = int((event.x + halfWidth) / (2.0f * halfWidth) * hitBuckets);
+				hitCounts[std::max(0, std::min(bucket, hitBuckets - 1))]++;
+			}
+			else if (event.type == EVENT_RED_WIN || event.type == EVENT_BLUE_WIN)
+			{
+				matchSeconds += event.tick * tickLength;
+			}
+		}
+	}
+
+	uint64_t matches = typeCounts[EVENT_RED_WIN] + typeCounts[EVENT_BLUE_WIN];
+	uint64_t points = typeCounts[EVENT_RED_POINT] + typeCounts[EVENT_BLUE_POINT];
+	uint64_t hits = typeCounts[EVENT_RED_HIT] + typeCounts[EVENT_BLUE_HIT];
+
+	cout << filePath << ": " << events << " events in " << blocks << " blocks, " << reader.bytesRead() << " bytes ("
+		<< (events ? double(reader.bytesRead()) / events : 0.0) << " bytes per event)" << endl;
+	cout << "Finished matches: " << matches << ", red won " << typeCounts[EVENT_RED_WIN] << ", blue won " << typeCounts[EVENT_BLUE_WIN];
+	if (matches > 0)
+		cout << ", " << matchSeconds / matches << " s on average";
+	cout << endl;
+	for (int t = 0; t < MATCH_EVENT_TYPES; t++)
+		cout << "  " << typeNames[t] << ": " << typeCounts[t] << endl;
+
+	if (points > 0)
+	{
+		cout << "Rallies: " << double(rallyTotal) / points << " bat hits on average, longest " << longestRally << endl;
+		for (int b = 0; b < rallyBuckets; b++)
+			cout << "  " << rallyNames[b] << " hits: " << rallyCounts[b] << endl;
+	}
+	if (hits > 0)
+	{
+		cout << "Ball speed at bat hits: " << hitSpeedTotal / hits << " on average" << endl;
+		cout << "Where the bats hit the ball, left to right:";
+		for (int b = 0; b < hitBuckets; b++)
+			cout << " " << hitCounts[b];
+		cout << endl;
+	}
+	return true;
+}
+// end::queryMatchEvents[]
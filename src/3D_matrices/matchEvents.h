@@ -0,0 +1,167 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <mutex>
+
+// tag::matchEvent[]
+enum MatchEventType
+{
+	EVENT_RED_HIT, // the ball bounced off a bat
+	EVENT_BLUE_HIT,
+	EVENT_WALL_BOUNCE,
+	EVENT_RED_POINT, // a goal - see resetBall
+	EVENT_BLUE_POINT,
+	EVENT_RED_WIN, // the point that ended the match, straight after its EVENT_RED_POINT
+	EVENT_BLUE_WIN,
+	MATCH_EVENT_TYPES
+};
+
+//one event, as the query side sees it - on disk, events are stored a column at a time (see below)
+struct MatchEvent
+{
+	uint64_t match;
+	uint32_t tick; // ticks since the match started
+	MatchEventType type;
+	float x; // where the ball was across the court
+	float speed; // how fast it was going
+	uint32_t rally; // for points, the number of bat hits in the rally - 0 for everything else
+};
+// end::matchEvent[]
+
+// tag::matchEventFormat[]
+// A .matchevents file is a sequence of self-contained blocks, only ever appended to, so several writers
+// can share one file, files can be joined with cat, and a crash loses at most the block being written.
+//
+//   MatchEventBlockHeader - with the court width and tick length the block's matches were played with, so
+//                           positions and times can be read back without knowing how the game was set up
+//   one column for each field, one after another, columnBytes[i] bytes each
+//
+// The columns are packed with encodings that suit them, rather than a general purpose compressor:
+//
+//   match  runs of (match id delta, event count), as varints - a match's events are all together
+//   tick   delta from the previous event in the same match, as varints
+//   type   4 bits per event
+//   x      hundredths of a unit, zigzag varints
+//   speed  hundredths of a unit per second, zigzag varint deltas - mostly 0, as the ball keeps its speed
+//   rally  one varint per point event only
+//
+// which comes to around 5 bytes per event, against 24 for the MatchEvent struct. All values are little endian.
+const uint32_t MATCH_EVENTS_MAGIC = 0x4256454D; // "MEVB"
+const uint16_t MATCH_EVENTS_VERSION = 3; // 2 - the checksum covers the header too, 3 - the court width and tick length
+const uint16_t MATCH_EVENTS_COLUMNS = 6;
+
+struct MatchEventBlockHeader
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t columnCount;
+	uint32_t eventCount;
+	uint32_t checksum; // FNV-1a of the header (with this as 0) then the column bytes, so a torn or damaged block is spotted
+	float courtHalfWidth; // CourtLayout::halfWidth - x runs from -courtHalfWidth to courtHalfWidth
+	float tickLength; // seconds
+	uint32_t columnBytes[MATCH_EVENTS_COLUMNS];
+};
+// end::matchEventFormat[]
+
+// tag::matchEventLog[]
+//The file every writer appends its blocks to. Appending a block is the only thing that takes the lock,
+//and that happens once per MatchEventWriter::blockEvents events.
+class MatchEventLog
+{
+public:
+	MatchEventLog();
+	~MatchEventLog();
+
+	bool open(const std::string &filePath); // appends to the file if it's already there
+	void close();
+
+	//without a file, blocks are only counted - for measuring the cost of recording
+	void appendBlock(const std::vector<uint8_t> &block, uint32_t eventCount);
+
+	uint64_t events() const { return eventsWritten; }
+	uint64_t bytes() const { return bytesWritten; }
+
+private:
+	MatchEventLog(const MatchEventLog &);
+	MatchEventLog &operator=(const MatchEventLog &);
+
+	std::ofstream fileStream;
+	std::mutex appendMutex;
+	uint64_t eventsWritten;
+	uint64_t bytesWritten;
+	bool failed;
+};
+// end::matchEventLog[]
+
+// tag::matchEventWriter[]
+//Collects the events of one thread's matches, and encodes them into a block when enough have built up.
+//
+//  - record() only appends to plain arrays, so the simulation pays a few stores per event - the encoding
+//    happens once per block, and the lock and the write once per block too
+//  - give each simulation thread its own writer - a writer is not thread safe, the log is
+//  - updateSimulation() calls nextTick(), so events are stamped with the tick they happened in
+//  - a block only holds matches played on one court width at one tick length - beginMatch() starts a new
+//    block if either changes
+class MatchEventWriter
+{
+public:
+	static const uint32_t blockEvents = 65536;
+
+	explicit MatchEventWriter(MatchEventLog &log);
+	~MatchEventWriter(); // flushes
+
+	void beginMatch(uint64_t matchId, float courtHalfWidth, double tickLength);
+	void record(MatchEventType type, float x, float speed);
+	void nextTick() { tick++; }
+	void flush(); // encode and append what has been recorded so far
+
+private:
+	MatchEventWriter(const MatchEventWriter &);
+	MatchEventWriter &operator=(const MatchEventWriter &);
+
+	MatchEventLog &log;
+	uint64_t match;
+	uint32_t tick;
+	uint32_t rally; // bat hits since the last point
+	float courtHalfWidth; // of the block being collected
+	float tickLength;
+
+	//the block being collected, a column per field
+	uint32_t count;
+	std::vector<uint64_t> matches;
+	std::vector<uint32_t> ticks;
+	std::vector<uint8_t> types;
+	std::vector<int32_t> xs;
+	std::vector<int32_t> speeds;
+	std::vector<uint32_t> rallies;
+
+	std::vector<uint8_t> encoded; // reused for every block
+};
+// end::matchEventWriter[]
+
+// tag::matchEventReader[]
+//Reads a .matchevents file back a block at a time
+class MatchEventReader
+{
+public:
+	MatchEventReader() : header(), totalBytes(0) {}
+
+	bool open(const std::string &filePath);
+	bool readBlock(std::vector<MatchEvent> &events); // false at the end of the file, or at a damaged block
+	const MatchEventBlockHeader &block() const { return header; } // the header of the block readBlock last read
+
+	uint64_t bytesRead() const { return totalBytes; }
+
+private:
+	std::ifstream fileStream;
+	std::string path;
+	MatchEventBlockHeader header;
+	std::vector<uint8_t> columns;
+	uint64_t totalBytes;
+};
+
+bool queryMatchEvents(const std::string &filePath); // prints aggregates over every event in the file
+// end::matchEventReader[]
@@ -0,0 +1,502 @@
+#include "meshStreamer.h"
+
+#include <iostream>
+#include <fstream>
+#include <cmath>
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+MeshStreamer::MeshStreamer()
+	: positionLocation(-1), colorLocation(-1), normalLocation(-1), residentBytes(0), frameNumber(0), evictedLevels(0), overBudgetReported(false), loading(false), stopping(false)
+{
+}
+
+MeshStreamer::~MeshStreamer()
+{
+	stop();
+}
+
+void MeshStreamer::setVertexAttributes(GLint positionLocation, GLint colorLocation, GLint normalLocation)
+{
+	this->positionLocation = positionLocation;
+	this->colorLocation = colorLocation;
+	this->normalLocation = normalLocation;
+}
+
+// tag::meshStreamerThread[]
+void MeshStreamer::start()
+{
+	if (worker.joinable())
+		return;
+	stopping = false;
+	worker = std::thread(&MeshStreamer::workerLoop, this);
+	cout << "Mesh streaming thread started OK!\n";
+}
+
+void MeshStreamer::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		stopping = true;
+	}
+	queueCondition.notify_all();
+	if (worker.joinable())
+		worker.join();
+}
+
+int MeshStreamer::addMesh(const std::string &filePath, const char *mappedData, size_t mappedSize)
+{
+	meshes.push_back(StreamedMesh());
+	StreamedMesh &mesh = meshes.back();
+	mesh.filePath = filePath;
+	mesh.mappedData = mappedData;
+	mesh.mappedSize = mappedSize;
+	mesh.lodCount = 0;
+	mesh.boundingCenter = glm::vec3(0.0f);
+	mesh.boundingRadius = 0.0f;
+	memset(mesh.levels, 0, sizeof(mesh.levels));
+	return int(meshes.size()) - 1;
+}
+
+int MeshStreamer::requestMesh(const std::string &filePath)
+{
+	LoadRequest request;
+	request.meshId = addMesh(filePath, nullptr, 0);
+	request.filePath = filePath;
+	request.lod = -1;
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		requests.push_back(request);
+	}
+	queueCondition.notify_one();
+	return request.meshId;
+}
+
+//a mesh that is already in memory has nothing to wait for - every level is queued for upload now, coarsest first
+int MeshStreamer::requestMesh(const std::string &name, const char *data, size_t size)
+{
+	LoadedLod table;
+	if (size < sizeof(LodMeshHeader))
+	{
+		cerr << "Mesh could not be loaded - " << name << " is truncated." << endl;
+		return -1;
+	}
+	std::memcpy(&table.header, data, sizeof(table.header));
+	if (!validateLodMeshHeader(table.header, name))
+		return -1;
+	if (sizeof(LodMeshHeader) + table.header.lodCount * sizeof(LodMeshLevel) > size)
+	{
+		cerr << "Mesh could not be loaded - " << name << " is truncated." << endl;
+		return -1;
+	}
+	std::memcpy(table.levels, data + sizeof(LodMeshHeader), table.header.lodCount * sizeof(LodMeshLevel));
+	if (!validateLevels(table.levels, table.header.lodCount, size, name))
+		return -1;
+
+	table.meshId = addMesh(name, data, size);
+	table.failed = false;
+
+	std::lock_guard<std::mutex> lock(queueMutex);
+	for (int lod = int(table.header.lodCount) - 1; lod >= 0; lod--)
+	{
+		LoadedLod loadedLod = table;
+		loadedLod.lod = lod;
+		loadedLod.mappedVertices = data + table.levels[lod].vertexOffset;
+		loadedLod.mappedIndices = data + table.levels[lod].indexOffset;
+		loaded.push_back(loadedLod);
+	}
+	return table.meshId;
+}
+
+//every level must be inside the file, so a damaged file can't send a read or an upload out of range
+bool MeshStreamer::validateLevels(const LodMeshLevel *levels, uint32_t lodCount, uint64_t fileSize, const std::string &filePath)
+{
+	for (uint32_t lod = 0; lod < lodCount; lod++)
+	{
+		const LodMeshLevel &level = levels[lod];
+		if ((level.indexSize != 2 && level.indexSize != 4)
+			|| level.vertexOffset + uint64_t(level.vertexCount) * sizeof(PackedVertex) > fileSize
+			|| level.indexOffset + uint64_t(level.indexCount) * level.indexSize > fileSize)
+		{
+			cerr << "Mesh could not be loaded - level " << lod << " of " << filePath << " is out of range." << endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+void MeshStreamer::workerLoop()
+{
+	while (true)
+	{
+		LoadRequest request;
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			queueCondition.wait(lock, [this] { return stopping || !requests.empty(); });
+			if (stopping)
+				return;
+			request = requests.front();
+			requests.pop_front();
+			loading = true;
+		}
+		int pendingLod = request.lod;
+		if (!loadFile(request, pendingLod))
+			reportFailed(request.meshId, pendingLod, std::max(request.lod, 0));
+		std::lock_guard<std::mutex> lock(queueMutex);
+		loading = false;
+	}
+}
+
+//the levels from coarsest down to finest aren't coming - the GL thread clears their requests, so they can be asked for again
+//later rather than never. Nothing is sent for a first load that failed before the file said which levels there are
+void MeshStreamer::reportFailed(int meshId, int coarsest, int finest)
+{
+	std::lock_guard<std::mutex> lock(queueMutex);
+	if (stopping)
+		return;
+	for (int lod = coarsest; lod >= finest; lod--)
+	{
+		LoadedLod failedLod;
+		failedLod.meshId = meshId;
+		failedLod.lod = lod;
+		failedLod.failed = true;
+		loaded.push_back(std::move(failedLod));
+	}
+}
+
+bool MeshStreamer::streaming()
+{
+	std::lock_guard<std::mutex> lock(queueMutex);
+	return loading || !requests.empty() || !loaded.empty();
+}
+
+//false if the file can't be read - pendingLod is then the coarsest level that was asked for and not sent, or -1 if none was known
+bool MeshStreamer::loadFile(const LoadRequest &request, int &pendingLod)
+{
+	std::ifstream fileStream(request.filePath, std::ios::in | std::ios::binary);
+	if (!fileStream)
+	{
+		cerr << "Mesh could not be loaded - cannot read file " << request.filePath << ". Using the built in geometry." << endl;
+		return false;
+	}
+
+	fileStream.seekg(0, std::ios::end);
+	uint64_t fileSize = uint64_t(fileStream.tellg());
+	fileStream.seekg(0, std::ios::beg);
+
+	LoadedLod table;
+	table.meshId = request.meshId;
+	table.failed = false;
+	table.mappedVertices = table.mappedIndices = nullptr;
+	fileStream.read(reinterpret_cast<char *>(&table.header), sizeof(table.header));
+	if (!fileStream || !validateLodMeshHeader(table.header, request.filePath))
+		return false;
+	fileStream.read(reinterpret_cast<char *>(table.levels), table.header.lodCount * sizeof(LodMeshLevel));
+	if (!fileStream)
+	{
+		cerr << "Mesh could not be loaded - " << request.filePath << " is truncated." << endl;
+		return false;
+	}
+
+	if (!validateLevels(table.levels, table.header.lodCount, fileSize, request.filePath))
+		return false;
+
+	//stream coarsest first, so there is something cheap to draw as soon as possible - or just the one level asked for again
+	int coarsest = int(table.header.lodCount) - 1;
+	int finest = 0;
+	if (request.lod >= 0)
+	{
+		if (request.lod > coarsest)
+		{
+			cerr << "Mesh could not be reloaded - " << request.filePath << " no longer has a level " << request.lod << "." << endl;
+			return false;
+		}
+		coarsest = finest = request.lod;
+	}
+	pendingLod = coarsest;
+	for (int lod = coarsest; lod >= finest; lod--)
+	{
+		const LodMeshLevel &level = table.levels[lod];
+		LoadedLod loadedLod = table;
+		loadedLod.lod = lod;
+		loadedLod.vertexBytes.resize(level.vertexCount * sizeof(PackedVertex));
+		loadedLod.indexBytes.resize(level.indexCount * level.indexSize);
+
+		fileStream.seekg(level.vertexOffset);
+		fileStream.read(loadedLod.vertexBytes.data(), loadedLod.vertexBytes.size());
+		fileStream.seekg(level.indexOffset);
+		fileStream.read(loadedLod.indexBytes.data(), loadedLod.indexBytes.size());
+		if (!fileStream)
+		{
+			cerr << "Mesh could not be loaded - reading level " << lod << " of " << request.filePath << " failed." << endl;
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(queueMutex);
+		if (stopping)
+			return true;
+		loaded.push_back(std::move(loadedLod));
+		pendingLod = lod - 1;
+	}
+	return true;
+}
+// end::meshStreamerThread[]
+
+// tag::uploadPending[]
+void MeshStreamer::uploadPending(size_t byteBudget)
+{
+	frameNumber++;
+	makeRoom(0); // levels that went out of view since the last frame, if we're over
+	size_t uploadedBytes = 0;
+	while (uploadedBytes < byteBudget)
+	{
+		LoadedLod loadedLod;
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			if (loaded.empty())
+				break;
+			loadedLod = std::move(loaded.front());
+			loaded.pop_front();
+		}
+		if (loadedLod.failed)
+		{
+			levelFailed(loadedLod);
+			continue;
+		}
+		const LodMeshLevel &level = loadedLod.levels[loadedLod.lod];
+		size_t levelBytes = level.vertexCount * sizeof(PackedVertex) + level.indexCount * level.indexSize;
+		makeRoom(levelBytes);
+		uploadLod(loadedLod);
+		uploadedBytes += levelBytes;
+	}
+}
+
+void MeshStreamer::uploadLod(const LoadedLod &loadedLod)
+{
+	StreamedMesh &mesh = meshes[loadedLod.meshId];
+	if (mesh.lodCount == 0)
+	{
+		mesh.lodCount = int(loadedLod.header.lodCount);
+		mesh.boundingCenter = glm::vec3(loadedLod.header.boundingCenter[0], loadedLod.header.boundingCenter[1], loadedLod.header.boundingCenter[2]);
+		mesh.boundingRadius = loadedLod.header.boundingRadius;
+		std::memcpy(mesh.levels, loadedLod.levels, sizeof(mesh.levels));
+		for (int lod = 0; lod < mesh.lodCount; lod++)
+		{
+			mesh.lods[lod].minScreenCoverage = loadedLod.levels[lod].minScreenCoverage;
+			mesh.lods[lod].requested = true; // the rest of the levels are on their way
+		}
+	}
+
+	const LodMeshLevel &level = loadedLod.levels[loadedLod.lod];
+	GpuLod &gpuLod = mesh.lods[loadedLod.lod];
+	gpuLod.requested = false;
+	if (gpuLod.resident)
+		return;
+	size_t vertexBytes = level.vertexCount * sizeof(PackedVertex);
+	size_t indexBytes = level.indexCount * level.indexSize;
+	const char *vertices = loadedLod.mappedVertices ? loadedLod.mappedVertices : loadedLod.vertexBytes.data(); // straight from the mapping, if it's in one
+	const char *indices = loadedLod.mappedIndices ? loadedLod.mappedIndices : loadedLod.indexBytes.data();
+
+	gpuLod.vertexBufferObject = GpuBuffer::create("mesh vertices");
+	gpuLod.indexBufferObject = GpuBuffer::create("mesh indices");
+	gpuLod.vertexArrayObject = GpuVertexArray::create("mesh");
+
+	glBindVertexArray(gpuLod.vertexArrayObject.get());
+
+		glBindBuffer(GL_ARRAY_BUFFER, gpuLod.vertexBufferObject.get());
+		gpuLod.vertexBufferObject.upload(GL_ARRAY_BUFFER, vertexBytes, vertices, GL_STATIC_DRAW);
+
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpuLod.indexBufferObject.get()); //element buffer binding is stored in the VAO
+		gpuLod.indexBufferObject.upload(GL_ELEMENT_ARRAY_BUFFER, indexBytes, indices, GL_STATIC_DRAW);
+
+		glEnableVertexAttribArray(positionLocation);
+		glEnableVertexAttribArray(colorLocation);
+		glEnableVertexAttribArray(normalLocation);
+		glVertexAttribPointer(positionLocation, 3, GL_FLOAT, GL_FALSE, sizeof(PackedVertex), (GLvoid *)offsetof(PackedVertex, position));
+		glVertexAttribPointer(colorLocation, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PackedVertex), (GLvoid *)offsetof(PackedVertex, color)); //normalised bytes arrive in the shader as 0..1 floats
+		glVertexAttribPointer(normalLocation, 3, GL_BYTE, GL_TRUE, sizeof(PackedVertex), (GLvoid *)offsetof(PackedVertex, normal)); //and signed ones as -1..1
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	gpuLod.indexCount = GLsizei(level.indexCount);
+	gpuLod.indexType = (level.indexSize == 2) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	gpuLod.resident = true;
+	gpuLod.bytes = vertexBytes + indexBytes;
+	gpuLod.lastUsedFrame = frameNumber; // counts as drawn, so it isn't evicted before it has had the chance
+	residentBytes += gpuLod.bytes;
+
+	cout << "\nMesh " << mesh.filePath << " level " << loadedLod.lod << " resident (" << level.indexCount / 3 << " triangles)" << endl;
+}
+
+//a level the worker couldn't read - a while later selectLod asks for it again, in case the file was part way through being replaced
+void MeshStreamer::levelFailed(const LoadedLod &failedLod)
+{
+	const uint64_t retryFrames = 300;
+	StreamedMesh &mesh = meshes[failedLod.meshId];
+	if (failedLod.lod >= mesh.lodCount)
+		return; // the first load failed before anything arrived - the mesh is never drawn, as with a missing file
+	GpuLod &gpuLod = mesh.lods[failedLod.lod];
+	gpuLod.requested = false;
+	gpuLod.retryFrame = frameNumber + retryFrames;
+}
+// end::uploadPending[]
+
+// tag::evictLods[]
+//evicts the least recently drawn levels until `bytes` more fit in the budget - a level drawn last frame is never evicted,
+//so if those alone are over the budget we go over it rather than have meshes flicker between levels
+void MeshStreamer::makeRoom(size_t bytes)
+{
+	while (gpuResources.overBudget(bytes))
+	{
+		StreamedMesh *oldestMesh = nullptr;
+		int oldestLod = -1;
+		uint64_t oldestFrame = frameNumber - 1;
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			for (int lod = 0; lod < meshes[i].lodCount; lod++)
+			{
+				const GpuLod &gpuLod = meshes[i].lods[lod];
+				if (gpuLod.resident && gpuLod.lastUsedFrame < oldestFrame)
+				{
+					oldestMesh = &meshes[i];
+					oldestLod = lod;
+					oldestFrame = gpuLod.lastUsedFrame;
+				}
+			}
+		}
+		if (oldestMesh == nullptr)
+		{
+			if (!overBudgetReported)
+				cerr << "\nThe GPU memory budget (" << gpuResources.budget() / 1024 << " KB) is too small for the meshes in use - going over it" << endl;
+			overBudgetReported = true;
+			return;
+		}
+		evict(*oldestMesh, oldestLod);
+	}
+}
+
+void MeshStreamer::evict(StreamedMesh &mesh, int lod)
+{
+	GpuLod &gpuLod = mesh.lods[lod];
+	gpuLod.vertexArrayObject.reset();
+	gpuLod.vertexBufferObject.reset();
+	gpuLod.indexBufferObject.reset();
+	gpuLod.resident = false;
+	residentBytes -= gpuLod.bytes;
+	evictedLevels++;
+	cout << "\nMesh " << mesh.filePath << " level " << lod << " evicted (" << gpuLod.bytes / 1024 << " KB)" << endl;
+}
+
+//loads an evicted level again - from the mapping if the mesh is in an asset pack, otherwise the worker reads it from the file
+void MeshStreamer::requestLod(int meshId, int lod)
+{
+	StreamedMesh &mesh = meshes[meshId];
+	mesh.lods[lod].requested = true;
+	if (mesh.mappedData != nullptr)
+	{
+		LoadedLod loadedLod;
+		loadedLod.meshId = meshId;
+		loadedLod.lod = lod;
+		loadedLod.failed = false;
+		std::memcpy(&loadedLod.header, mesh.mappedData, sizeof(loadedLod.header));
+		std::memcpy(loadedLod.levels, mesh.levels, sizeof(loadedLod.levels));
+		loadedLod.mappedVertices = mesh.mappedData + mesh.levels[lod].vertexOffset;
+		loadedLod.mappedIndices = mesh.mappedData + mesh.levels[lod].indexOffset;
+		std::lock_guard<std::mutex> lock(queueMutex);
+		loaded.push_back(std::move(loadedLod));
+		return;
+	}
+
+	LoadRequest request;
+	request.meshId = meshId;
+	request.filePath = mesh.filePath;
+	request.lod = lod;
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		requests.push_back(request);
+	}
+	queueCondition.notify_one();
+}
+// end::evictLods[]
+
+void MeshStreamer::releaseAll()
+{
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		loaded.clear(); // levels not uploaded yet may point into an asset pack that is about to be closed
+	}
+
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		for (int lod = 0; lod < meshes[i].lodCount; lod++)
+		{
+			GpuLod &gpuLod = meshes[i].lods[lod];
+			gpuLod.vertexArrayObject.reset();
+			gpuLod.vertexBufferObject.reset();
+			gpuLod.indexBufferObject.reset();
+			gpuLod.resident = false;
+			gpuLod.requested = false;
+		}
+	}
+	residentBytes = 0;
+}
+
+// tag::selectLod[]
+int MeshStreamer::selectLod(int meshId, const glm::mat4 &modelViewMatrix, const glm::mat4 &projectionMatrix)
+{
+	if (meshId < 0 || meshId >= int(meshes.size()))
+		return -1;
+	StreamedMesh &mesh = meshes[meshId];
+	if (mesh.lodCount == 0)
+		return -1;
+
+	//project the bounding sphere: its radius in normalised device coordinates is r * projection[1][1] / distance,
+	//and as NDC spans 2 units, that is also the fraction of the viewport height the diameter covers
+	glm::vec4 center = modelViewMatrix * glm::vec4(mesh.boundingCenter, 1.0f);
+	float distance = std::max(-center.z, 0.001f);
+	float scale = glm::length(glm::vec3(modelViewMatrix[0]));
+	float coverage = mesh.boundingRadius * scale * std::fabs(projectionMatrix[1][1]) / distance;
+
+	int desired = mesh.lodCount - 1;
+	for (int lod = 0; lod < mesh.lodCount; lod++)
+	{
+		if (coverage >= mesh.lods[lod].minScreenCoverage)
+		{
+			desired = lod;
+			break;
+		}
+	}
+
+	GpuLod &desiredLod = mesh.lods[desired];
+	if (!desiredLod.resident && !desiredLod.requested && frameNumber >= desiredLod.retryFrame)
+		requestLod(meshId, desired); // it was evicted - stream it back in, and draw another level until it's here
+
+	//prefer the desired level, then coarser ones (they stream in first), then finer ones
+	int selected = -1;
+	for (int lod = desired; lod < mesh.lodCount && selected < 0; lod++)
+		if (mesh.lods[lod].resident)
+			selected = lod;
+	for (int lod = desired - 1; lod >= 0 && selected < 0; lod--)
+		if (mesh.lods[lod].resident)
+			selected = lod;
+	if (selected >= 0)
+		mesh.lods[selected].lastUsedFrame = frameNumber;
+	return selected;
+}
+// end::selectLod[]
+
+void MeshStreamer::fillDrawCommand(int meshId, int lod, DrawCommand &command) const
+{
+	const GpuLod &gpuLod = meshes[meshId].lods[lod];
+	command.vertexArray = gpuLod.vertexArrayObject.get();
+	command.mode = GL_TRIANGLES;
+	command.first = 0;
+	command.count = gpuLod.indexCount;
+	command.indexType = gpuLod.indexType;
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <GL/glew.h>
+
+#define GLM_FORCE_RADIANS // suppress a warning in GLM 0.9.5
+#include <glm/glm.hpp>
+
+#include "lodMesh.h"
+#include "renderQueue.h"
+#include "gpuResources.h"
+
+// tag::meshStreamer[]
+//Loads .lodmesh files on a background thread and hands them to the GL thread one level at a time.
+//
+//  - the worker reads the coarsest level first, so something can be drawn as early as possible
+//  - GL objects can only be created on the thread that owns the context, so the worker only
+//    fills staging memory; uploadPending() moves at most `byteBudget` bytes per call into
+//    buffers, which keeps the frame time flat while large assets stream in
+//  - a mesh that is already in memory - in an asset pack's mapping - skips the worker: its levels are
+//    queued straight away and uploaded from where they are, with no copy in between
+//  - selectLod() picks a level from the screen-space size of the bounding sphere, falling
+//    back to whichever level is already resident
+//  - the levels are the one thing on the GPU that can be thrown away and loaded again, so they are what
+//    gives way to the GPU memory budget (see gpuResources.h): before an upload would go over it, the levels
+//    least recently drawn are evicted - never one drawn last frame. A level that is wanted again is re-read
+//    from its file, or its asset pack, and streamed back in like the first time
+class MeshStreamer
+{
+public:
+	MeshStreamer();
+	~MeshStreamer();
+
+	void setVertexAttributes(GLint positionLocation, GLint colorLocation, GLint normalLocation);
+	void start();
+	void stop();
+
+	int requestMesh(const std::string &filePath); // returns an id to draw with - loading happens in the background
+	int requestMesh(const std::string &name, const char *data, size_t size); // a .lodmesh in memory, which must stay there until it is uploaded - -1 if it's damaged
+	void uploadPending(size_t byteBudget); // GL thread only
+	void releaseAll(); // GL thread only - deletes all buffers and VAOs
+
+	int selectLod(int meshId, const glm::mat4 &modelViewMatrix, const glm::mat4 &projectionMatrix); // -1 if nothing is resident yet - asks for the level it wants, if it was evicted
+	void fillDrawCommand(int meshId, int lod, DrawCommand &command) const; // the vertex array and index range to draw
+
+	size_t bytesResident() const { return residentBytes; }
+	uint64_t levelsEvicted() const { return evictedLevels; }
+	bool streaming(); // true while a level is still being read, or waiting to be uploaded
+
+private:
+	struct GpuLod
+	{
+		GpuLod() : resident(false), requested(false), indexCount(0), indexType(GL_UNSIGNED_SHORT), minScreenCoverage(0.0f), bytes(0), lastUsedFrame(0), retryFrame(0) {}
+
+		bool resident;
+		bool requested; // on its way from the worker or the pack - so it isn't asked for twice
+		GpuBuffer vertexBufferObject;
+		GpuBuffer indexBufferObject;
+		GpuVertexArray vertexArrayObject;
+		GLsizei indexCount;
+		GLenum indexType;
+		float minScreenCoverage;
+		size_t bytes;
+		uint64_t lastUsedFrame;
+		uint64_t retryFrame; // after a failed read, the level isn't asked for again until this frame
+	};
+
+	struct StreamedMesh
+	{
+		std::string filePath;
+		const char *mappedData; // the .lodmesh in an asset pack's mapping - null for one read from its own file
+		size_t mappedSize;
+		int lodCount; // 0 until the header has been read
+		glm::vec3 boundingCenter;
+		float boundingRadius;
+		LodMeshLevel levels[LOD_MESH_MAX_LEVELS]; // the file's level table, to load a level again after it's evicted
+		GpuLod lods[LOD_MESH_MAX_LEVELS];
+	};
+
+	struct LoadRequest
+	{
+		int meshId;
+		std::string filePath;
+		int lod; // -1 for every level, coarsest first
+	};
+
+	struct LoadedLod
+	{
+		int meshId;
+		int lod;
+		bool failed; // the level couldn't be read - there is nothing to upload, only its request to clear
+		LodMeshHeader header;
+		LodMeshLevel levels[LOD_MESH_MAX_LEVELS]; // the whole table, so the first level to arrive can set up the mesh
+		const char *mappedVertices; // where the level is in memory, for a mesh in an asset pack - null when it's read into the vectors below
+		const char *mappedIndices;
+		std::vector<char> vertexBytes;
+		std::vector<char> indexBytes;
+	};
+
+	static bool validateLevels(const LodMeshLevel *levels, uint32_t lodCount, uint64_t fileSize, const std::string &filePath);
+	void workerLoop();
+	bool loadFile(const LoadRequest &request, int &pendingLod);
+	void reportFailed(int meshId, int coarsest, int finest);
+	void uploadLod(const LoadedLod &loaded);
+	void levelFailed(const LoadedLod &loaded);
+	int addMesh(const std::string &filePath, const char *mappedData, size_t mappedSize);
+	void requestLod(int meshId, int lod);
+	void makeRoom(size_t bytes);
+	void evict(StreamedMesh &mesh, int lod);
+
+	// owned by the GL thread
+	std::vector<StreamedMesh> meshes;
+	GLint positionLocation;
+	GLint colorLocation;
+	GLint normalLocation;
+	size_t residentBytes;
+	uint64_t frameNumber; // counted by uploadPending, for least recently used
+	uint64_t evictedLevels;
+	bool overBudgetReported;
+
+	// shared with the worker
+	std::thread worker;
+	std::mutex queueMutex;
+	std::condition_variable queueCondition;
+	std::deque<LoadRequest> requests;
+	std::deque<LoadedLod> loaded;
+	bool loading; // the worker has taken a request, and not finished it yet
+	bool stopping;
+};
+// end::meshStreamer[]
@@ -0,0 +1,546 @@
+#include "netSession.h"
+
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+static const float batSpeed = 3.0f; // the same speed the keyboard gives a bat
+
+enum PacketType
+{
+	PACKET_HELLO = 'H',
+	PACKET_INPUTS = 'I',
+	PACKET_SNAPSHOT = 'S'
+};
+
+void applyPlayerInputs(GameState &state, const PlayerInput inputs[2])
+{
+	state.velocity1.x = batSpeed * inputs[RED_PLAYER].move;
+	state.velocity2.x = batSpeed * inputs[BLUE_PLAYER].move;
+}
+
+// ============================= packet helpers =============================
+// everything is written byte by byte, little-endian, so both ends agree whatever the platform
+
+static void writeU32(uint8_t *&out, uint32_t value)
+{
+	for (int i = 0; i < 4; i++)
+		*out++ = uint8_t(value >> (8 * i));
+}
+
+static uint32_t readU32(const uint8_t *&in)
+{
+	uint32_t value = 0;
+	for (int i = 0; i < 4; i++)
+		value |= uint32_t(*in++) << (8 * i);
+	return value;
+}
+
+static void writeFloat(uint8_t *&out, float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	writeU32(out, bits);
+}
+
+static float readFloat(const uint8_t *&in)
+{
+	uint32_t bits = readU32(in);
+	float value;
+	std::memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+static void serialiseState(const GameState &state, uint8_t *out)
+{
+	const glm::vec3 *vectors[6] = { &state.position1, &state.velocity1, &state.position2, &state.velocity2, &state.ballPosition, &state.ballVelocity };
+	for (int v = 0; v < 6; v++)
+		for (int i = 0; i < 3; i++)
+			writeFloat(out, (*vectors[v])[i]);
+	writeFloat(out, state.rotateAngle);
+	writeU32(out, state.redScore);
+	writeU32(out, state.blueScore);
+	*out++ = state.gameOver ? 1 : 0;
+}
+
+static void deserialiseState(const uint8_t *in, GameState &state)
+{
+	glm::vec3 *vectors[6] = { &state.position1, &state.velocity1, &state.position2, &state.velocity2, &state.ballPosition, &state.ballVelocity };
+	for (int v = 0; v < 6; v++)
+		for (int i = 0; i < 3; i++)
+			(*vectors[v])[i] = readFloat(in);
+	state.rotateAngle = readFloat(in);
+	state.redScore = readU32(in);
+	state.blueScore = readU32(in);
+	state.gameOver = (*in++ != 0);
+}
+
+// tag::deltaCompression[]
+//XOR against the baseline, so everything that didn't change becomes zero, then run-length encode
+//the zeros: pairs of (zero count, literal count) bytes, each followed by the literal bytes
+static size_t encodeDelta(const uint8_t *state, const uint8_t *baseline, size_t size, uint8_t *out)
+{
+	uint8_t *start = out;
+	size_t i = 0;
+	while (i < size)
+	{
+		uint8_t zeros = 0;
+		while (i < size && zeros < 255 && (state[i] ^ baseline[i]) == 0)
+		{
+			zeros++;
+			i++;
+		}
+		uint8_t *literalCount = out + 1;
+		*out = zeros;
+		out += 2;
+		*literalCount = 0;
+		while (i < size && *literalCount < 255 && (state[i] ^ baseline[i]) != 0)
+		{
+			*out++ = state[i] ^ baseline[i];
+			(*literalCount)++;
+			i++;
+		}
+	}
+	return size_t(out - start);
+}
+
+static bool decodeDelta(const uint8_t *in, size_t inSize, const uint8_t *baseline, size_t size, uint8_t *state)
+{
+	const uint8_t *end = in + inSize;
+	size_t i = 0;
+	while (in + 2 <= end)
+	{
+		size_t zeros = *in++;
+		size_t literals = *in++;
+		if (i + zeros + literals > size || in + literals > end)
+			return false;
+		for (size_t z = 0; z < zeros; z++, i++)
+			state[i] = baseline[i];
+		for (size_t l = 0; l < literals; l++, i++)
+			state[i] = baseline[i] ^ *in++;
+	}
+	return i == size && in == end;
+}
+// end::deltaCompression[]
+
+// ============================= RollbackSession =============================
+
+RollbackSession::RollbackSession(UdpSocket &socket, PlayerSide localSide, double tickLength)
+	: socket(socket), local(localSide), remote(localSide == RED_PLAYER ? BLUE_PLAYER : RED_PLAYER), tickLength(tickLength),
+	peerConnected(false), sameSideReported(false), currentTick(0), current(newGame()), remoteConfirmed(0), localAcknowledged(0),
+	rollbackFrom(noTick), lastSendMs(-1.0e9), peerTimestamp(0), peerTimestampReceivedMs(0.0),
+	havePeerTimestamp(false), lastSnapshotTick(0), snapshotsSent(0), snapshotAcknowledged(noTick), snapshotsReceived(0), newestSnapshotReceived(noTick)
+{
+	for (uint32_t i = 0; i < historyTicks; i++)
+	{
+		states[i] = current;
+		inputs[i][RED_PLAYER].move = 0;
+		inputs[i][BLUE_PLAYER].move = 0;
+		remoteInputTick[i] = noTick;
+	}
+	for (uint32_t i = 0; i < snapshotRecords; i++)
+	{
+		sentSnapshots[i].tick = noTick;
+		receivedSnapshots[i].tick = noTick;
+	}
+}
+
+void RollbackSession::step(GameState &state, const PlayerInput tickInputs[2]) const
+{
+	applyPlayerInputs(state, tickInputs);
+	updateSimulation(state, tickLength);
+}
+
+const GameState &RollbackSession::stateAt(uint32_t tick) const
+{
+	return (tick == currentTick) ? current : states[tick % historyTicks];
+}
+
+bool RollbackSession::canAdvance() const
+{
+	return peerConnected && currentTick < remoteConfirmed + maxPredictionTicks; // the remote can be ahead of us, too
+}
+
+uint32_t RollbackSession::confirmedTick() const
+{
+	return std::min(remoteConfirmed, currentTick);
+}
+
+bool RollbackSession::confirmedState(uint32_t tick, uint8_t serialised[stateBytes]) const
+{
+	if (tick > confirmedTick() || currentTick - tick >= historyTicks)
+		return false;
+	serialiseState(stateAt(tick), serialised);
+	return true;
+}
+
+NetStats RollbackSession::stats() const
+{
+	NetStats stats = counters;
+	stats.bytesSent = socket.bytesSent();
+	stats.bytesReceived = socket.bytesReceived();
+	stats.packetsDropped = socket.packetsDropped();
+	return stats;
+}
+
+// tag::advance[]
+void RollbackSession::advance(PlayerInput localInput, double nowMs)
+{
+	uint32_t slot = currentTick % historyTicks;
+	states[slot] = current;
+	inputs[slot][local] = localInput;
+	if (remoteInputTick[slot] != currentTick)
+	{
+		//predict - the remote player is probably still doing what they did last
+		if (remoteConfirmed > 0)
+			inputs[slot][remote] = inputs[(remoteConfirmed - 1) % historyTicks][remote];
+		else
+			inputs[slot][remote].move = 0;
+	}
+
+	step(current, inputs[slot]);
+	currentTick++;
+
+	sendInputs(nowMs);
+	if (local == RED_PLAYER && confirmedTick() >= lastSnapshotTick + snapshotIntervalTicks)
+		sendSnapshot(nowMs);
+}
+// end::advance[]
+
+// tag::rollBack[]
+//resimulate from `tick` to now, with the real inputs we have, and fresh predictions for the rest
+void RollbackSession::rollBackTo(uint32_t tick)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	GameState state = states[tick % historyTicks];
+	PlayerInput predicted = inputs[tick % historyTicks][remote];
+	for (uint32_t t = tick; t < currentTick; t++)
+	{
+		uint32_t slot = t % historyTicks;
+		if (remoteInputTick[slot] == t)
+			predicted = inputs[slot][remote];
+		else
+			inputs[slot][remote] = predicted;
+		states[slot] = state;
+		step(state, inputs[slot]);
+	}
+	current = state;
+
+	uint64_t ticks = currentTick - tick;
+	counters.rollbacks++;
+	counters.resimulatedTicks += ticks;
+	counters.worstRollbackTicks = std::max(counters.worstRollbackTicks, ticks);
+	counters.resimulationSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+// end::rollBack[]
+
+void RollbackSession::poll(double nowMs)
+{
+	socket.update(nowMs);
+
+	uint8_t packet[UdpSocket::maxPacketSize];
+	int size;
+	while ((size = socket.receive(packet, sizeof(packet))) > 0)
+	{
+		if (size < 2)
+			continue;
+		if (packet[1] == uint8_t(local))
+		{
+			if (!sameSideReported)
+				cerr << "Network peer is playing the same side - one player must be red, the other blue" << endl;
+			sameSideReported = true;
+			continue;
+		}
+		if (!peerConnected)
+			cout << "\nNetwork peer connected" << endl;
+		peerConnected = true;
+
+		switch (packet[0])
+		{
+		case PACKET_INPUTS:
+			receiveInputs(packet, size_t(size), nowMs);
+			break;
+		case PACKET_SNAPSHOT:
+			receiveSnapshot(packet, size_t(size));
+			break;
+		}
+	}
+
+	if (rollbackFrom != noTick)
+	{
+		if (rollbackFrom < currentTick)
+			rollBackTo(rollbackFrom);
+		rollbackFrom = noTick;
+	}
+
+	//keep talking even when we aren't advancing, so the peer gets its acknowledgements
+	if (nowMs - lastSendMs >= tickLength * 1000.0)
+	{
+		if (!peerConnected)
+			sendHello(nowMs);
+		else
+		{
+			if (!canAdvance())
+				counters.stalls++;
+			sendInputs(nowMs);
+		}
+	}
+}
+
+void RollbackSession::sendHello(double nowMs)
+{
+	uint8_t packet[2] = { PACKET_HELLO, uint8_t(local) };
+	socket.send(packet, sizeof(packet), nowMs);
+	lastSendMs = nowMs;
+}
+
+// tag::sendInputs[]
+//  type, side, first tick, count, count inputs, remote inputs we have up to, newest snapshot we have,
+//  our timestamp, and the peer's last timestamp (plus how long we held it) so it can measure the round trip
+void RollbackSession::sendInputs(double nowMs)
+{
+	const uint32_t maxInputs = 64; // enough to cover everything the peer can be missing - see canAdvance
+	uint32_t first = std::max(localAcknowledged, currentTick > maxInputs ? currentTick - maxInputs : 0);
+	uint32_t count = currentTick - first;
+
+	uint8_t packet[UdpSocket::maxPacketSize];
+	uint8_t *out = packet;
+	*out++ = PACKET_INPUTS;
+	*out++ = uint8_t(local);
+	writeU32(out, first);
+	*out++ = uint8_t(count);
+	for (uint32_t t = first; t < currentTick; t++)
+		*out++ = uint8_t(inputs[t % historyTicks][local].move);
+	writeU32(out, remoteConfirmed);
+	writeU32(out, newestSnapshotReceived);
+	writeU32(out, uint32_t(nowMs));
+	writeU32(out, havePeerTimestamp ? peerTimestamp + uint32_t(nowMs - peerTimestampReceivedMs) : noTick);
+
+	socket.send(packet, size_t(out - packet), nowMs);
+	lastSendMs = nowMs;
+}
+// end::sendInputs[]
+
+// tag::receiveInputs[]
+void RollbackSession::receiveInputs(const uint8_t *packet, size_t size, double nowMs)
+{
+	const uint8_t *in = packet + 2;
+	if (size < 2 + 4 + 1)
+		return;
+	uint32_t first = readU32(in);
+	uint32_t count = *in++;
+	if (size != 2 + 4 + 1 + count + 4 * 4)
+		return;
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint32_t t = first + i;
+		PlayerInput input;
+		input.move = int8_t(*in++);
+		if (t < remoteConfirmed || t + historyTicks <= currentTick || t >= currentTick + historyTicks - maxPredictionTicks)
+			continue; // already have it, too old to matter, or too far ahead to store
+		uint32_t slot = t % historyTicks;
+		if (remoteInputTick[slot] == t)
+			continue;
+
+		//a misprediction for a tick we've already simulated - that tick (and everything after) has to be redone
+		if (t < currentTick && inputs[slot][remote].move != input.move)
+			rollbackFrom = std::min(rollbackFrom, t);
+		inputs[slot][remote] = input;
+		remoteInputTick[slot] = t;
+	}
+	while (remoteInputTick[remoteConfirmed % historyTicks] == remoteConfirmed)
+		remoteConfirmed++;
+
+	localAcknowledged = std::max(localAcknowledged, readU32(in));
+	uint32_t snapshotAck = readU32(in);
+	if (snapshotAck != noTick && (snapshotAcknowledged == noTick || snapshotAck > snapshotAcknowledged))
+		snapshotAcknowledged = snapshotAck;
+
+	uint32_t timestamp = readU32(in);
+	uint32_t echo = readU32(in);
+	peerTimestamp = timestamp;
+	peerTimestampReceivedMs = nowMs;
+	havePeerTimestamp = true;
+	if (echo != noTick)
+		counters.roundTripMs = nowMs - double(echo);
+}
+// end::receiveInputs[]
+
+// tag::sendSnapshot[]
+//  type, side, tick, baseline tick (or noTick), delta against that baseline
+void RollbackSession::sendSnapshot(double nowMs)
+{
+	uint32_t tick = confirmedTick();
+	SnapshotRecord &record = sentSnapshots[snapshotsSent++ % snapshotRecords];
+	record.tick = tick;
+	serialiseState(stateAt(tick), record.bytes);
+	lastSnapshotTick = tick;
+
+	//delta against the newest snapshot blue told us it has - or against zeros, if we don't have it any more
+	static const uint8_t zeros[stateBytes] = {};
+	const uint8_t *baseline = zeros;
+	uint32_t baselineTick = noTick;
+	for (uint32_t i = 0; i < snapshotRecords; i++)
+		if (snapshotAcknowledged != noTick && sentSnapshots[i].tick == snapshotAcknowledged && sentSnapshots[i].tick != tick)
+		{
+			baseline = sentSnapshots[i].bytes;
+			baselineTick = snapshotAcknowledged;
+		}
+
+	uint8_t packet[UdpSocket::maxPacketSize];
+	uint8_t *out = packet;
+	*out++ = PACKET_SNAPSHOT;
+	*out++ = uint8_t(local);
+	writeU32(out, tick);
+	writeU32(out, baselineTick);
+	out += encodeDelta(record.bytes, baseline, stateBytes, out);
+	socket.send(packet, size_t(out - packet), nowMs);
+}
+// end::sendSnapshot[]
+
+// tag::receiveSnapshot[]
+void RollbackSession::receiveSnapshot(const uint8_t *packet, size_t size)
+{
+	if (local != BLUE_PLAYER || size < 2 + 8)
+		return;
+	const uint8_t *in = packet + 2;
+	uint32_t tick = readU32(in);
+	uint32_t baselineTick = readU32(in);
+
+	static const uint8_t zeros[stateBytes] = {};
+	const uint8_t *baseline = (baselineTick == noTick) ? zeros : nullptr;
+	for (uint32_t i = 0; i < snapshotRecords && baseline == nullptr; i++)
+		if (receivedSnapshots[i].tick == baselineTick)
+			baseline = receivedSnapshots[i].bytes;
+	if (baseline == nullptr)
+		return; // we no longer have the baseline - the next snapshot will use a newer one
+
+	uint8_t bytes[stateBytes];
+	if (!decodeDelta(in, size - 10, baseline, stateBytes, bytes))
+		return;
+	SnapshotRecord &record = receivedSnapshots[snapshotsReceived++ % snapshotRecords];
+	record.tick = tick;
+	std::memcpy(record.bytes, bytes, stateBytes);
+	if (newestSnapshotReceived == noTick || tick > newestSnapshotReceived)
+		newestSnapshotReceived = tick;
+
+	//compare with our own state at that tick, if we still have it
+	if (tick > currentTick || currentTick - tick >= historyTicks)
+		return;
+	uint8_t ours[stateBytes];
+	serialiseState(stateAt(tick), ours);
+	if (std::memcmp(ours, bytes, stateBytes) == 0)
+		return;
+
+	//the host's state wins - if ours was built from real inputs only, we had drifted
+	if (tick <= remoteConfirmed)
+		counters.resyncs++;
+	if (tick == currentTick)
+		deserialiseState(bytes, current);
+	else
+	{
+		deserialiseState(bytes, states[tick % historyTicks]);
+		rollbackFrom = std::min(rollbackFrom, tick);
+	}
+}
+// end::receiveSnapshot[]
+
+// ============================= stats and testing =============================
+
+void printNetStats(const char *label, const NetStats &latest, const NetStats &previous, double seconds)
+{
+	if (seconds <= 0.0)
+		return;
+	cout << std::fixed << std::setprecision(0)
+		<< label << ": " << (latest.bytesSent - previous.bytesSent) / seconds << " B/s up, "
+		<< (latest.bytesReceived - previous.bytesReceived) / seconds << " B/s down, rtt " << latest.roundTripMs << " ms, "
+		<< (latest.rollbacks - previous.rollbacks) << " rollbacks (" << (latest.resimulatedTicks - previous.resimulatedTicks) << " ticks, "
+		<< std::setprecision(3) << (latest.resimulationSeconds - previous.resimulationSeconds) * 1000.0 << " ms), worst "
+		<< latest.worstRollbackTicks << " ticks in one frame, " << latest.resyncs << " resyncs, "
+		<< (latest.stalls - previous.stalls) << " stalls" << endl;
+}
+
+// tag::runLoopbackTest[]
+bool runLoopbackTest(const NetworkConditions &conditions, uint32_t ticks)
+{
+	const uint16_t redPort = 27910;
+	const uint16_t bluePort = 27911;
+	const double tickLength = 0.02;
+
+	//sockets hold their delayed packets, so they are large - keep them off the stack
+	UdpSocket *redSocket = new UdpSocket();
+	UdpSocket *blueSocket = new UdpSocket();
+	bool opened = redSocket->open(redPort) && blueSocket->open(bluePort)
+		&& redSocket->setPeer("127.0.0.1", bluePort) && blueSocket->setPeer("127.0.0.1", redPort);
+	if (!opened)
+	{
+		delete redSocket;
+		delete blueSocket;
+		return false;
+	}
+	NetworkConditions blueConditions = conditions;
+	blueConditions.seed = conditions.seed * 7919u + 1u; // different losses in each direction
+	redSocket->setConditions(conditions);
+	blueSocket->setConditions(blueConditions);
+
+	RollbackSession *red = new RollbackSession(*redSocket, RED_PLAYER, tickLength);
+	RollbackSession *blue = new RollbackSession(*blueSocket, BLUE_PLAYER, tickLength);
+	RollbackSession *sessions[2] = { red, blue }; // indexed by PlayerSide
+
+	//scripted players - each changes direction now and then
+	uint32_t randomState[2] = { 12345u, 67890u };
+	PlayerInput held[2] = { { 0 }, { 0 } };
+
+	//simulated time advances a quarter of a tick per step, so packets arrive between ticks
+	double nowMs = 0.0;
+	const double stepMs = tickLength * 1000.0 / 4.0;
+	const uint64_t maxSteps = uint64_t(ticks) * 40 + 4000;
+	uint64_t steps = 0;
+	while (std::min(red->confirmedTick(), blue->confirmedTick()) < ticks && steps < maxSteps)
+	{
+		for (int side = 0; side < 2; side++)
+		{
+			RollbackSession &session = *sessions[side];
+			session.poll(nowMs);
+			if (session.canAdvance() && session.tick() < ticks + RollbackSession::maxPredictionTicks && session.tick() * tickLength * 1000.0 <= nowMs)
+			{
+				randomState[side] = randomState[side] * 1664525u + 1013904223u;
+				if ((randomState[side] >> 24) < 20) // about one tick in thirteen
+					held[side].move = int8_t(int((randomState[side] >> 8) % 3) - 1);
+				session.advance(held[side], nowMs);
+			}
+		}
+		nowMs += stepMs;
+		steps++;
+	}
+
+	uint8_t redState[RollbackSession::stateBytes];
+	uint8_t blueState[RollbackSession::stateBytes];
+	bool reached = red->confirmedState(ticks, redState) && blue->confirmedState(ticks, blueState);
+	bool agreed = reached && std::memcmp(redState, blueState, sizeof(redState)) == 0;
+
+	double seconds = nowMs / 1000.0;
+	cout << "Loopback test: " << ticks << " ticks, latency " << conditions.latencyMs << " ms (+" << conditions.jitterMs
+		<< " ms jitter), " << conditions.lossRate * 100.0 << "% loss, " << seconds << " simulated seconds" << endl;
+	printNetStats("  red", red->stats(), NetStats(), seconds);
+	printNetStats("  blue", blue->stats(), NetStats(), seconds);
+	if (!reached)
+		cout << "Loopback test FAILED - the sessions did not confirm tick " << ticks << endl;
+	else
+		cout << (agreed ? "Loopback test PASSED - both sides agree on the game state" : "Loopback test FAILED - the game states differ") << endl;
+
+	delete red;
+	delete blue;
+	delete redSocket;
+	delete blueSocket;
+	return agreed;
+}
+// end::runLoopbackTest[]
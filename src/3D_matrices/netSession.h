@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "game.h"
+#include "udpSocket.h"
+
+// tag::playerInput[]
+enum PlayerSide
+{
+	RED_PLAYER = 0,
+	BLUE_PLAYER = 1
+};
+
+//what one player does in one tick - this is all that has to cross the network each tick
+struct PlayerInput
+{
+	int8_t move; // -1 left, 0 still, +1 right
+};
+
+void applyPlayerInputs(GameState &state, const PlayerInput inputs[2]); // sets both bat velocities
+// end::playerInput[]
+
+// tag::netStats[]
+struct NetStats
+{
+	NetStats() : bytesSent(0), bytesReceived(0), packetsDropped(0), rollbacks(0), resimulatedTicks(0),
+		resimulationSeconds(0.0), worstRollbackTicks(0), resyncs(0), stalls(0), roundTripMs(0.0) {}
+
+	uint64_t bytesSent; // including IP and UDP headers
+	uint64_t bytesReceived;
+	uint64_t packetsDropped; // by the artificial packet loss
+	uint64_t rollbacks; // times a misprediction (or resync) sent us back in time
+	uint64_t resimulatedTicks;
+	double resimulationSeconds;
+	uint64_t worstRollbackTicks; // the most ticks resimulated in one go - i.e. in one frame
+	uint64_t resyncs; // confirmed state that differed from the host's snapshot
+	uint64_t stalls; // ticks held back because we were too far ahead of the remote input
+	double roundTripMs;
+};
+
+void printNetStats(const char *label, const NetStats &latest, const NetStats &previous, double seconds); // rates over the last `seconds`
+// end::netStats[]
+
+// tag::rollbackSession[]
+//Two-player netcode: each machine simulates both bats, and only inputs cross the network.
+//
+//  - every tick, the local input is sent (with the last few, in case packets were lost), and the
+//    remote input is predicted to be the same as the last one we received
+//  - the state at the start of each tick is kept for `historyTicks` ticks; when a remote input
+//    arrives that differs from the prediction we used, we roll back to that tick and resimulate
+//  - if the remote input falls `maxPredictionTicks` behind, canAdvance() holds us back
+//  - the red player (the host) periodically sends a state snapshot for a tick where both inputs are
+//    known, delta-compressed against the last snapshot blue acknowledged; if blue's state differs
+//    (e.g. floating point differences between machines), blue adopts it and resimulates
+class RollbackSession
+{
+public:
+	static const uint32_t historyTicks = 128;
+	static const uint32_t maxPredictionTicks = 30;
+	static const uint32_t snapshotIntervalTicks = 25;
+	static const size_t stateBytes = 85; // a GameState, serialised
+
+	RollbackSession(UdpSocket &socket, PlayerSide localSide, double tickLength);
+
+	void poll(double nowMs); // send anything due, read packets, roll back if needed
+	bool connected() const { return peerConnected; }
+	bool canAdvance() const;
+	void advance(PlayerInput localInput, double nowMs); // simulate one tick
+
+	const GameState &state() const { return current; }
+	uint32_t tick() const { return currentTick; }
+	uint32_t confirmedTick() const; // the state at the start of this tick used only real inputs
+	bool confirmedState(uint32_t tick, uint8_t serialised[stateBytes]) const;
+	NetStats stats() const;
+
+private:
+	RollbackSession(const RollbackSession &);
+	RollbackSession &operator=(const RollbackSession &);
+
+	void step(GameState &state, const PlayerInput inputs[2]) const;
+	void rollBackTo(uint32_t tick);
+	const GameState &stateAt(uint32_t tick) const;
+
+	void sendHello(double nowMs);
+	void sendInputs(double nowMs);
+	void sendSnapshot(double nowMs);
+	void receiveInputs(const uint8_t *packet, size_t size, double nowMs);
+	void receiveSnapshot(const uint8_t *packet, size_t size);
+
+	struct SnapshotRecord
+	{
+		uint32_t tick;
+		uint8_t bytes[stateBytes];
+	};
+	static const uint32_t snapshotRecords = 8;
+	static const uint32_t noTick = 0xFFFFFFFFu;
+
+	UdpSocket &socket;
+	PlayerSide local;
+	PlayerSide remote;
+	double tickLength;
+	bool peerConnected;
+	bool sameSideReported;
+
+	uint32_t currentTick;
+	GameState current;
+	GameState states[historyTicks]; // state at the start of each tick
+	PlayerInput inputs[historyTicks][2]; // the inputs each tick was simulated with
+	uint32_t remoteInputTick[historyTicks]; // which tick's real remote input is in each slot, or noTick
+	uint32_t remoteConfirmed; // every remote input before this tick has arrived
+	uint32_t localAcknowledged; // the remote has every local input before this tick
+	uint32_t rollbackFrom; // earliest tick to resimulate from, or noTick
+
+	double lastSendMs;
+	uint32_t peerTimestamp; // from the last packet received, echoed back to measure the round trip
+	double peerTimestampReceivedMs;
+	bool havePeerTimestamp;
+
+	SnapshotRecord sentSnapshots[snapshotRecords]; // host - possible baselines
+	uint32_t lastSnapshotTick;
+	uint32_t snapshotsSent;
+	uint32_t snapshotAcknowledged; // host - newest snapshot blue has, or noTick
+	SnapshotRecord receivedSnapshots[snapshotRecords]; // blue - baselines to decode against
+	uint32_t snapshotsReceived;
+	uint32_t newestSnapshotReceived;
+
+	NetStats counters;
+};
+// end::rollbackSession[]
+
+// tag::loopbackTest[]
+//Plays both sides of a networked match in this process, over UDP on 127.0.0.1, with scripted
+//input and the given network conditions, in simulated time (so it runs much faster than real time).
+//Returns true if both sides agree on the confirmed game state at the end.
+bool runLoopbackTest(const NetworkConditions &conditions, uint32_t ticks);
+// end::loopbackTest[]
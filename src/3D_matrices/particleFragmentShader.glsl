@@ -0,0 +1,13 @@
+#version 330
+in vec4 fragmentColor;
+out vec4 outputColor;
+
+void main()
+{
+	// round points, soft at the edges
+	vec2 fromCenter = gl_PointCoord * 2.0 - 1.0;
+	float falloff = 1.0 - dot(fromCenter, fromCenter);
+	if (falloff <= 0.0)
+		discard;
+	outputColor = vec4(fragmentColor.rgb, fragmentColor.a * falloff);
+}
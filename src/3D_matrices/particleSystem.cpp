@@ -0,0 +1,201 @@
+#include "particleSystem.h"
+
+#include <iostream>
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include "renderer.h"
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+const float ParticleSystem::maxLifetime = 2.0f;
+
+ParticleSystem::ParticleSystem() : emitterCount(0), nextSlot(0), emitted(0), sinceEmitted(maxLifetime), frame(0), current(0),
+	emitterCountLocation(-1), emitterPositionLocation(-1), emitterNormalLocation(-1), emitterSlotsLocation(-1),
+	particleCountLocation(-1), deltaTimeLocation(-1), frameSeedLocation(-1), viewMatrixLocation(-1), projectionMatrixLocation(-1), pointScaleLocation(-1)
+{
+}
+
+// tag::loadParticles[]
+bool ParticleSystem::load(const char *updateShaderPath, const char *vertexShaderPath, const char *fragmentShaderPath)
+{
+	//the update program is a vertex shader on its own - its outputs go to the transform feedback buffer
+	std::vector<GpuShader> updateShaders;
+	updateShaders.push_back(createShader(GL_VERTEX_SHADER, loadShader(updateShaderPath)));
+	std::vector<const char *> varyings;
+	varyings.push_back("outPosition");
+	varyings.push_back("outVelocity");
+	varyings.push_back("outLife");
+	updateProgram = createProgram(updateShaders, varyings, "particle update program");
+
+	std::vector<GpuShader> drawShaders;
+	drawShaders.push_back(createShader(GL_VERTEX_SHADER, loadShader(vertexShaderPath)));
+	drawShaders.push_back(createShader(GL_FRAGMENT_SHADER, loadShader(fragmentShaderPath)));
+	drawProgram = createProgram(drawShaders, std::vector<const char *>(), "particle draw program");
+
+	if (updateProgram.get() == 0 || drawProgram.get() == 0)
+	{
+		cerr << "Particle GLSL program creation error." << endl;
+		return false;
+	}
+
+	emitterCountLocation = glGetUniformLocation(updateProgram.get(), "emitterCount");
+	emitterPositionLocation = glGetUniformLocation(updateProgram.get(), "emitterPosition");
+	emitterNormalLocation = glGetUniformLocation(updateProgram.get(), "emitterNormal");
+	emitterSlotsLocation = glGetUniformLocation(updateProgram.get(), "emitterSlots");
+	particleCountLocation = glGetUniformLocation(updateProgram.get(), "particleCount");
+	deltaTimeLocation = glGetUniformLocation(updateProgram.get(), "deltaTime");
+	frameSeedLocation = glGetUniformLocation(updateProgram.get(), "frameSeed");
+	viewMatrixLocation = glGetUniformLocation(drawProgram.get(), "viewMatrix");
+	projectionMatrixLocation = glGetUniformLocation(drawProgram.get(), "projectionMatrix");
+	pointScaleLocation = glGetUniformLocation(drawProgram.get(), "pointScale");
+
+	GLint updateLocations[3] = { glGetAttribLocation(updateProgram.get(), "position"), glGetAttribLocation(updateProgram.get(), "velocity"), glGetAttribLocation(updateProgram.get(), "life") };
+	GLint drawLocations[2] = { glGetAttribLocation(drawProgram.get(), "position"), glGetAttribLocation(drawProgram.get(), "life") };
+
+	//every particle starts dead - zero life left
+	std::vector<Particle> initial(maxParticles);
+	std::fill(reinterpret_cast<GLfloat *>(initial.data()), reinterpret_cast<GLfloat *>(initial.data() + initial.size()), 0.0f);
+
+	for (int i = 0; i < 2; i++)
+	{
+		particleBuffers[i] = GpuBuffer::create("particles");
+		updateVertexArrays[i] = GpuVertexArray::create("particle update");
+		drawVertexArrays[i] = GpuVertexArray::create("particle draw");
+		glBindBuffer(GL_ARRAY_BUFFER, particleBuffers[i].get());
+		particleBuffers[i].upload(GL_ARRAY_BUFFER, maxParticles * sizeof(Particle), initial.data(), GL_DYNAMIC_COPY); // written and read by the GPU only
+
+		glBindVertexArray(updateVertexArrays[i].get());
+			glEnableVertexAttribArray(updateLocations[0]);
+			glEnableVertexAttribArray(updateLocations[1]);
+			glEnableVertexAttribArray(updateLocations[2]);
+			glVertexAttribPointer(updateLocations[0], 3, GL_FLOAT, GL_FALSE, sizeof(Particle), (GLvoid *)offsetof(Particle, position));
+			glVertexAttribPointer(updateLocations[1], 3, GL_FLOAT, GL_FALSE, sizeof(Particle), (GLvoid *)offsetof(Particle, velocity));
+			glVertexAttribPointer(updateLocations[2], 2, GL_FLOAT, GL_FALSE, sizeof(Particle), (GLvoid *)offsetof(Particle, life));
+
+		glBindVertexArray(drawVertexArrays[i].get());
+			glEnableVertexAttribArray(drawLocations[0]);
+			glEnableVertexAttribArray(drawLocations[1]);
+			glVertexAttribPointer(drawLocations[0], 3, GL_FLOAT, GL_FALSE, sizeof(Particle), (GLvoid *)offsetof(Particle, position));
+			glVertexAttribPointer(drawLocations[1], 2, GL_FLOAT, GL_FALSE, sizeof(Particle), (GLvoid *)offsetof(Particle, life));
+	}
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	cout << "Particle system created OK! " << maxParticles << " particles, " << 2 * maxParticles * sizeof(Particle) / 1024 << " KB of buffers" << endl;
+	return true;
+}
+// end::loadParticles[]
+
+void ParticleSystem::unload()
+{
+	for (int i = 0; i < 2; i++)
+	{
+		updateVertexArrays[i].reset();
+		drawVertexArrays[i].reset();
+		particleBuffers[i].reset();
+	}
+	updateProgram.reset();
+	drawProgram.reset();
+}
+
+// tag::emitParticles[]
+//only claims a run of slots in the ring - the oldest particles are the ones replaced
+void ParticleSystem::emit(const glm::vec3 &position, const glm::vec3 &normal, int count)
+{
+	if (emitterCount == maxEmittersPerFrame || count <= 0)
+		return;
+	count = std::min(count, int(maxParticles));
+
+	Emitter &emitter = emitters[emitterCount++];
+	emitter.position = position;
+	emitter.normal = normal;
+	emitter.firstSlot = nextSlot;
+	emitter.count = count;
+	nextSlot = (nextSlot + count) % maxParticles;
+	emitted += count;
+}
+// end::emitParticles[]
+
+// tag::updateParticles[]
+void ParticleSystem::update(float deltaTime)
+{
+	if (updateProgram.get() == 0)
+		return;
+
+	glUseProgram(updateProgram.get());
+	GLfloat positions[maxEmittersPerFrame * 3];
+	GLfloat normals[maxEmittersPerFrame * 3];
+	GLint slots[maxEmittersPerFrame * 2];
+	for (int e = 0; e < emitterCount; e++)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			positions[e * 3 + i] = emitters[e].position[i];
+			normals[e * 3 + i] = emitters[e].normal[i];
+		}
+		slots[e * 2] = emitters[e].firstSlot;
+		slots[e * 2 + 1] = emitters[e].count;
+	}
+	glUniform1i(emitterCountLocation, emitterCount);
+	if (emitterCount > 0)
+	{
+		glUniform3fv(emitterPositionLocation, emitterCount, positions);
+		glUniform3fv(emitterNormalLocation, emitterCount, normals);
+		glUniform2iv(emitterSlotsLocation, emitterCount, slots);
+	}
+	glUniform1i(particleCountLocation, maxParticles);
+	glUniform1f(deltaTimeLocation, deltaTime);
+	glUniform1ui(frameSeedLocation, ++frame * 2654435761u);
+
+	//read from the current buffer, write into the other one - nothing is rasterised
+	int next = 1 - current;
+	glEnable(GL_RASTERIZER_DISCARD);
+	glBindVertexArray(updateVertexArrays[current].get());
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, particleBuffers[next].get());
+	glBeginTransformFeedback(GL_POINTS);
+	glDrawArrays(GL_POINTS, 0, maxParticles);
+	glEndTransformFeedback();
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+	glBindVertexArray(0);
+	glDisable(GL_RASTERIZER_DISCARD);
+	glUseProgram(0);
+
+	current = next;
+	sinceEmitted = (emitterCount > 0) ? 0.0f : sinceEmitted + deltaTime;
+	emitterCount = 0;
+}
+// end::updateParticles[]
+
+// tag::drawParticles[]
+void ParticleSystem::draw(const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix, float pointScale)
+{
+	if (drawProgram.get() == 0)
+		return;
+
+	glUseProgram(drawProgram.get());
+	glUniformMatrix4fv(viewMatrixLocation, 1, false, glm::value_ptr(viewMatrix));
+	glUniformMatrix4fv(projectionMatrixLocation, 1, false, glm::value_ptr(projectionMatrix));
+	glUniform1f(pointScaleLocation, pointScale);
+
+	//additive, and tested against the scene's depth without writing to it, so the order of the particles doesn't matter
+	glEnable(GL_PROGRAM_POINT_SIZE);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+	glDepthMask(GL_FALSE);
+
+	glBindVertexArray(drawVertexArrays[current].get());
+	glDrawArrays(GL_POINTS, 0, maxParticles);
+	glBindVertexArray(0);
+
+	glDepthMask(GL_TRUE);
+	glDisable(GL_BLEND);
+	glDisable(GL_PROGRAM_POINT_SIZE);
+	glUseProgram(0);
+}
+// end::drawParticles[]
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+
+#include <GL/glew.h>
+
+#define GLM_FORCE_RADIANS // suppress a warning in GLM 0.9.5
+#include <glm/glm.hpp>
+
+#include "gpuResources.h"
+
+// tag::particleSystem[]
+//Sparks for the ball's impacts, simulated entirely on the GPU.
+//
+//  - the particles live in a pair of vertex buffers; each frame a vertex shader reads every particle
+//    from one buffer and transform feedback writes the moved particles into the other, with
+//    rasterisation turned off - then the two swap ("ping-pong")
+//  - the pool is a ring of slots: emit() only records where and how many, and the update shader
+//    respawns the slots in that run of the ring - the CPU never touches a single particle
+//  - the buffer that was just written is then drawn as points, blended additively
+class ParticleSystem
+{
+public:
+	static const int maxParticles = 131072;
+	static const int maxEmittersPerFrame = 8; // must match maxEmitters in particleUpdateShader.glsl
+	static const float maxLifetime; // seconds - the longest a spark can live in particleUpdateShader.glsl
+
+	ParticleSystem();
+
+	bool load(const char *updateShaderPath, const char *vertexShaderPath, const char *fragmentShaderPath); // GL thread only
+	void unload();
+
+	void emit(const glm::vec3 &position, const glm::vec3 &normal, int count); // spawned in the next update()
+	void update(float deltaTime); // one transform feedback pass over the whole pool
+	void draw(const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix, float pointScale);
+
+	uint64_t emittedCount() const { return emitted; }
+	bool settled() const { return updateProgram.get() == 0 || (emitterCount == 0 && sinceEmitted >= maxLifetime); } // every spark has died - nothing left to move or draw
+
+private:
+	ParticleSystem(const ParticleSystem &);
+	ParticleSystem &operator=(const ParticleSystem &);
+
+	struct Particle
+	{
+		GLfloat position[3];
+		GLfloat velocity[3];
+		GLfloat life[2]; // seconds left, and the lifetime it started with
+	};
+
+	struct Emitter
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+		GLint firstSlot;
+		GLint count;
+	};
+
+	Emitter emitters[maxEmittersPerFrame];
+	int emitterCount;
+	int nextSlot; // where the next emission starts in the ring
+	uint64_t emitted;
+	float sinceEmitted; // seconds of updates since sparks were last spawned
+	uint32_t frame;
+	int current; // which buffer holds the latest particles
+
+	GpuProgram updateProgram;
+	GpuProgram drawProgram;
+	GpuBuffer particleBuffers[2];
+	GpuVertexArray updateVertexArrays[2]; // read buffer i in the update pass
+	GpuVertexArray drawVertexArrays[2]; // read buffer i when drawing
+
+	GLint emitterCountLocation, emitterPositionLocation, emitterNormalLocation, emitterSlotsLocation;
+	GLint particleCountLocation, deltaTimeLocation, frameSeedLocation;
+	GLint viewMatrixLocation, projectionMatrixLocation, pointScaleLocation;
+};
+// end::particleSystem[]
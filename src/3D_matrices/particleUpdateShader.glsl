@@ -0,0 +1,76 @@
+#version 330
+// Moves every particle on by one frame. There is no fragment shader - the outputs are captured
+// with transform feedback into the other buffer of the pair, and nothing is rasterised.
+in vec3 position;
+in vec3 velocity;
+in vec2 life; // seconds left, and the lifetime it started with
+out vec3 outPosition;
+out vec3 outVelocity;
+out vec2 outLife;
+
+const int maxEmitters = 8;
+uniform int emitterCount;
+uniform vec3 emitterPosition[maxEmitters];
+uniform vec3 emitterNormal[maxEmitters];
+uniform ivec2 emitterSlots[maxEmitters]; // first slot and count - the run can wrap round the end of the pool
+uniform int particleCount;
+uniform float deltaTime;
+uniform uint frameSeed;
+
+const vec3 gravity = vec3(0.0, -3.0, 0.0);
+const float floorHeight = -0.25;
+
+// integer hash (from Hugo Elias / Jarzynski & Olano) - a different random number for every particle and frame
+uint hash(uint x)
+{
+	x = (x ^ 61u) ^ (x >> 16u);
+	x *= 9u;
+	x = x ^ (x >> 4u);
+	x *= 0x27d4eb2du;
+	return x ^ (x >> 15u);
+}
+
+float random(inout uint state)
+{
+	state = hash(state);
+	return float(state & 0xffffffu) / 16777216.0;
+}
+
+void main()
+{
+	// is this slot being (re)spawned this frame?
+	for (int e = 0; e < emitterCount; e++)
+	{
+		int offset = (gl_VertexID - emitterSlots[e].x + particleCount) % particleCount;
+		if (offset < emitterSlots[e].y)
+		{
+			uint state = hash(uint(gl_VertexID) ^ frameSeed);
+			vec3 spread = vec3(random(state), random(state), random(state)) * 2.0 - 1.0;
+			vec3 direction = normalize(emitterNormal[e] + vec3(0.0, 0.6, 0.0) + spread * 0.9);
+			float lifetime = 0.6 + 1.4 * random(state);
+			outPosition = emitterPosition[e];
+			outVelocity = direction * (1.0 + 3.0 * random(state));
+			outLife = vec2(lifetime, lifetime);
+			return;
+		}
+	}
+
+	if (life.x <= 0.0)
+	{
+		outPosition = position;
+		outVelocity = velocity;
+		outLife = vec2(0.0, life.y);
+		return;
+	}
+
+	vec3 newVelocity = (velocity + gravity * deltaTime) * (1.0 - 0.5 * deltaTime); // a little drag
+	vec3 newPosition = position + newVelocity * deltaTime;
+	if (newPosition.y < floorHeight) // bounce off the floor, losing most of the energy
+	{
+		newPosition.y = floorHeight;
+		newVelocity.y = -newVelocity.y * 0.4;
+	}
+	outPosition = newPosition;
+	outVelocity = newVelocity;
+	outLife = vec2(life.x - deltaTime, life.y);
+}
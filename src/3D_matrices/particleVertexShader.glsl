@@ -0,0 +1,27 @@
+#version 330
+in vec3 position;
+in vec2 life;
+out vec4 fragmentColor;
+
+uniform mat4 viewMatrix       = mat4(1.0);
+uniform mat4 projectionMatrix = mat4(1.0);
+uniform float pointScale; // point size in pixels at one unit away
+
+void main()
+{
+	if (life.x <= 0.0)
+	{
+		gl_Position = vec4(0.0, 0.0, 2.0, 1.0); // dead - outside the clip volume, so nothing is drawn
+		gl_PointSize = 0.0;
+		fragmentColor = vec4(0.0);
+		return;
+	}
+
+	vec4 viewPosition = viewMatrix * vec4(position, 1.0);
+	gl_Position = projectionMatrix * viewPosition;
+	gl_PointSize = clamp(pointScale / -viewPosition.z, 1.0, 16.0);
+
+	// white hot, cooling through yellow and orange to a dull red as it fades out
+	float heat = life.x / life.y;
+	fragmentColor = vec4(mix(vec3(0.8, 0.1, 0.0), vec3(1.0, 0.9, 0.6), heat * heat), heat);
+}
@@ -0,0 +1,70 @@
+#include "renderQueue.h"
+
+#include <iostream>
+#include <algorithm>
+
+#define GLM_FORCE_RADIANS // suppress a warning in GLM 0.9.5
+#include <glm/glm.hpp>
+
+using std::cerr;
+using std::endl;
+
+RenderQueue::RenderQueue() : commandCount(0), overflowReported(false)
+{
+}
+
+void RenderQueue::clear()
+{
+	commandCount = 0;
+}
+
+// tag::sortKey[]
+uint64_t RenderQueue::sortKey(GLuint program, GLuint vertexArray, uint8_t material, float depth)
+{
+	uint64_t quantisedDepth = uint64_t(glm::clamp(depth, 0.0f, 1.0f) * float(0xffffff));
+	return (uint64_t(program & 0xff) << 56) | (uint64_t(vertexArray & 0xffff) << 40) | (uint64_t(material) << 32) | (quantisedDepth << 8);
+}
+// end::sortKey[]
+
+void RenderQueue::submit(const DrawCommand &command, float depth)
+{
+	if (commandCount == maxCommands)
+	{
+		if (!overflowReported)
+			cerr << "Render queue is full (" << maxCommands << " draws) - the rest of the frame is not drawn" << endl;
+		overflowReported = true;
+		return;
+	}
+	DrawCommand &queued = commands[commandCount];
+	queued = command;
+	queued.sortKey = sortKey(command.program, command.vertexArray, command.material, depth);
+	order[commandCount] = uint16_t(commandCount);
+	commandCount++;
+}
+
+void RenderQueue::sort()
+{
+	const DrawCommand *queued = commands;
+	std::sort(order, order + commandCount, [queued](uint16_t a, uint16_t b) { return queued[a].sortKey < queued[b].sortKey; });
+}
+
+// tag::executeQueue[]
+void RenderQueue::execute(GLStateCache &state)
+{
+	sort();
+	for (size_t i = 0; i < commandCount; i++)
+	{
+		const DrawCommand &command = sorted(i);
+		state.useProgram(command.program);
+		state.bindVertexArray(command.vertexArray);
+		state.uniform1i(command.objectLocation, command.object);
+
+		if (command.indexType == 0)
+			glDrawArrays(command.mode, command.first, command.count);
+		else
+			glDrawElements(command.mode, command.count, command.indexType, (GLvoid *)0);
+		state.countDraw();
+	}
+	clear();
+}
+// end::executeQueue[]
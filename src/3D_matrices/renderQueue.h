@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <GL/glew.h>
+
+#include "glStateCache.h"
+
+// tag::drawCommand[]
+//One draw, recorded rather than issued straight away
+struct DrawCommand
+{
+	uint64_t sortKey; // filled in by RenderQueue::submit
+	GLuint program;
+	GLuint vertexArray;
+	uint8_t material; // anything else the draw needs set up - the scene only has one material so far
+	GLint objectLocation;
+	GLint object; // which transform in the TransformBatch it uses
+
+	GLenum mode; // GL_TRIANGLES...
+	GLint first; // glDrawArrays when indexType is 0
+	GLsizei count;
+	GLenum indexType; // glDrawElements when not 0
+};
+// end::drawCommand[]
+
+// tag::renderQueue[]
+//Collects a frame's draws, sorts them so draws sharing a program and vertex array are next to each other,
+//then issues them through a GLStateCache, which skips the binds that are already in place.
+//
+//The sort key, most significant first:
+//  program (8 bits) | vertex array (16 bits) | material (8 bits) | depth, front to back (24 bits) | unused
+//so the expensive state changes happen least often, and within the same state, nearer things are
+//drawn first and hide more of what's behind them from the fragment shader.
+class RenderQueue
+{
+public:
+	static const size_t maxCommands = 256;
+
+	RenderQueue();
+
+	void clear();
+	void submit(const DrawCommand &command, float depth); // depth - 0 at the camera, 1 at the far plane
+	void sort(); // into sort key order - execute() does this first
+	void execute(GLStateCache &state); // sorts, then draws everything, and empties the queue
+
+	const DrawCommand &sorted(size_t i) const { return commands[order[i]]; }
+
+	size_t size() const { return commandCount; }
+
+	static uint64_t sortKey(GLuint program, GLuint vertexArray, uint8_t material, float depth);
+
+private:
+	RenderQueue(const RenderQueue &);
+	RenderQueue &operator=(const RenderQueue &);
+
+	DrawCommand commands[maxCommands];
+	uint16_t order[maxCommands]; // sorted indices into commands - cheaper to move than the commands
+	size_t commandCount;
+	bool overflowReported;
+};
+// end::renderQueue[]
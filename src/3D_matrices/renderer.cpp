@@ -0,0 +1,1182 @@
+#include "renderer.h"
+
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <algorithm>
+#include <string>
+
+#include <SDL2/SDL.h>
+
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "meshStreamer.h"
+#include "hudLayer.h"
+#include "lightClusters.h"
+#include "glStateCache.h"
+#include "renderQueue.h"
+#include "transformBatch.h"
+#include "particleSystem.h"
+#include "gpuArena.h"
+#include "assetPack.h"
+#include "dynamicResolution.h"
+#include "scene.h"
+
+using std::cout;
+using std::cerr;
+using std::endl;
+using std::string;
+
+std::string assetDirectory = "";
+
+// tag::assetPackVariables[]
+// Every asset in one memory mapped file, when there is one (see assetPack.h)
+AssetPack assetPack;
+std::string assetPackPath = "assets.pack"; // relative to assetDirectory, unless it's absolute
+// end::assetPackVariables[]
+
+//the file name on its own - assets are packed by name, whichever directory they came from
+static string assetName(const string &filePath)
+{
+	size_t slash = filePath.find_last_of("/\\");
+	return (slash == string::npos) ? filePath : filePath.substr(slash + 1);
+}
+
+// tag::loadShader[]
+std::string loadShader(const string filePath) {
+	AssetBlob blob;
+	if (assetPack.find(assetName(filePath), blob) && blob.type == ASSET_SHADER_SOURCE)
+	{
+		cout << "Shader Loaded from " << assetPack.path() << ": " << assetName(filePath) << endl;
+		return string(blob.data, blob.size);
+	}
+
+    std::ifstream fileStream(filePath, std::ios::in | std::ios::binary);
+	if (fileStream)
+	{
+		string fileData( (std::istreambuf_iterator<char>(fileStream)),
+		                 (std::istreambuf_iterator<char>()          ));
+
+		cout << "Shader Loaded from " << filePath << endl;
+		return fileData;
+	}
+	else
+	{
+        cerr << "Shader could not be loaded - cannot read file " << filePath << ". File does not exist." << endl;
+        return "";
+	}
+}
+// end::loadShader[]
+
+// tag::vertexData[]
+//the data about our geometry
+const GLfloat vertexData[] = {
+#pragma region
+	// ============================ Red + Black Paddle ===============================
+	//	  X			Y      Z       R       G       B       A
+		// Front Side
+		-0.5f,	  0.25f,   -2.5f,   1.0f,   0.0f,   0.0f,   1.0f, // 1
+		 0.5f,    0.25f,   -2.5f,   1.0f,   0.0f,   0.0f,   1.0f, // 2
+		 0.5f,   -0.25f,   -2.5f,   1.0f,   0.0f,   0.0f,   1.0f, // 3 
+		-0.5f,   -0.25f,   -2.5f,   1.0f,   0.0f,   0.0f,   1.0f, // 4
+		-0.5f,	  0.25f,   -2.5f,   1.0f,   0.0f,   0.0f,   1.0f, // 1
+		 0.5f,   -0.25f,   -2.5f,   1.0f,   0.0f,   0.0f,   1.0f, // 3
+
+		// Back Side
+		-0.5f,	  0.25f,   -2.3f,   1.0f,   0.0f,   0.0f,   1.0f, // 5
+		 0.5f,    0.25f,   -2.3f,   1.0f,   0.0f,   0.0f,   1.0f, // 6
+		 0.5f,   -0.25f,   -2.3f,   1.0f,   0.0f,   0.0f,   1.0f, // 7 
+		-0.5f,   -0.25f,   -2.3f,   1.0f,   0.0f,   0.0f,   1.0f, // 8
+		-0.5f,	  0.25f,   -2.3f,   1.0f,   0.0f,   0.0f,   1.0f, // 5
+		 0.5f,   -0.25f,   -2.3f,   1.0f,   0.0f,   0.0f,   1.0f, // 7
+
+		// Left Side
+		-0.5f,	  0.25f,   -2.5f,   0.0f,   0.0f,   0.0f,   1.0f, // 1
+		-0.5f,   -0.25f,   -2.5f,   0.0f,   0.0f,   0.0f,   1.0f, // 4
+		-0.5f,   -0.25f,   -2.3f,   0.0f,   0.0f,   0.0f,   1.0f, // 8
+		-0.5f,	  0.25f,   -2.5f,   0.0f,   0.0f,   0.0f,   1.0f, // 1
+		-0.5f,   -0.25f,   -2.3f,   0.0f,   0.0f,   0.0f,   1.0f, // 8
+		-0.5f,	  0.25f,   -2.3f,   0.0f,   0.0f,   0.0f,   1.0f, // 5
+
+		// Right Side
+		 0.5f,    0.25f,   -2.5f,   0.0f,   0.0f,   0.0f,   1.0f, // 2
+		 0.5f,   -0.25f,   -2.5f,   0.0f,   0.0f,   0.0f,   1.0f, // 3
+		 0.5f,   -0.25f,   -2.3f,   0.0f,   0.0f,   0.0f,   1.0f, // 7
+		 0.5f,    0.25f,   -2.5f,   0.0f,   0.0f,   0.0f,   1.0f, // 2
+		 0.5f,   -0.25f,   -2.3f,   0.0f,   0.0f,   0.0f,   1.0f, // 7
+		 0.5f,    0.25f,   -2.3f,   0.0f,   0.0f,   0.0f,   1.0f, // 6
+
+		// Top Side
+		-0.5f,	  0.25f,   -2.5f,   1.0f,   0.0f,   0.0f,   1.0f, // 1
+		 0.5f,    0.25f,   -2.5f,   1.0f,   0.0f,   0.0f,   1.0f, // 2
+		-0.5f,	  0.25f,   -2.3f,   1.0f,   0.0f,   0.0f,   1.0f, // 5
+		 0.5f,    0.25f,   -2.5f,   1.0f,   0.0f,   0.0f,   1.0f, // 2
+		-0.5f,	  0.25f,   -2.3f,   1.0f,   0.0f,   0.0f,   1.0f, // 5
+		 0.5f,    0.25f,   -2.3f,   1.0f,   0.0f,   0.0f,   1.0f, // 6
+
+		// Bottom Side
+		 0.5f,   -0.25f,   -2.5f,   1.0f,   0.0f,   0.0f,   1.0f, // 3 
+		-0.5f,   -0.25f,   -2.5f,   1.0f,   0.0f,   0.0f,   1.0f, // 4
+		-0.5f,   -0.25f,   -2.3f,   1.0f,   0.0f,   0.0f,   1.0f, // 8
+		 0.5f,   -0.25f,   -2.5f,   1.0f,   0.0f,   0.0f,   1.0f, // 3 
+		-0.5f,   -0.25f,   -2.3f,   1.0f,   0.0f,   0.0f,   1.0f, // 8
+		 0.5f,   -0.25f,   -2.3f,   1.0f,   0.0f,   0.0f,   1.0f, // 7
+	// ============================ End of Cube 1 ===============================
+	#pragma endregion Red + Black Paddle
+
+#pragma region
+	// ============================ Blue + White paddle ===============================
+	//	  X			Y      Z       R       G       B       A
+	// Front Side
+		-0.5f,	  0.25f,   2.3f,   0.0f,   0.0f,   1.0f,   1.0f, // 1
+		 0.5f,    0.25f,   2.3f,   0.0f,   0.0f,   1.0f,   1.0f, // 2
+		 0.5f,   -0.25f,   2.3f,   0.0f,   0.0f,   1.0f,   1.0f, // 3 
+		-0.5f,   -0.25f,   2.3f,   0.0f,   0.0f,   1.0f,   1.0f, // 4
+		-0.5f,	  0.25f,   2.3f,   0.0f,   0.0f,   1.0f,   1.0f, // 1
+		 0.5f,   -0.25f,   2.3f,   0.0f,   0.0f,   1.0f,   1.0f, // 3
+
+	// Back Side
+		-0.5f,	  0.25f,   2.5f,   0.0f,   0.0f,   1.0f,   1.0f, // 5
+		 0.5f,    0.25f,   2.5f,   0.0f,   0.0f,   1.0f,   1.0f, // 6
+		 0.5f,   -0.25f,   2.5f,   0.0f,   0.0f,   1.0f,   1.0f, // 7 
+		-0.5f,   -0.25f,   2.5f,   0.0f,   0.0f,   1.0f,   1.0f, // 8
+		-0.5f,	  0.25f,   2.5f,   0.0f,   0.0f,   1.0f,   1.0f, // 5
+ 		 0.5f,   -0.25f,   2.5f,   0.0f,   0.0f,   1.0f,   1.0f, // 7
+
+	// Left Side
+		-0.5f,	  0.25f,   2.3f,   1.0f,   1.0f,   1.0f,   1.0f, // 1
+		-0.5f,   -0.25f,   2.3f,   1.0f,   1.0f,   1.0f,   1.0f, // 4
+		-0.5f,   -0.25f,   2.5f,   1.0f,   1.0f,   1.0f,   1.0f, // 8
+		-0.5f,	  0.25f,   2.3f,   1.0f,   1.0f,   1.0f,   1.0f, // 1
+		-0.5f,   -0.25f,   2.5f,   1.0f,   1.0f,   1.0f,   1.0f, // 8
+		-0.5f,	  0.25f,   2.5f,   1.0f,   1.0f,   1.0f,   1.0f, // 5
+
+	// Right Side
+		 0.5f,    0.25f,   2.3f,   1.0f,   1.0f,   1.0f,   1.0f, // 2
+		 0.5f,   -0.25f,   2.3f,   1.0f,   1.0f,   1.0f,   1.0f, // 3
+		 0.5f,   -0.25f,   2.5f,   1.0f,   1.0f,   1.0f,   1.0f, // 7
+		 0.5f,    0.25f,   2.3f,   1.0f,   1.0f,   1.0f,   1.0f, // 2
+		 0.5f,   -0.25f,   2.5f,   1.0f,   1.0f,   1.0f,   1.0f, // 7
+		 0.5f,    0.25f,   2.5f,   1.0f,   1.0f,   1.0f,   1.0f, // 6
+
+	// Top Side
+		-0.5f,	  0.25f,   2.3f,   0.0f,   0.0f,   1.0f,   1.0f, // 1
+		 0.5f,    0.25f,   2.3f,   0.0f,   0.0f,   1.0f,   1.0f, // 2
+		-0.5f,	  0.25f,   2.5f,   0.0f,   0.0f,   1.0f,   1.0f, // 5
+		 0.5f,    0.25f,   2.3f,   0.0f,   0.0f,   1.0f,   1.0f, // 2
+		-0.5f,    0.25f,   2.5f,   0.0f,   0.0f,   1.0f,   1.0f, // 5
+		 0.5f,    0.25f,   2.5f,   0.0f,   0.0f,   1.0f,   1.0f, // 6
+
+	// Bottom Side
+		 0.5f,   -0.25f,   2.3f,   0.0f,   0.0f,   1.0f,   1.0f, // 3 
+		-0.5f,   -0.25f,   2.3f,   0.0f,   0.0f,   1.0f,   1.0f, // 4
+		-0.5f,   -0.25f,   2.5f,   0.0f,   0.0f,   1.0f,   1.0f, // 8
+		 0.5f,   -0.25f,   2.3f,   0.0f,   0.0f,   1.0f,   1.0f, // 3 
+		-0.5f,   -0.25f,   2.5f,   0.0f,   0.0f,   1.0f,   1.0f, // 8
+		 0.5f,   -0.25f,   2.5f,   0.0f,   0.0f,   1.0f,   1.0f, // 7
+	// ============================ End of Cube 2 ===============================
+#pragma endregion Blue + White Paddle
+};
+
+const GLfloat ballVertexData[] = {
+#pragma region 
+
+	//	  X			Y      Z       R       G       B       A
+	// Front Side
+		-0.1f,  0.1f, -0.1f, 0.0f, 1.0f, 0.0f, 1.0f, // 1
+		 0.1f,  0.1f, -0.1f, 0.0f, 1.0f, 0.0f, 1.0f, // 2
+		 0.1f, -0.1f, -0.1f, 0.0f, 1.0f, 0.0f, 1.0f, // 3 
+		-0.1f, -0.1f, -0.1f, 0.0f, 1.0f, 0.0f, 1.0f, // 4
+		-0.1f,  0.1f, -0.1f, 0.0f, 1.0f, 0.0f, 1.0f, // 1
+		 0.1f, -0.1f, -0.1f, 0.0f, 1.0f, 0.0f, 1.0f, // 3
+
+												// Back Side
+		-0.1f,  0.1f, 0.1f, 1.0f, 1.0f, 1.0f, 1.0f, // 5
+		 0.1f,  0.1f, 0.1f, 1.0f, 1.0f, 1.0f, 1.0f, // 6
+		 0.1f, -0.1f, 0.1f, 1.0f, 1.0f, 1.0f, 1.0f, // 7 
+		-0.1f, -0.1f, 0.1f, 1.0f, 1.0f, 1.0f, 1.0f, // 8
+		-0.1f,  0.1f, 0.1f, 1.0f, 1.0f, 1.0f, 1.0f, // 5
+		 0.1f, -0.1f, 0.1f, 1.0f, 1.0f, 1.0f, 1.0f, // 7
+
+											   // Left Side
+		-0.1f,  0.1f, -0.1f, 0.0f, 0.0f, 0.0f, 1.0f, // 1
+		-0.1f, -0.1f, -0.1f, 0.0f, 0.0f, 0.0f, 1.0f, // 4
+		-0.1f, -0.1f,  0.1f, 0.0f, 0.0f, 0.0f, 1.0f, // 8
+		-0.1f,  0.1f, -0.1f, 0.0f, 0.0f, 0.0f, 1.0f, // 1
+		-0.1f, -0.1f,  0.1f, 0.0f, 0.0f, 0.0f, 1.0f, // 8
+		-0.1f,  0.1f,  0.1f, 0.0f, 0.0f, 0.0f, 1.0f, // 5
+
+												 // Right Side
+		 0.1f,  0.1f, -0.1f,  0.0f,  0.0f,  1.0f,  1.0f, // 2
+		 0.1f, -0.1f, -0.1f,  0.0f,  0.0f,  1.0f,  1.0f, // 3
+		 0.1f, -0.1f,  0.1f,  0.0f,  0.0f,  1.0f,  1.0f, // 7
+		 0.1f,  0.1f, -0.1f,  0.0f,  0.0f,  1.0f,  1.0f, // 2
+		 0.1f, -0.1f,  0.1f,  0.0f,  0.0f,  1.0f,  1.0f, // 7
+		 0.1f,  0.1f,  0.1f,  0.0f,  0.0f,  1.0f,  1.0f, // 6
+
+													// Top Side
+		-0.1f,  0.1f,  -0.1f,  1.0f,  1.0f,  0.0f,  1.0f, // 1
+		 0.1f,  0.1f,  -0.1f,  1.0f,  1.0f,  0.0f,  1.0f, // 2
+		-0.1f,  0.1f,   0.1f,  1.0f,  1.0f,  0.0f,  1.0f, // 5
+		 0.1f,  0.1f,  -0.1f,  1.0f,  1.0f,  0.0f,  1.0f, // 2
+		-0.1f,  0.1f,   0.1f,  1.0f,  1.0f,  0.0f,  1.0f, // 5
+		 0.1f,  0.1f,   0.1f,  1.0f,  1.0f,  0.0f,  1.0f, // 6
+
+													 // Bottom Side
+		 0.1f,  -0.1f, -0.1f,  1.0f,  0.0f,  0.0f,  1.0f, // 3 
+		-0.1f,  -0.1f, -0.1f,  1.0f,  0.0f,  0.0f,  1.0f, // 4
+		-0.1f,  -0.1f,  0.1f,  1.0f,  0.0f,  0.0f,  1.0f, // 8
+		 0.1f,  -0.1f, -0.1f,  1.0f,  0.0f,  0.0f,  1.0f, // 3 
+		-0.1f,  -0.1f,  0.1f,  1.0f,  0.0f,  0.0f,  1.0f, // 8
+		 0.1f,  -0.1f,  0.1f,  1.0f,  0.0f,  0.0f,  1.0f, // 7
+
+#pragma endregion Ball Data
+};
+
+
+// end::vertexData[]
+
+// tag::GLVariables[]
+//our GL and GLSL variables
+//programIDs
+GpuProgram theProgram; //the GpuProgram we'll fill in to refer to the GLSL program (only have 1 at this point)
+
+//attribute locations
+GLint positionLocation; //GLuint that we'll fill in with the location of the `position` attribute in the GLSL
+GLint vertexColorLocation; //GLuint that we'll fill in with the location of the `vertexColor` attribute in the GLSL
+GLint normalLocation;
+
+//uniform location
+GLint objectLocation; // which of the batch's transforms a draw uses
+GLint viewportSizeLocation;
+
+// These are for the bats
+GpuBuffer vertexDataBufferObject;
+GpuVertexArray vertexArrayObject;
+
+// These are for the Ball
+GpuBuffer vertexDataBufferObject2;
+GpuVertexArray vertexArrayObject2;
+
+const size_t vertexFloats = 10; // position, colour and normal - the normals are added by withNormals()
+
+const float nearPlane = 0.1f;
+const float farPlane = 100.0f;
+// end::GLVariables[]
+
+// tag::lightVariables[]
+// Every light in the scene, rebuilt each frame, and the clusters they are sorted into (see lightClusters.h)
+LightClusters lightClusters;
+PointLight sceneLights[LightClusters::maxLights];
+int displayLightCount = 64; // the coloured lights around the edge of the arena
+const GLint firstLightTextureUnit = 1;
+// end::lightVariables[]
+
+// tag::stateVariables[]
+// The scene's draws are queued, sorted by state, and issued through a shadow of the GL state (see renderQueue.h)
+GLStateCache glState;
+RenderQueue renderQueue;
+// end::stateVariables[]
+
+// tag::transformVariables[]
+// Every object's model-view and model-view-projection matrices, built in one pass each frame (see transformBatch.h)
+TransformBatch transforms;
+// end::transformVariables[]
+
+// tag::resolutionVariables[]
+// The scene is drawn offscreen at a scale picked from the measured GPU frame time, then stretched over the window (see dynamicResolution.h)
+ResolutionController resolution;
+GpuTimer gpuTimer;
+SceneTarget sceneTarget;
+int drawableWidth = 1000; // the window, in pixels - set by setDrawableSize
+int drawableHeight = 700;
+int sceneWidth = 1000; // what the scene is drawn at this frame
+int sceneHeight = 700;
+double lastGpuFrameMs = 0.0;
+GLuint outputFramebuffer = 0; // the window's framebuffer, unless drawing somewhere else
+// end::resolutionVariables[]
+
+// tag::particleVariables[]
+// Sparks for every impact in the game state, simulated on the GPU (see particleSystem.h)
+ParticleSystem particles;
+unsigned int impactsSeen = 0; // how many of the state's impacts already have sparks
+Uint64 lastParticleUpdate = 0;
+const int particlesPerImpact = 16384;
+const float particleSize = 0.015f; // world units
+// end::particleVariables[]
+
+// tag::arenaVariables[]
+// Courts of AI bats behind the main one, simulated and drawn without leaving the GPU (see gpuArena.h)
+GpuArena arena;
+int arenaCourts = 0; // none unless asked for, with setArenaCourts
+bool arenaUnavailable = false; // the GL version is too old, or the shaders failed - don't keep trying
+Uint64 lastArenaUpdate = 0;
+double arenaTimeOwed = 0.0; // seconds not simulated yet
+const int maxArenaTicksPerFrame = 5;
+// end::arenaVariables[]
+
+// tag::hudVariables[]
+// The scores and any overlay text are drawn by the HUD layer, in one draw call (see hudLayer.h)
+HudLayer hud;
+const uint8_t redPipColor[4] = { 255, 0, 0, 255 };
+const uint8_t bluePipColor[4] = { 0, 0, 255, 255 };
+const uint8_t hudTextColor[4] = { 255, 255, 255, 220 };
+// end::hudVariables[]
+
+// tag::meshStreaming[]
+// High-poly replacements for the bats and ball, streamed in from .lodmesh files (see lodMesh.h)
+// Until a mesh has a resident level, the compiled-in cubes above are drawn instead
+MeshStreamer meshStreamer;
+int redBatMesh = -1;
+int blueBatMesh = -1;
+int ballMesh = -1;
+const size_t meshUploadBudget = 256 * 1024; // bytes uploaded per frame, so streaming never causes a long frame
+
+// the compiled-in bats have their z offset baked into the vertices, for the compiled-in court - the streamed ones
+// are centred on the origin, so they go half their depth behind the court's bat plane
+const float batMeshHalfDepth = 0.1f;
+// end::meshStreaming[]
+
+// tag::sceneVariables[]
+// The court's walls and cameras, from the scene file (see scene.h). Each wall has a buffer of its own,
+// so one can be rebuilt and uploaded again without touching the rest
+struct SceneObject
+{
+	std::string name;
+	glm::vec3 position;
+	GpuBuffer vertexBuffer;
+	GpuVertexArray vertexArray;
+	int object; // its transform this frame
+};
+
+Scene renderScene = defaultScene(); // the last scene applied
+std::vector<SceneObject> sceneObjects; // a wall each, in no particular order - the render queue sorts the draws anyway
+int wallUploads = 0;
+const float wallBottom = -0.25f;
+const float wallTop = 0.5f;
+// end::sceneVariables[]
+
+// tag::createShader[]
+GpuShader createShader(GLenum eShaderType, const std::string &strShaderFile)
+{
+	GpuShader shaderObject = GpuShader::adopt(glCreateShader(eShaderType), "shader");
+	GLuint shader = shaderObject.get();
+	//error check
+	const char *strFileData = strShaderFile.c_str();
+	glShaderSource(shader, 1, &strFileData, NULL);
+
+	glCompileShader(shader);
+
+	GLint status;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+	if (status == GL_FALSE)
+	{
+		GLint infoLogLength;
+		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLogLength);
+
+		GLchar *strInfoLog = new GLchar[infoLogLength + 1];
+		glGetShaderInfoLog(shader, infoLogLength, NULL, strInfoLog);
+
+		const char *strShaderType = NULL;
+		switch (eShaderType)
+		{
+		case GL_VERTEX_SHADER: strShaderType = "vertex"; break;
+		case GL_GEOMETRY_SHADER: strShaderType = "geometry"; break;
+		case GL_FRAGMENT_SHADER: strShaderType = "fragment"; break;
+		}
+
+		fprintf(stderr, "Compile failure in %s shader:\n%s\n", strShaderType, strInfoLog);
+		delete[] strInfoLog;
+	}
+
+	return shaderObject;
+}
+// end::createShader[]
+
+// tag::createProgram[]
+GpuProgram createProgram(const std::vector<GpuShader> &shaderList, const std::vector<const char *> &feedbackVaryings, const char *label)
+{
+	GpuProgram programObject = GpuProgram::adopt(glCreateProgram(), label);
+	GLuint program = programObject.get();
+
+	for (size_t iLoop = 0; iLoop < shaderList.size(); iLoop++)
+		glAttachShader(program, shaderList[iLoop].get());
+
+	//which outputs transform feedback writes has to be set before linking
+	if (!feedbackVaryings.empty())
+		glTransformFeedbackVaryings(program, GLsizei(feedbackVaryings.size()), feedbackVaryings.data(), GL_INTERLEAVED_ATTRIBS);
+
+	glLinkProgram(program);
+
+	GLint status;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (status == GL_FALSE)
+	{
+		GLint infoLogLength;
+		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &infoLogLength);
+
+		GLchar *strInfoLog = new GLchar[infoLogLength + 1];
+		glGetProgramInfoLog(program, infoLogLength, NULL, strInfoLog);
+		fprintf(stderr, "Linker failure: %s\n", strInfoLog);
+		delete[] strInfoLog;
+	}
+
+	for (size_t iLoop = 0; iLoop < shaderList.size(); iLoop++)
+		glDetachShader(program, shaderList[iLoop].get());
+
+	return programObject;
+}
+// end::createProgram[]
+
+// tag::initializeProgram[]
+void initializeProgram()
+{
+	std::vector<GpuShader> shaderList;
+
+	shaderList.push_back(createShader(GL_VERTEX_SHADER, loadShader(assetDirectory + "vertexShader.glsl")));
+	shaderList.push_back(createShader(GL_FRAGMENT_SHADER, loadShader(assetDirectory + "fragmentShader.glsl")));
+
+	theProgram = createProgram(shaderList, std::vector<const char *>(), "scene program");
+	if (theProgram.get() == 0)
+	{
+		cerr << "GLSL program creation error." << std::endl;
+		SDL_Quit();
+		exit(1);
+	}
+	else {
+		cout << "GLSL program creation OK! GLUint is: " << theProgram.get() << std::endl;
+	}
+
+	// tag::glGetAttribLocation[]
+	positionLocation = glGetAttribLocation(theProgram.get(), "position");
+	vertexColorLocation = glGetAttribLocation(theProgram.get(), "vertexColor");
+	normalLocation = glGetAttribLocation(theProgram.get(), "normal");
+	// end::glGetAttribLocation[]
+
+	// tag::glGetUniformLocation[]
+	objectLocation = glGetUniformLocation(theProgram.get(), "object");
+	viewportSizeLocation = glGetUniformLocation(theProgram.get(), "viewportSize");
+	TransformBatch::bindBlock(theProgram.get()); // the model, view and projection matrices all come from the transform batch
+
+	//only generates runtime code in debug mode
+	SDL_assert_release( objectLocation != -1);
+	// end::glGetUniformLocation[]
+
+	//the shaders are deleted as shaderList goes out of scope - we don't need them anymore as they are now in theProgram
+}
+// end::initializeProgram[]
+
+// tag::initializeVertexArrayObject[]
+//setup a GL object (a VertexArrayObject) that stores how to access data and from where
+void initializeVertexArrayObject()
+{
+	vertexArrayObject = GpuVertexArray::create("vertex array bats"); //create a Vertex Array Object
+	cout << "Vertex Array Object created OK! GLUint is: " << vertexArrayObject.get() << std::endl;
+
+	glBindVertexArray(vertexArrayObject.get()); //make the just created vertexArrayObject the active one
+
+		glBindBuffer(GL_ARRAY_BUFFER, vertexDataBufferObject.get()); //bind vertexDataBufferObject
+
+		glEnableVertexAttribArray(positionLocation); //enable attribute at index positionLocation
+		glEnableVertexAttribArray(vertexColorLocation); //enable attribute at index vertexColorLocation
+		glEnableVertexAttribArray(normalLocation);
+
+		// tag::glVertexAttribPointer[]
+		glVertexAttribPointer(positionLocation,    3, GL_FLOAT, GL_FALSE, (vertexFloats * sizeof(GL_FLOAT)), (GLvoid *) (0 * sizeof(GLfloat))); //specify that position data contains four floats per vertex, and goes into attribute index positionLocation
+		glVertexAttribPointer(vertexColorLocation, 4, GL_FLOAT, GL_FALSE, (vertexFloats * sizeof(GL_FLOAT)), (GLvoid *) (3 * sizeof(GLfloat))); //specify that position data contains four floats per vertex, and goes into attribute index vertexColorLocation
+		glVertexAttribPointer(normalLocation, 3, GL_FLOAT, GL_FALSE, (vertexFloats * sizeof(GL_FLOAT)), (GLvoid *)(7 * sizeof(GLfloat))); //the normals were added by withNormals()
+		// end::glVertexAttribPointer[]
+
+// ============================================= This is the second VAO -- To be used for the Ball ===================================================
+	glBindVertexArray(0); //unbind the vertexArrayObject so we can't change it
+
+		vertexArrayObject2 = GpuVertexArray::create("vertex array ball"); //create a Vertex Array Object
+		cout << "Vertex Array Object 2 created OK! GLUint is: " << vertexArrayObject2.get() << std::endl;
+
+		glBindVertexArray(vertexArrayObject2.get()); //make the just created vertexArrayObject the active one
+		glBindBuffer(GL_ARRAY_BUFFER, vertexDataBufferObject2.get()); //bind vertexDataBufferObject
+
+		glEnableVertexAttribArray(positionLocation); //enable attribute at index positionLocation
+		glEnableVertexAttribArray(vertexColorLocation); //enable attribute at index vertexColorLocation
+		glEnableVertexAttribArray(normalLocation);
+
+		// tag::glVertexAttribPointer[]
+		glVertexAttribPointer(positionLocation, 3, GL_FLOAT, GL_FALSE, (vertexFloats * sizeof(GL_FLOAT)), (GLvoid *)(0 * sizeof(GLfloat))); //specify that position data contains four floats per vertex, and goes into attribute index positionLocation
+		glVertexAttribPointer(vertexColorLocation, 4, GL_FLOAT, GL_FALSE, (vertexFloats * sizeof(GL_FLOAT)), (GLvoid *)(3 * sizeof(GLfloat))); //specify that position data contains four floats per vertex, and goes into attribute index vertexColorLocation
+		glVertexAttribPointer(normalLocation, 3, GL_FLOAT, GL_FALSE, (vertexFloats * sizeof(GL_FLOAT)), (GLvoid *)(7 * sizeof(GLfloat))); //the normals were added by withNormals()
+																																// end::glVertexAttribPointer[]
+	glBindVertexArray(0); //unbind the vertexArrayObject so we can't change it
+
+
+	//cleanup
+	glDisableVertexAttribArray(positionLocation); //disable vertex attribute at index positionLocation
+	glBindBuffer(GL_ARRAY_BUFFER, 0); //unbind array buffer
+
+}
+// end::initializeVertexArrayObject[]
+
+// tag::withNormals[]
+//The compiled-in arrays are position and colour only - add a flat normal to every vertex, making 10 floats per vertex.
+//The arrays are a list of cubes, 36 vertices each, and their triangles aren't all wound the same way,
+//so each normal is pointed away from the middle of its cube rather than trusting the winding.
+std::vector<GLfloat> withNormals(const GLfloat *data, size_t floatCount)
+{
+	const size_t inputFloats = 7;
+	const size_t cubeVertices = 36;
+	size_t vertexCount = floatCount / inputFloats;
+	std::vector<GLfloat> result(vertexCount * vertexFloats);
+
+	for (size_t cube = 0; cube < vertexCount; cube += cubeVertices)
+	{
+		size_t cubeEnd = std::min(cube + cubeVertices, vertexCount);
+		glm::vec3 cubeCenter(0.0f);
+		for (size_t v = cube; v < cubeEnd; v++)
+			cubeCenter += glm::vec3(data[v * inputFloats], data[v * inputFloats + 1], data[v * inputFloats + 2]);
+		cubeCenter /= float(cubeEnd - cube);
+
+		for (size_t t = cube; t + 2 < cubeEnd; t += 3)
+		{
+			glm::vec3 corners[3];
+			for (int i = 0; i < 3; i++)
+				corners[i] = glm::vec3(data[(t + i) * inputFloats], data[(t + i) * inputFloats + 1], data[(t + i) * inputFloats + 2]);
+			glm::vec3 normal = glm::normalize(glm::cross(corners[1] - corners[0], corners[2] - corners[0]));
+			if (glm::dot(normal, (corners[0] + corners[1] + corners[2]) / 3.0f - cubeCenter) < 0.0f)
+				normal = -normal;
+
+			for (int i = 0; i < 3; i++)
+			{
+				std::copy(data + (t + i) * inputFloats, data + (t + i + 1) * inputFloats, &result[(t + i) * vertexFloats]);
+				result[(t + i) * vertexFloats + 7] = normal.x;
+				result[(t + i) * vertexFloats + 8] = normal.y;
+				result[(t + i) * vertexFloats + 9] = normal.z;
+			}
+		}
+	}
+	return result;
+}
+// end::withNormals[]
+
+// tag::initializeVertexBuffer[]
+//uploads the asset pack's copy of a compiled-in array straight from the mapping, when the pack has one -
+//otherwise the compiled-in array, with its normals added
+void uploadVertexArray(GpuBuffer &buffer, const char *name, const GLfloat *data, size_t floatCount)
+{
+	size_t bytes = floatCount / 7 * vertexFloats * sizeof(GLfloat);
+	AssetBlob blob;
+	if (assetPack.find(name, blob) && blob.type == ASSET_VERTEX_ARRAY)
+	{
+		if (blob.size == bytes) // the draws have their vertex counts built in
+		{
+			buffer.upload(GL_ARRAY_BUFFER, blob.size, blob.data, GL_STATIC_DRAW);
+			return;
+		}
+		cerr << name << " in " << assetPack.path() << " is " << blob.size << " bytes, expected " << bytes << " - using the built in one" << endl;
+	}
+	std::vector<GLfloat> dataWithNormals = withNormals(data, floatCount);
+	buffer.upload(GL_ARRAY_BUFFER, dataWithNormals.size() * sizeof(GLfloat), dataWithNormals.data(), GL_STATIC_DRAW);
+}
+
+void initializeVertexBuffer()
+{
+	vertexDataBufferObject = GpuBuffer::create("vertices bats");
+
+	glBindBuffer(GL_ARRAY_BUFFER, vertexDataBufferObject.get());
+	uploadVertexArray(vertexDataBufferObject, "bats.vertices", vertexData, sizeof(vertexData) / sizeof(GLfloat));
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	cout << "vertexDataBufferObject created OK! GLUint is: " << vertexDataBufferObject.get() << std::endl;
+
+
+	vertexDataBufferObject2 = GpuBuffer::create("vertices ball");
+
+	glBindBuffer(GL_ARRAY_BUFFER, vertexDataBufferObject2.get());
+	uploadVertexArray(vertexDataBufferObject2, "ball.vertices", ballVertexData, sizeof(ballVertexData) / sizeof(GLfloat));
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	cout << "vertexDataBufferObject 2 created OK! GLUint is: " << vertexDataBufferObject2.get() << std::endl;
+
+	initializeVertexArrayObject();
+}
+// end::initializeVertexBuffer[]
+
+// tag::sceneWalls[]
+//a box the size of the wall, centred on the origin, with 7 floats per vertex like the compiled-in arrays -
+//blue on the sides facing across the court, grey on the ends, and black on the top and bottom
+std::vector<GLfloat> wallVertexData(const SceneWall &wall)
+{
+	const float x = wall.size.x * 0.5f;
+	const float z = wall.size.y * 0.5f;
+	const glm::vec3 corners[8] = { { -x, wallTop, -z }, { x, wallTop, -z }, { x, wallBottom, -z }, { -x, wallBottom, -z },
+		{ -x, wallTop, z }, { x, wallTop, z }, { x, wallBottom, z }, { -x, wallBottom, z } };
+	const int faces[6][4] = { { 0, 1, 2, 3 }, { 4, 5, 6, 7 }, { 0, 3, 7, 4 }, { 1, 2, 6, 5 }, { 0, 1, 5, 4 }, { 3, 2, 6, 7 } };
+	const glm::vec3 grey(0.2f), blue(0.0f, 0.5f, 0.7f), black(0.0f);
+	const glm::vec3 faceColors[6] = { grey, grey, blue, blue, black, black };
+	const int triangles[6] = { 0, 1, 2, 0, 2, 3 }; // two per face, as corners of the face
+
+	std::vector<GLfloat> data;
+	data.reserve(6 * 6 * 7);
+	for (int face = 0; face < 6; face++)
+	{
+		for (int corner : triangles)
+		{
+			const glm::vec3 &position = corners[faces[face][corner]];
+			data.insert(data.end(), { position.x, position.y, position.z, faceColors[face].x, faceColors[face].y, faceColors[face].z, 1.0f });
+		}
+	}
+	return data;
+}
+
+//builds the wall's vertices, and uploads them into its buffer - which is made, with its vertex array, the first time
+void uploadWall(SceneObject &object, const SceneWall &wall)
+{
+	object.name = wall.name;
+	object.position = glm::vec3(wall.position.x, 0.0f, wall.position.y);
+	std::vector<GLfloat> vertices = wallVertexData(wall);
+	std::vector<GLfloat> dataWithNormals = withNormals(vertices.data(), vertices.size());
+
+	if (object.vertexBuffer.get() == 0)
+	{
+		object.vertexBuffer = GpuBuffer::create("vertices wall");
+		object.vertexArray = GpuVertexArray::create("vertex array wall");
+		glBindVertexArray(object.vertexArray.get());
+		glBindBuffer(GL_ARRAY_BUFFER, object.vertexBuffer.get());
+		glEnableVertexAttribArray(positionLocation);
+		glEnableVertexAttribArray(vertexColorLocation);
+		glEnableVertexAttribArray(normalLocation);
+		glVertexAttribPointer(positionLocation, 3, GL_FLOAT, GL_FALSE, (vertexFloats * sizeof(GL_FLOAT)), (GLvoid *)(0 * sizeof(GLfloat)));
+		glVertexAttribPointer(vertexColorLocation, 4, GL_FLOAT, GL_FALSE, (vertexFloats * sizeof(GL_FLOAT)), (GLvoid *)(3 * sizeof(GLfloat)));
+		glVertexAttribPointer(normalLocation, 3, GL_FLOAT, GL_FALSE, (vertexFloats * sizeof(GL_FLOAT)), (GLvoid *)(7 * sizeof(GLfloat)));
+		glBindVertexArray(0);
+	}
+	else
+		glBindBuffer(GL_ARRAY_BUFFER, object.vertexBuffer.get());
+	object.vertexBuffer.upload(GL_ARRAY_BUFFER, dataWithNormals.size() * sizeof(GLfloat), dataWithNormals.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	wallUploads++;
+}
+
+void buildSceneObjects()
+{
+	sceneObjects.clear();
+	sceneObjects.resize(renderScene.walls.size());
+	for (size_t i = 0; i < renderScene.walls.size(); i++)
+		uploadWall(sceneObjects[i], renderScene.walls[i]);
+	cout << "Scene walls created OK! " << sceneObjects.size() << " walls" << endl;
+}
+
+std::vector<SceneObject>::iterator findSceneObject(const std::string &name)
+{
+	return std::find_if(sceneObjects.begin(), sceneObjects.end(), [&](const SceneObject &object) { return object.name == name; });
+}
+// end::sceneWalls[]
+
+// tag::applyScene[]
+SceneDiff applyScene(const Scene &scene)
+{
+	SceneDiff diff = diffScenes(renderScene, scene);
+	renderScene = scene; // the cameras are read from here every frame, and the court comes with the game state
+	if (theProgram.get() == 0)
+		return diff; // nothing loaded yet - loadAssets builds all of it
+
+	for (const SceneChange &change : diff.walls)
+	{
+		std::vector<SceneObject>::iterator object = findSceneObject(change.name);
+		const SceneWall *wall = findSceneWall(scene, change.name);
+		switch (change.type)
+		{
+		case SCENE_WALL_ADDED:
+			sceneObjects.push_back(SceneObject());
+			uploadWall(sceneObjects.back(), *wall);
+			break;
+		case SCENE_WALL_RESHAPED:
+			uploadWall(*object, *wall); // into the buffer it already has
+			break;
+		case SCENE_WALL_MOVED:
+			object->position = glm::vec3(wall->position.x, 0.0f, wall->position.y); // the same vertices - only its transform changes
+			break;
+		case SCENE_WALL_REMOVED:
+			sceneObjects.erase(object); // its buffer and vertex array go with it
+			break;
+		default:
+			break;
+		}
+	}
+	return diff;
+}
+
+int sceneWallUploads()
+{
+	return wallUploads;
+}
+// end::applyScene[]
+
+// tag::assetPackLoading[]
+// Everything the game loads by name - what --pack-assets puts in a pack
+const char *const shaderAssets[] = {
+	"vertexShader.glsl", "fragmentShader.glsl", "hudVertexShader.glsl", "hudFragmentShader.glsl",
+	"particleUpdateShader.glsl", "particleVertexShader.glsl", "particleFragmentShader.glsl",
+	"arenaUpdateShader.glsl", "arenaVertexShader.glsl", "arenaFragmentShader.glsl" };
+const char *const meshAssets[] = { "redBat.lodmesh", "blueBat.lodmesh", "ball.lodmesh" };
+
+void setAssetPackPath(const std::string &filePath)
+{
+	assetPackPath = filePath;
+}
+
+void openAssetPack()
+{
+	if (assetPackPath.empty())
+		return;
+	bool absolute = assetPackPath[0] == '/' || assetPackPath[0] == '\\' || assetPackPath.find(':') != string::npos;
+	string path = absolute ? assetPackPath : assetDirectory + assetPackPath;
+	if (!std::ifstream(path).good())
+		cout << "No asset pack at " << path << " - loading each asset from its own file" << endl;
+	else if (assetPack.open(path))
+		cout << "Asset pack " << path << " mapped OK! " << assetPack.assetCount() << " assets, " << assetPack.size() / 1024 << " KB" << endl;
+}
+
+//from the pack, uploaded straight from its mapping, if it's in there - otherwise streamed in from its own file
+int requestMeshAsset(const char *name)
+{
+	AssetBlob blob;
+	if (assetPack.find(name, blob) && blob.type == ASSET_LOD_MESH)
+	{
+		int meshId = meshStreamer.requestMesh(string(name), blob.data, blob.size);
+		if (meshId >= 0)
+			return meshId;
+	}
+	return meshStreamer.requestMesh(assetDirectory + name);
+}
+
+std::vector<std::string> assetFileNames()
+{
+	std::vector<std::string> names(std::begin(shaderAssets), std::end(shaderAssets));
+	names.insert(names.end(), std::begin(meshAssets), std::end(meshAssets));
+	return names;
+}
+
+bool packAssets(const std::string &packPath)
+{
+	AssetPackWriter writer;
+	bool complete = true;
+	for (const char *name : shaderAssets)
+		complete = writer.addFile(name, ASSET_SHADER_SOURCE, assetDirectory + name) && complete;
+	for (const char *name : meshAssets)
+		complete = writer.addFile(name, ASSET_LOD_MESH, assetDirectory + name) && complete;
+	if (!complete)
+	{
+		cerr << "Nothing packed - every asset has to be there (--generate-meshes writes the .lodmesh files)" << endl;
+		return false;
+	}
+
+	//the compiled-in arrays, with their normals worked out now rather than at every startup
+	std::vector<GLfloat> bats = withNormals(vertexData, sizeof(vertexData) / sizeof(GLfloat));
+	std::vector<GLfloat> ball = withNormals(ballVertexData, sizeof(ballVertexData) / sizeof(GLfloat));
+	writer.add("bats.vertices", ASSET_VERTEX_ARRAY, bats.data(), bats.size() * sizeof(GLfloat));
+	writer.add("ball.vertices", ASSET_VERTEX_ARRAY, ball.data(), ball.size() * sizeof(GLfloat));
+	return writer.write(packPath);
+}
+// end::assetPackLoading[]
+
+// tag::loadAssets[]
+void loadAssets()
+{
+	openAssetPack(); //everything below loads from the pack first, if there is one
+
+	initializeProgram(); //create GLSL Shaders, link into a GLSL program, and get IDs of attributes and variables
+
+	initializeVertexBuffer(); //load data into a vertex buffer
+	buildSceneObjects(); //a buffer for each of the scene's walls
+
+	hud.load((assetDirectory + "hudVertexShader.glsl").c_str(), (assetDirectory + "hudFragmentShader.glsl").c_str());
+	lightClusters.load();
+	transforms.load();
+	gpuTimer.load();
+	sceneTarget.resize(drawableWidth, drawableHeight);
+	particles.load((assetDirectory + "particleUpdateShader.glsl").c_str(), (assetDirectory + "particleVertexShader.glsl").c_str(), (assetDirectory + "particleFragmentShader.glsl").c_str());
+
+	meshStreamer.setVertexAttributes(positionLocation, vertexColorLocation, normalLocation);
+	meshStreamer.start(); //meshes load in the background, and are uploaded a little each frame in preRender
+	redBatMesh = requestMeshAsset("redBat.lodmesh");
+	blueBatMesh = requestMeshAsset("blueBat.lodmesh");
+	ballMesh = requestMeshAsset("ball.lodmesh");
+
+	cout << "Loaded Assets OK!\n";
+}
+// end::loadAssets[]
+
+void unloadAssets()
+{
+	meshStreamer.stop();
+	meshStreamer.releaseAll();
+	hud.unload();
+	lightClusters.unload();
+	transforms.unload();
+	particles.unload();
+	arena.unload();
+	gpuTimer.unload();
+	sceneTarget.unload();
+	glState.forgetProgram(theProgram.get()); // a reloaded program may get the same name, with none of the old uniforms set
+	theProgram.reset();
+	vertexArrayObject.reset();
+	vertexArrayObject2.reset();
+	vertexDataBufferObject.reset();
+	vertexDataBufferObject2.reset();
+	sceneObjects.clear();
+	assetPack.close(); // after the mesh streamer, which may still have levels waiting to upload from it
+}
+
+void setDrawableSize(int width, int height)
+{
+	drawableWidth = std::max(width, 1);
+	drawableHeight = std::max(height, 1);
+}
+
+void setOutputFramebuffer(GLuint framebuffer)
+{
+	outputFramebuffer = framebuffer;
+}
+
+void setTargetFrameTime(float frameMs)
+{
+	resolution.setTarget(frameMs);
+}
+
+void setRenderScale(float scale)
+{
+	resolution.setFixedScale(scale);
+}
+
+GLStateCache::Counts renderCallCounts()
+{
+	return glState.counts();
+}
+
+RenderResolution renderResolution()
+{
+	RenderResolution current;
+	current.sceneWidth = sceneWidth;
+	current.sceneHeight = sceneHeight;
+	current.scale = resolution.scale();
+	current.dynamic = resolution.dynamic();
+	current.gpuFrameMs = lastGpuFrameMs;
+	return current;
+}
+
+void setDisplayLightCount(int count)
+{
+	displayLightCount = std::max(0, std::min(count, LightClusters::maxLights - 5)); // leave room for the floodlights and the ball
+}
+
+void setArenaCourts(int count)
+{
+	arenaCourts = std::max(0, std::min(count, int(GpuArena::maxCourts)));
+}
+
+void setLightClustering(bool clustered)
+{
+	if (clustered)
+		lightClusters.setGrid(16, 9, 24);
+	else
+		lightClusters.setGrid(1, 1, 1);
+}
+
+// tag::preRender[]
+void preRender()
+{
+
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LEQUAL);
+	//pick this frame's scene size from the GPU times that have come back since the last frame
+	double gpuFrameMs;
+	while (gpuTimer.collect(gpuFrameMs))
+	{
+		lastGpuFrameMs = gpuFrameMs;
+		resolution.update(gpuFrameMs);
+	}
+	sceneTarget.resize(drawableWidth, drawableHeight); // only reallocates when the window changed size
+	sceneWidth = std::max(1, int(drawableWidth * resolution.scale() + 0.5f));
+	sceneHeight = std::max(1, int(drawableHeight * resolution.scale() + 0.5f));
+
+	gpuTimer.begin(); // ended at the end of render()
+	sceneTarget.bind(sceneWidth, sceneHeight); //set viewpoint
+	glClearColor(0.2f, 0.0f, 0.2f, 1.0f); //set clear colour
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); //clear the window (technical the scissor box bounds)
+
+	meshStreamer.uploadPending(meshUploadBudget); //move any streamed mesh levels into GL buffers
+}
+// end::preRender[]
+
+// tag::submitDraw[]
+//queue a draw with the scene program - the queue sorts it by state, then by how far it is from the camera
+//object is its index in the transform batch, which must already be built
+void submitDraw(DrawCommand &command, int object)
+{
+	if (object < 0) // the batch was full
+		return;
+	command.program = theProgram.get();
+	command.material = 0;
+	command.objectLocation = objectLocation;
+	command.object = object;
+	float viewDepth = -transforms.object(object).modelView[3].z;
+	renderQueue.submit(command, viewDepth / farPlane);
+}
+
+//one of the compiled-in models
+void submitArrays(GLuint vertexArray, GLint first, GLsizei count, int object)
+{
+	DrawCommand command;
+	command.vertexArray = vertexArray;
+	command.mode = GL_TRIANGLES;
+	command.first = first;
+	command.count = count;
+	command.indexType = 0;
+	submitDraw(command, object);
+}
+// end::submitDraw[]
+
+// tag::drawStreamedMesh[]
+//queue a streamed mesh at the level of detail that suits its size on screen
+//returns false if no level is resident yet, so the caller can draw the compiled-in geometry instead
+bool submitStreamedMesh(int meshId, int object, const glm::mat4 &projectionMatrix)
+{
+	if (object < 0)
+		return false;
+	int lod = meshStreamer.selectLod(meshId, transforms.object(object).modelView, projectionMatrix);
+	if (lod < 0)
+		return false;
+
+	DrawCommand command;
+	meshStreamer.fillDrawCommand(meshId, lod, command);
+	submitDraw(command, object);
+	return true;
+}
+// end::drawStreamedMesh[]
+
+// tag::arenaLights[]
+//four floodlights over the corners of the court, a glow around the ball, and a ring of coloured display lights
+int updateSceneLights(const GameState &state)
+{
+	const CourtLayout &court = state.court;
+	int count = 0;
+	for (int corner = 0; corner < 4; corner++)
+	{
+		PointLight &flood = sceneLights[count++];
+		flood.position = glm::vec3((corner & 1) ? court.halfWidth : -court.halfWidth, 2.5f, (corner & 2) ? court.halfLength : -court.halfLength);
+		flood.radius = 7.0f;
+		flood.color = glm::vec3(0.45f, 0.42f, 0.35f);
+	}
+
+	PointLight &glow = sceneLights[count++];
+	glow.position = state.ballPosition;
+	glow.radius = 1.2f;
+	glow.color = glm::vec3(0.2f, 1.0f, 0.2f);
+
+	//spaced evenly around a rectangle just outside the bounds, with the hue going round the colour wheel
+	const float x = court.halfWidth + 0.3f;
+	const float z = court.halfLength + 0.3f;
+	const glm::vec3 corners[5] = { { -x, 0.4f, -z }, { x, 0.4f, -z }, { x, 0.4f, z }, { -x, 0.4f, z }, { -x, 0.4f, -z } };
+	const float perimeter = 4.0f * (x + z);
+	for (int i = 0; i < displayLightCount; i++)
+	{
+		float along = perimeter * i / displayLightCount;
+		int side = 0;
+		while (side < 3 && along > glm::length(corners[side + 1] - corners[side]))
+		{
+			along -= glm::length(corners[side + 1] - corners[side]);
+			side++;
+		}
+		glm::vec3 position = corners[side] + glm::normalize(corners[side + 1] - corners[side]) * along;
+
+		float hue = 6.0f * i / displayLightCount;
+		PointLight &display = sceneLights[count++];
+		display.position = position;
+		display.radius = 0.9f;
+		display.color = 0.6f * glm::clamp(glm::vec3(std::abs(hue - 3.0f) - 1.0f, 2.0f - std::abs(hue - 2.0f), 2.0f - std::abs(hue - 4.0f)), 0.0f, 1.0f);
+	}
+	return count;
+}
+// end::arenaLights[]
+
+void emitParticles(const glm::vec3 &position, const glm::vec3 &normal, int count)
+{
+	particles.emit(position, normal, count);
+}
+
+// tag::renderParticles[]
+//start sparks for any impacts since the last frame, then move and draw every particle - all on the GPU
+void renderParticles(const GameState &state, const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix)
+{
+	if (state.impactCount < impactsSeen) // a new game, or a rollback replayed history differently
+		impactsSeen = state.impactCount;
+	if (state.impactCount - impactsSeen > recentImpactCount) // too many to remember - only the latest are kept
+		impactsSeen = state.impactCount - recentImpactCount;
+	for (; impactsSeen < state.impactCount; impactsSeen++)
+	{
+		const ImpactEvent &impact = state.recentImpacts[impactsSeen % recentImpactCount];
+		particles.emit(impact.position, impact.normal, particlesPerImpact);
+	}
+
+	Uint64 now = SDL_GetPerformanceCounter();
+	float deltaTime = (lastParticleUpdate == 0) ? 0.0f : float(double(now - lastParticleUpdate) / double(SDL_GetPerformanceFrequency()));
+	lastParticleUpdate = now;
+	particles.update(std::min(deltaTime, 0.1f)); // don't let a long pause throw everything through the floor
+
+	//the size of a particle one unit away, in pixels
+	float pointScale = particleSize * projectionMatrix[1][1] * sceneHeight * 0.5f;
+	particles.draw(viewMatrix, projectionMatrix, pointScale);
+}
+// end::renderParticles[]
+
+// tag::renderArena[]
+//the arena plays on at the game's tick rate however fast frames are drawn, and is drawn straight from its own buffers
+void renderArena(const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix)
+{
+	if (arenaCourts == 0 || arenaUnavailable)
+		return;
+	if (!arena.loaded()) // loaded on first use, as most games don't have one
+	{
+		if (!arena.load((assetDirectory + "arenaUpdateShader.glsl").c_str(), (assetDirectory + "arenaVertexShader.glsl").c_str(), (assetDirectory + "arenaFragmentShader.glsl").c_str()))
+		{
+			arenaUnavailable = true;
+			return;
+		}
+		GpuArena::Mesh redBat = { vertexDataBufferObject.get(), 0, 36 };
+		GpuArena::Mesh blueBat = { vertexDataBufferObject.get(), 36, 36 };
+		GpuArena::Mesh ball = { vertexDataBufferObject2.get(), 0, 36 };
+		arena.setMeshes(redBat, blueBat, ball);
+	}
+	if (arena.courts() != arenaCourts)
+	{
+		arena.reset(arenaCourts);
+		lastArenaUpdate = 0;
+		arenaTimeOwed = 0.0;
+	}
+
+	Uint64 now = SDL_GetPerformanceCounter();
+	if (lastArenaUpdate != 0)
+		arenaTimeOwed += double(now - lastArenaUpdate) / double(SDL_GetPerformanceFrequency());
+	lastArenaUpdate = now;
+	int ticks = std::min(int(arenaTimeOwed / arenaTickLength), maxArenaTicksPerFrame);
+	arenaTimeOwed = std::min(arenaTimeOwed - ticks * arenaTickLength, arenaTickLength); // after a long frame, drop the time rather than catch up
+	arena.step(ticks);
+
+	arena.draw(viewMatrix, projectionMatrix);
+}
+// end::renderArena[]
+
+// tag::sceneAnimating[]
+//the parts of the scene that move on their own, without the game state changing
+bool sceneAnimating()
+{
+	return !particles.settled() || (arenaCourts > 0 && !arenaUnavailable) || meshStreamer.streaming();
+}
+// end::sceneAnimating[]
+
+// tag::renderHud[]
+//everything 2D goes into the HUD layer, which draws it all at once
+void renderHud(const GameState &state, const char *hudText)
+{
+	hud.begin(drawableWidth, drawableHeight); // always at the window's own resolution, so the text stays sharp
+
+	// the score pips - the same size and places as the old per-pip draws, which were in normalised device coordinates
+	const float pipWidth = 0.05f * drawableWidth / 2.0f;
+	const float pipHeight = 0.05f * drawableHeight / 2.0f;
+	const float pipSpacing = 0.08f * drawableWidth / 2.0f;
+	const float pipTop = 0.025f * drawableHeight - pipHeight / 2.0f;
+	for (unsigned int i = 0; i < state.redScore; i++)
+		hud.addQuad(0.025f * drawableWidth + i * pipSpacing - pipWidth / 2.0f, pipTop, pipWidth, pipHeight, redPipColor); // Red Score
+	for (unsigned int i = 0; i < state.blueScore; i++)
+		hud.addQuad(0.975f * drawableWidth - i * pipSpacing - pipWidth / 2.0f, pipTop, pipWidth, pipHeight, bluePipColor); // Blue Score
+
+	if (hudText != nullptr)
+		hud.addText(10.0f, pipTop + pipHeight + 10.0f, 2.0f, hudText, hudTextColor);
+
+	hud.draw();
+}
+// end::renderHud[]
+
+// tag::render[]
+void render(const GameState &state, int camView, const char *hudText)
+{
+	glState.invalidateBindings(); // the HUD, particles and mesh uploads bind things without telling the cache
+	glState.useProgram(theProgram.get()); //installs the program object specified by program as part of current rendering state
+
+	//set projectionMatrix - how we go from 3D to 2D
+	//the aspect is the scene target's, which follows the window and the render scale, so the court isn't stretched when either changes
+	float aspect = float(sceneWidth) / float(sceneHeight);
+	glm::mat4 projectionMatrix = glm::perspective(90.0f, aspect, nearPlane, farPlane); // http://stackoverflow.com/questions/8115352/glmperspective-explanation
+
+	//set viewMatrix - how we control the view (viewpoint, view direction, etc)
+	glm::mat4 viewMatrix;
+
+	// I learned Camera stuff from here http://learnopengl.com/#!Getting-started/Camera
+	// the views space cycles through come from the scene - each placed relative to whatever it follows
+	const SceneCamera &camera = renderScene.cameras[(camView >= 1 && camView <= sceneCameraCount) ? camView - 1 : 0];
+	glm::vec3 followed(0.0f);
+	if (camera.follow == FOLLOW_RED_BAT)
+		followed = state.position1;
+	else if (camera.follow == FOLLOW_BLUE_BAT)
+		followed = state.position2;
+	else if (camera.follow == FOLLOW_BALL)
+		followed = state.ballPosition;
+	viewMatrix = glm::lookAt(followed + camera.eye, followed + camera.target, glm::vec3(0.0f, 1.0f, 0.0f));
+
+	// ==================================== Sort the lights into clusters ================================
+	lightClusters.assign(sceneLights, updateSceneLights(state), viewMatrix, projectionMatrix, nearPlane, farPlane);
+	lightClusters.upload();
+	lightClusters.bind(glState, theProgram.get(), firstLightTextureUnit);
+	glState.uniform2f(viewportSizeLocation, float(sceneWidth), float(sceneHeight));
+
+	// ==================================== Place every object ================================
+	// the bats have two placements - the compiled-in cubes have their z offset baked in, the streamed meshes don't -
+	// and both are moved to the court's bat planes
+	const CourtLayout &court = state.court;
+	const glm::vec3 batPlaneShift(0.0f, 0.0f, court.batPlane - defaultCourtLayout().batPlane);
+	const glm::vec3 batMeshOffset(0.0f, 0.0f, court.batPlane + batMeshHalfDepth);
+	transforms.clear();
+	int redBat = transforms.addTranslated(state.position1 - batPlaneShift);
+	int redBatStreamed = transforms.addTranslated(state.position1 - batMeshOffset);
+	int blueBat = transforms.addTranslated(state.position2 + batPlaneShift);
+	int blueBatStreamed = transforms.addTranslated(state.position2 + batMeshOffset);
+
+	for (SceneObject &wall : sceneObjects)
+		wall.object = transforms.addTranslated(wall.position);
+
+	int ball = transforms.addRotated(state.ballPosition, state.rotateAngle, glm::vec3(1, 1, 1));
+
+	transforms.build(viewMatrix, projectionMatrix);
+	transforms.upload();
+
+	// nothing below draws straight away - it all goes in the render queue, which is drawn in state order at the end
+
+	// ==================================== Render the Bats ================================
+	if (!submitStreamedMesh(redBatMesh, redBatStreamed, projectionMatrix))
+		submitArrays(vertexArrayObject.get(), 0, 36, redBat);
+
+	if (!submitStreamedMesh(blueBatMesh, blueBatStreamed, projectionMatrix))
+		submitArrays(vertexArrayObject.get(), 36, 36, blueBat); // the second of the two bats in the buffer
+
+	// =================================== Render the Walls ==================================
+	for (const SceneObject &wall : sceneObjects)
+		submitArrays(wall.vertexArray.get(), 0, 36, wall.object);
+
+	// ==================================== Render the Ball ==================================
+	if (!submitStreamedMesh(ballMesh, ball, projectionMatrix))
+		submitArrays(vertexArrayObject2.get(), 0, 36, ball);
+
+	renderQueue.execute(glState);
+
+	glState.bindVertexArray(0);
+	glState.useProgram(0); //clean up
+
+	renderArena(viewMatrix, projectionMatrix);
+	renderParticles(state, viewMatrix, projectionMatrix);
+
+	sceneTarget.present(sceneWidth, sceneHeight, outputFramebuffer); // upscale the scene to the window
+
+	renderHud(state, hudText);
+	gpuTimer.end();
+	glState.endFrame();
+}
+// end::render[]
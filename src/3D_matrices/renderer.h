@@ -0,0 +1,73 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "game.h"
+#include "glStateCache.h"
+#include "gpuResources.h"
+#include "scene.h"
+
+// tag::renderer[]
+//Everything that talks to OpenGL: the GLSL program, the vertex data, and drawing a GameState.
+//Needs a current GL context, created by main() (or the benchmark harness).
+extern std::string assetDirectory; // prefix for shader and mesh files - empty means the working directory
+
+// tag::assetPackOptions[]
+//If there is an asset pack (assets.pack in the asset directory, unless set otherwise), loadAssets() maps it and
+//everything in it is loaded from there - anything not in it is still loaded from its own file (see assetPack.h)
+void setAssetPackPath(const std::string &filePath); // empty to always use the loose files
+bool packAssets(const std::string &packPath); // writes every shader, mesh and vertex array the game loads into one pack
+std::vector<std::string> assetFileNames(); // the shaders and meshes the game loads from files, by name
+// end::assetPackOptions[]
+
+std::string loadShader(const std::string filePath); // from the asset pack, if it has a file of that name
+GpuShader createShader(GLenum eShaderType, const std::string &strShaderFile);
+GpuProgram createProgram(const std::vector<GpuShader> &shaderList, const std::vector<const char *> &feedbackVaryings = std::vector<const char *>(), // varyings to capture with transform feedback, if any
+	const char *label = "program"); // what the leak report calls it
+
+void loadAssets(); // create GLSL Shaders, link into a GLSL program, and load the vertex data
+void unloadAssets();
+
+void preRender();
+void render(const GameState &state, int camView, const char *hudText = nullptr); // hudText may have several lines
+void renderHud(const GameState &state, const char *hudText);
+bool sceneAnimating(); // would the next frame differ from the last even with the same game state? - sparks, the arena, meshes still streaming in
+
+// tag::applyScene[]
+//the walls and cameras come from a Scene (see scene.h) - the compiled-in court until another is applied.
+//applyScene works out what changed since the last one, and only builds and uploads the walls that did -
+//called before loadAssets, it just keeps the scene for loadAssets to build
+SceneDiff applyScene(const Scene &scene);
+int sceneWallUploads(); // wall buffers uploaded so far - what the scene changes have cost
+// end::applyScene[]
+
+void setDisplayLightCount(int count); // the coloured lights around the arena, on top of the floodlights and the ball's glow
+void setLightClustering(bool clustered); // false shades every fragment with every light, for comparison
+void setArenaCourts(int count); // AI courts behind the main one, simulated and drawn on the GPU - 0, the default, for none
+
+// tag::renderResolution[]
+//the size of the window is set by main() (or the benchmarks) - the scene is drawn at a fraction of it
+//and stretched to fit, with the fraction picked each frame to keep the GPU time under a target
+struct RenderResolution
+{
+	int sceneWidth;
+	int sceneHeight;
+	float scale;
+	bool dynamic;
+	double gpuFrameMs; // the most recent measured frame
+};
+
+void setDrawableSize(int width, int height);
+void setOutputFramebuffer(GLuint framebuffer); // where the finished frame goes - 0, the window, by default
+void setTargetFrameTime(float frameMs); // dynamic resolution, aiming for this GPU time per frame (the default, at 16 ms)
+void setRenderScale(float scale); // a fixed scale instead
+RenderResolution renderResolution();
+
+GLStateCache::Counts renderCallCounts(); // last frame's GL calls in the scene pass - issued, and skipped as redundant
+// end::renderResolution[]
+
+void emitParticles(const glm::vec3 &position, const glm::vec3 &normal, int count); // sparks on top of the ones render() makes for each impact
+// end::renderer[]
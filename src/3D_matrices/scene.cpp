@@ -0,0 +1,265 @@
+#include "scene.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <cmath>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+using std::string;
+
+static SceneCamera sceneCamera(CameraFollow follow, const glm::vec3 &eye, const glm::vec3 &target)
+{
+	SceneCamera camera;
+	camera.follow = follow;
+	camera.eye = eye;
+	camera.target = target;
+	return camera;
+}
+
+static SceneWall sceneWall(const char *name, float x, float z, float width, float depth)
+{
+	SceneWall wall;
+	wall.name = name;
+	wall.position = glm::vec2(x, z);
+	wall.size = glm::vec2(width, depth);
+	return wall;
+}
+
+// tag::defaultScene[]
+Scene defaultScene()
+{
+	Scene scene;
+	scene.court = defaultCourtLayout();
+	scene.cameras[0] = sceneCamera(FOLLOW_COURT, glm::vec3(0.0f, 1.5f, 4.0f), glm::vec3(0.0f)); // Standard behind blue view
+	scene.cameras[1] = sceneCamera(FOLLOW_COURT, glm::vec3(2.0f, 3.5f, 0.0f), glm::vec3(0.0f)); // Above and look down view
+	scene.cameras[2] = sceneCamera(FOLLOW_RED_BAT, glm::vec3(0.0f, 1.5f, -4.0f), glm::vec3(0.0f)); // Track Red
+	scene.cameras[3] = sceneCamera(FOLLOW_BLUE_BAT, glm::vec3(0.0f, 1.5f, 4.0f), glm::vec3(0.0f)); // Track Blue
+	scene.cameras[4] = sceneCamera(FOLLOW_BALL, glm::vec3(2.0f, 3.5f, 0.0f), glm::vec3(0.0f)); // Track the ball
+	scene.walls.push_back(sceneWall("left", -2.5f, 0.0f, 0.1f, 6.0f));
+	scene.walls.push_back(sceneWall("right", 2.5f, 0.0f, 0.1f, 6.0f));
+	scene.walls.push_back(sceneWall("red", 0.0f, -3.0f, 5.0f, 0.2f));
+	scene.walls.push_back(sceneWall("blue", 0.0f, 3.0f, 5.0f, 0.2f));
+	return scene;
+}
+// end::defaultScene[]
+
+// tag::parseScene[]
+//reads count numbers, and checks there is nothing after them
+static bool readNumbers(std::istringstream &line, float *values, int count)
+{
+	for (int i = 0; i < count; i++)
+		if (!(line >> values[i]) || !std::isfinite(values[i]))
+			return false;
+	string extra;
+	return !(line >> extra);
+}
+
+static bool parseFollow(const string &word, CameraFollow &follow)
+{
+	if (word == "court")
+		follow = FOLLOW_COURT;
+	else if (word == "red")
+		follow = FOLLOW_RED_BAT;
+	else if (word == "blue")
+		follow = FOLLOW_BLUE_BAT;
+	else if (word == "ball")
+		follow = FOLLOW_BALL;
+	else
+		return false;
+	return true;
+}
+
+//the court has to fit the bats (1 wide, 0.2 deep) and the ball (0.2 across), with the ball clear of both bats when it's served
+static const char *checkCourt(const CourtLayout &court)
+{
+	if (court.halfWidth < 0.6f)
+		return "the court is too narrow for a bat and the ball";
+	if (court.batPlane <= 0.1f)
+		return "the bats are too close to the middle - the ball is served from there";
+	if (court.halfLength < court.batPlane + 0.2f)
+		return "the bats don't fit between their planes and the goals";
+	return nullptr;
+}
+
+bool parseScene(const std::string &text, const std::string &sourceName, Scene &scene)
+{
+	Scene parsed = defaultScene();
+	parsed.walls.clear();
+
+	std::istringstream lines(text);
+	string lineText;
+	int lineNumber = 0;
+	const char *problem = nullptr;
+	while (problem == nullptr && std::getline(lines, lineText))
+	{
+		lineNumber++;
+		size_t comment = lineText.find('#');
+		if (comment != string::npos)
+			lineText.erase(comment);
+		std::istringstream line(lineText);
+		string keyword;
+		if (!(line >> keyword))
+			continue; // blank, or only a comment
+
+		if (keyword == "court")
+		{
+			float values[3];
+			if (!readNumbers(line, values, 3))
+				problem = "court needs <half width> <half length> <bat plane>";
+			else
+			{
+				parsed.court.halfWidth = values[0];
+				parsed.court.halfLength = values[1];
+				parsed.court.batPlane = values[2];
+				problem = checkCourt(parsed.court);
+			}
+		}
+		else if (keyword == "camera")
+		{
+			int view = 0;
+			string follow;
+			float values[6];
+			CameraFollow followed;
+			if (!(line >> view >> follow) || !readNumbers(line, values, 6))
+				problem = "camera needs <view> <court|red|blue|ball> <eye x y z> <target x y z>";
+			else if (view < 1 || view > sceneCameraCount)
+				problem = "camera views are numbered 1 to 5";
+			else if (!parseFollow(follow, followed))
+				problem = "a camera follows court, red, blue or ball";
+			else if (values[0] == values[3] && values[1] == values[4] && values[2] == values[5])
+				problem = "a camera can't look at its own eye";
+			else
+				parsed.cameras[view - 1] = sceneCamera(followed, glm::vec3(values[0], values[1], values[2]), glm::vec3(values[3], values[4], values[5]));
+		}
+		else if (keyword == "wall")
+		{
+			string name;
+			float values[4];
+			if (!(line >> name) || !readNumbers(line, values, 4))
+				problem = "wall needs <name> <x> <z> <width> <depth>";
+			else if (values[2] <= 0.0f || values[3] <= 0.0f)
+				problem = "a wall needs a width and depth above 0";
+			else if (parsed.walls.size() == maxSceneWalls)
+				problem = "too many walls";
+			else
+			{
+				for (const SceneWall &wall : parsed.walls)
+					if (wall.name == name)
+						problem = "there is already a wall with that name";
+				if (problem == nullptr)
+					parsed.walls.push_back(sceneWall(name.c_str(), values[0], values[1], values[2], values[3]));
+			}
+		}
+		else
+			problem = "expected court, camera or wall";
+	}
+
+	if (problem != nullptr)
+	{
+		cerr << "Scene could not be loaded - " << sourceName << " line " << lineNumber << ": " << problem << endl;
+		return false;
+	}
+	scene = parsed;
+	return true;
+}
+// end::parseScene[]
+
+// tag::diffScenes[]
+const SceneWall *findSceneWall(const Scene &scene, const std::string &name)
+{
+	for (const SceneWall &wall : scene.walls)
+		if (wall.name == name)
+			return &wall;
+	return nullptr;
+}
+
+SceneDiff diffScenes(const Scene &from, const Scene &to)
+{
+	SceneDiff diff;
+	diff.courtChanged = (from.court != to.court);
+	diff.camerasChanged = false;
+	for (int view = 0; view < sceneCameraCount; view++)
+	{
+		const SceneCamera &a = from.cameras[view], &b = to.cameras[view];
+		diff.camerasChanged = diff.camerasChanged || a.follow != b.follow || a.eye != b.eye || a.target != b.target;
+	}
+
+	//a scene has a handful of walls, so looking each one up by name in the other list is plenty
+	for (const SceneWall &wall : from.walls)
+	{
+		const SceneWall *now = findSceneWall(to, wall.name);
+		SceneChange change;
+		change.name = wall.name;
+		if (now == nullptr)
+			change.type = SCENE_WALL_REMOVED;
+		else if (now->size != wall.size)
+			change.type = SCENE_WALL_RESHAPED;
+		else if (now->position != wall.position)
+			change.type = SCENE_WALL_MOVED;
+		else
+			continue;
+		diff.walls.push_back(change);
+	}
+	for (const SceneWall &wall : to.walls)
+	{
+		if (findSceneWall(from, wall.name) != nullptr)
+			continue;
+		SceneChange change;
+		change.type = SCENE_WALL_ADDED;
+		change.name = wall.name;
+		diff.walls.push_back(change);
+	}
+	return diff;
+}
+
+int SceneDiff::count(SceneChangeType type) const
+{
+	int total = 0;
+	for (const SceneChange &change : walls)
+		total += (change.type == type) ? 1 : 0;
+	return total;
+}
+// end::diffScenes[]
+
+// tag::sceneFile[]
+static bool readSceneText(const std::string &filePath, std::string &text)
+{
+	std::ifstream fileStream(filePath, std::ios::in | std::ios::binary);
+	if (!fileStream)
+		return false;
+	text.assign((std::istreambuf_iterator<char>(fileStream)), std::istreambuf_iterator<char>());
+	return true;
+}
+
+bool SceneFile::load(const std::string &path, Scene &scene)
+{
+	filePath = path;
+	if (!readSceneText(filePath, lastText))
+	{
+		cerr << "Scene could not be loaded - cannot read file " << filePath << endl;
+		return false;
+	}
+	if (!parseScene(lastText, filePath, scene))
+		return false;
+	cout << "Scene " << filePath << " loaded OK! " << scene.walls.size() << " walls" << endl;
+	return true;
+}
+
+bool SceneFile::changed()
+{
+	string text;
+	if (filePath.empty() || !readSceneText(filePath, text) || text == lastText)
+		return false;
+	lastText = text;
+	return true;
+}
+
+bool SceneFile::reload(Scene &scene)
+{
+	return parseScene(lastText, filePath, scene);
+}
+// end::sceneFile[]
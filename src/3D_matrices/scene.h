@@ -0,0 +1,104 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#define GLM_FORCE_RADIANS // suppress a warning in GLM 0.9.5
+#include <glm/glm.hpp>
+
+#include "game.h"
+
+// tag::sceneFormat[]
+//The court's layout, read from a text file (court.scene in the asset directory) rather than compiled in.
+//One thing per line, # starts a comment:
+//
+//  court <half width> <half length> <bat plane>     the simulation's bounds - see CourtLayout
+//  camera <view 1-5> <court|red|blue|ball> <eye x y z> <target x y z>
+//                                                   what space cycles through, relative to what it follows
+//  wall <name> <x> <z> <width> <depth>              a wall, centred on (x, z), from the floor to the top of the bats
+//
+//Anything not in the file keeps its compiled-in value, except the walls - the file lists every wall there is.
+//Walls are told apart by name, so changing one line only rebuilds that wall (see diffScenes).
+enum CameraFollow
+{
+	FOLLOW_COURT, // the middle of the court - a fixed camera
+	FOLLOW_RED_BAT,
+	FOLLOW_BLUE_BAT,
+	FOLLOW_BALL
+};
+
+struct SceneCamera
+{
+	CameraFollow follow;
+	glm::vec3 eye; // both relative to what the camera follows
+	glm::vec3 target;
+};
+
+struct SceneWall
+{
+	std::string name;
+	glm::vec2 position; // x and z
+	glm::vec2 size;
+};
+
+const int sceneCameraCount = 5;
+const size_t maxSceneWalls = 64; // each wall is an object in the renderer's transform batch, which has room for 128
+
+struct Scene
+{
+	CourtLayout court;
+	SceneCamera cameras[sceneCameraCount];
+	std::vector<SceneWall> walls;
+};
+
+Scene defaultScene(); // the court the game had before there was a scene file
+bool parseScene(const std::string &text, const std::string &sourceName, Scene &scene); // scene is only changed if all of it parses
+// end::sceneFormat[]
+
+// tag::sceneDiff[]
+//what changed between two scenes - wall by wall, so only those walls need building and uploading again
+enum SceneChangeType
+{
+	SCENE_WALL_ADDED,
+	SCENE_WALL_MOVED, // the same size, somewhere else - only its transform changes
+	SCENE_WALL_RESHAPED, // a different size (and maybe position) - its vertices are rebuilt
+	SCENE_WALL_REMOVED,
+	SCENE_CHANGE_TYPES
+};
+
+struct SceneChange
+{
+	SceneChangeType type;
+	std::string name;
+};
+
+struct SceneDiff
+{
+	bool courtChanged;
+	bool camerasChanged;
+	std::vector<SceneChange> walls;
+
+	bool empty() const { return !courtChanged && !camerasChanged && walls.empty(); }
+	int count(SceneChangeType type) const;
+};
+
+SceneDiff diffScenes(const Scene &from, const Scene &to);
+const SceneWall *findSceneWall(const Scene &scene, const std::string &name); // null if there's no wall of that name
+// end::sceneDiff[]
+
+// tag::sceneFile[]
+//the scene file - changed() reads it again, and reload() parses it only if its text is different from last time
+class SceneFile
+{
+public:
+	bool load(const std::string &filePath, Scene &scene);
+	bool changed(); // false if it's the same, or can't be read for the moment (part way through being saved, say)
+	bool reload(Scene &scene); // the text changed() read - scene is left alone if it doesn't parse
+
+	const std::string &path() const { return filePath; }
+
+private:
+	std::string filePath;
+	std::string lastText; // what was last read, parsed or not - a broken file is only reported once
+};
+// end::sceneFile[]
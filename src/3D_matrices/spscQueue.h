@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// tag::spscQueue[]
+//A fixed-size, lock-free queue for exactly one producer thread and one consumer thread.
+//
+//  - the storage is part of the object, so pushing and popping never touch the heap
+//  - the producer only writes `tail`, the consumer only writes `head`; each side reads the
+//    other's index with acquire ordering, so an element is fully written before it is seen
+//  - `Capacity` must be a power of two; one slot is kept empty to tell full from empty
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+	static_assert((Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+	SpscQueue() : head(0), tail(0) {}
+
+	bool push(const T &value) // producer only - false if the queue is full
+	{
+		size_t currentTail = tail.load(std::memory_order_relaxed);
+		size_t nextTail = (currentTail + 1) & (Capacity - 1);
+		if (nextTail == head.load(std::memory_order_acquire))
+			return false;
+		slots[currentTail] = value;
+		tail.store(nextTail, std::memory_order_release);
+		return true;
+	}
+
+	const T *front() const // consumer only - nullptr if the queue is empty
+	{
+		size_t currentHead = head.load(std::memory_order_relaxed);
+		if (currentHead == tail.load(std::memory_order_acquire))
+			return nullptr;
+		return &slots[currentHead];
+	}
+
+	void pop() // consumer only - call after front() returned an element
+	{
+		size_t currentHead = head.load(std::memory_order_relaxed);
+		head.store((currentHead + 1) & (Capacity - 1), std::memory_order_release);
+	}
+
+	bool pop(T &value) // consumer only - false if the queue is empty
+	{
+		const T *next = front();
+		if (next == nullptr)
+			return false;
+		value = *next;
+		pop();
+		return true;
+	}
+
+private:
+	SpscQueue(const SpscQueue &);
+	SpscQueue &operator=(const SpscQueue &);
+
+	// head and tail on separate cache lines, so the two threads don't fight over one line
+	alignas(64) std::atomic<size_t> head;
+	alignas(64) std::atomic<size_t> tail;
+	T slots[Capacity];
+};
+// end::spscQueue[]
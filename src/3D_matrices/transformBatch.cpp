@@ -0,0 +1,211 @@
+#include "transformBatch.h"
+
+#include <iostream>
+#include <cmath>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define TRANSFORM_BATCH_SSE
+#endif
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+TransformBatch::TransformBatch() : translatedCount(0), rotatedCount(0), objectCount(0), overflowReported(false)
+{
+}
+
+void TransformBatch::clear()
+{
+	translatedCount = rotatedCount = objectCount = 0;
+}
+
+int TransformBatch::add()
+{
+	if (objectCount == maxObjects)
+	{
+		if (!overflowReported)
+			cerr << "Too many objects for one transform batch (" << maxObjects << ") - the rest are not drawn" << endl;
+		overflowReported = true;
+		return -1;
+	}
+	return objectCount++;
+}
+
+int TransformBatch::addTranslated(const glm::vec3 &position)
+{
+	int slot = add();
+	if (slot < 0)
+		return -1;
+	translatedX[translatedCount] = position.x;
+	translatedY[translatedCount] = position.y;
+	translatedZ[translatedCount] = position.z;
+	translatedSlot[translatedCount++] = uint16_t(slot);
+	return slot;
+}
+
+int TransformBatch::addRotated(const glm::vec3 &position, float angle, const glm::vec3 &axis)
+{
+	int slot = add();
+	if (slot < 0)
+		return -1;
+	glm::vec3 unitAxis = glm::normalize(axis);
+	rotatedX[rotatedCount] = position.x;
+	rotatedY[rotatedCount] = position.y;
+	rotatedZ[rotatedCount] = position.z;
+	rotatedAngle[rotatedCount] = angle;
+	axisX[rotatedCount] = unitAxis.x;
+	axisY[rotatedCount] = unitAxis.y;
+	axisZ[rotatedCount] = unitAxis.z;
+	rotatedSlot[rotatedCount++] = uint16_t(slot);
+	return slot;
+}
+
+// tag::matrixColumns[]
+//every column we need is m[0] * x + m[1] * y + m[2] * z + m[3] * w, for one of the two base matrices
+#ifdef TRANSFORM_BATCH_SSE
+struct Columns
+{
+	__m128 c[4];
+
+	explicit Columns(const glm::mat4 &m)
+	{
+		for (int i = 0; i < 4; i++)
+			c[i] = _mm_loadu_ps(glm::value_ptr(m) + i * 4);
+	}
+
+	void combine(float *out, float x, float y, float z) const // w = 0, a direction
+	{
+		__m128 sum = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c[0], _mm_set1_ps(x)), _mm_mul_ps(c[1], _mm_set1_ps(y))), _mm_mul_ps(c[2], _mm_set1_ps(z)));
+		_mm_storeu_ps(out, sum);
+	}
+
+	void combinePoint(float *out, float x, float y, float z) const // w = 1
+	{
+		__m128 sum = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c[0], _mm_set1_ps(x)), _mm_mul_ps(c[1], _mm_set1_ps(y))), _mm_add_ps(_mm_mul_ps(c[2], _mm_set1_ps(z)), c[3]));
+		_mm_storeu_ps(out, sum);
+	}
+
+	void copyRotation(float *out) const // the first three columns, for objects that don't rotate
+	{
+		_mm_storeu_ps(out, c[0]);
+		_mm_storeu_ps(out + 4, c[1]);
+		_mm_storeu_ps(out + 8, c[2]);
+	}
+};
+#else
+struct Columns
+{
+	glm::vec4 c[4];
+
+	explicit Columns(const glm::mat4 &m)
+	{
+		for (int i = 0; i < 4; i++)
+			c[i] = m[i];
+	}
+
+	void combine(float *out, float x, float y, float z) const
+	{
+		glm::vec4 sum = c[0] * x + c[1] * y + c[2] * z;
+		out[0] = sum.x; out[1] = sum.y; out[2] = sum.z; out[3] = sum.w;
+	}
+
+	void combinePoint(float *out, float x, float y, float z) const
+	{
+		glm::vec4 sum = c[0] * x + c[1] * y + c[2] * z + c[3];
+		out[0] = sum.x; out[1] = sum.y; out[2] = sum.z; out[3] = sum.w;
+	}
+
+	void copyRotation(float *out) const
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			out[i * 4] = c[i].x; out[i * 4 + 1] = c[i].y; out[i * 4 + 2] = c[i].z; out[i * 4 + 3] = c[i].w;
+		}
+	}
+};
+#endif
+// end::matrixColumns[]
+
+// tag::buildTransforms[]
+void TransformBatch::build(const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix)
+{
+	const Columns view(viewMatrix);
+	const Columns viewProjection(projectionMatrix * viewMatrix); // the only full matrix product in the batch
+
+	//translate-only: view * translate(p) is the view matrix with its last column moved to view * p
+	for (int i = 0; i < translatedCount; i++)
+	{
+		float *modelView = glm::value_ptr(transforms[translatedSlot[i]].modelView);
+		float *modelViewProjection = glm::value_ptr(transforms[translatedSlot[i]].modelViewProjection);
+		view.copyRotation(modelView);
+		view.combinePoint(modelView + 12, translatedX[i], translatedY[i], translatedZ[i]);
+		viewProjection.copyRotation(modelViewProjection);
+		viewProjection.combinePoint(modelViewProjection + 12, translatedX[i], translatedY[i], translatedZ[i]);
+	}
+
+	//translate and rotate: the same last column, and the first three are the base matrix times the rotation's columns
+	for (int i = 0; i < rotatedCount; i++)
+	{
+		//the rotation glm::rotate builds, column by column
+		float c = std::cos(rotatedAngle[i]);
+		float s = std::sin(rotatedAngle[i]);
+		float ax = axisX[i], ay = axisY[i], az = axisZ[i];
+		float tx = (1.0f - c) * ax, ty = (1.0f - c) * ay, tz = (1.0f - c) * az;
+		const float rotation[3][3] = {
+			{ c + tx * ax, tx * ay + s * az, tx * az - s * ay },
+			{ ty * ax - s * az, c + ty * ay, ty * az + s * ax },
+			{ tz * ax + s * ay, tz * ay - s * ax, c + tz * az } };
+
+		float *modelView = glm::value_ptr(transforms[rotatedSlot[i]].modelView);
+		float *modelViewProjection = glm::value_ptr(transforms[rotatedSlot[i]].modelViewProjection);
+		for (int column = 0; column < 3; column++)
+		{
+			view.combine(modelView + column * 4, rotation[column][0], rotation[column][1], rotation[column][2]);
+			viewProjection.combine(modelViewProjection + column * 4, rotation[column][0], rotation[column][1], rotation[column][2]);
+		}
+		view.combinePoint(modelView + 12, rotatedX[i], rotatedY[i], rotatedZ[i]);
+		viewProjection.combinePoint(modelViewProjection + 12, rotatedX[i], rotatedY[i], rotatedZ[i]);
+	}
+}
+// end::buildTransforms[]
+
+bool TransformBatch::load()
+{
+	buffer = GpuBuffer::create("transforms");
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer.get());
+	buffer.upload(GL_UNIFORM_BUFFER, sizeof(transforms), nullptr, GL_STREAM_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, buffer.get()); // nothing else uses uniform buffers, so this stays bound
+
+	cout << "Transform batch created OK! Up to " << maxObjects << " objects" << endl;
+	return true;
+}
+
+void TransformBatch::unload()
+{
+	buffer.reset();
+}
+
+//orphaned and refilled, like the light buffers, so the driver never waits for last frame's draws
+void TransformBatch::upload()
+{
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer.get());
+	buffer.upload(GL_UNIFORM_BUFFER, sizeof(transforms), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, objectCount * sizeof(ObjectTransform), transforms);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void TransformBatch::bindBlock(GLuint program)
+{
+	GLuint blockIndex = glGetUniformBlockIndex(program, "ObjectTransforms");
+	if (blockIndex == GL_INVALID_INDEX)
+	{
+		cerr << "No ObjectTransforms uniform block in program " << program << endl;
+		return;
+	}
+	glUniformBlockBinding(program, blockIndex, bindingPoint);
+}
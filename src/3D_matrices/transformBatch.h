@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <GL/glew.h>
+
+#define GLM_FORCE_RADIANS // suppress a warning in GLM 0.9.5
+#include <glm/glm.hpp>
+
+#include "gpuResources.h"
+
+// tag::objectTransform[]
+//What the vertex shader needs for one object. Two mat4s is the same layout in C++ and in a std140
+//uniform block, so the array of these is uploaded as it is.
+struct ObjectTransform
+{
+	glm::mat4 modelView; // for lighting, in view space
+	glm::mat4 modelViewProjection;
+};
+// end::objectTransform[]
+
+// tag::transformBatch[]
+//Builds the matrices for every object in the scene in one pass, instead of a glm::translate (and maybe
+//a glm::rotate) per object, followed by two more matrix products per vertex in the shader.
+//
+//  - objects are added as packed arrays - positions, and an angle and axis for the ones that rotate
+//  - projection * view is worked out once, then each object only needs its own columns: a translation
+//    just replaces the last column, so translate-only objects take 2 of the 16 columns the general
+//    case does (and skip building a rotation)
+//  - the columns are worked out 4 floats at a time with SSE, or plain glm where that isn't available
+//  - the results are in the layout of the shader's ObjectTransforms uniform block, so upload() is one
+//    glBufferSubData, and each draw just sets which object it is
+class TransformBatch
+{
+public:
+	static const int maxObjects = 128; // 16 KB of matrices - the smallest uniform block GL guarantees
+	static const GLuint bindingPoint = 0; // the uniform buffer binding the block is read from
+
+	TransformBatch();
+
+	void clear();
+	int addTranslated(const glm::vec3 &position); // returns the object's index, or -1 when full
+	int addRotated(const glm::vec3 &position, float angle, const glm::vec3 &axis); // glm::rotate(glm::translate(...), angle, axis)
+
+	void build(const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix);
+
+	int size() const { return objectCount; }
+	const ObjectTransform &object(int index) const { return transforms[index]; }
+
+	bool load(); // GL thread only - creates the uniform buffer and binds it to bindingPoint
+	void unload();
+	void upload(); // GL thread only - copies the last build() into the buffer
+	static void bindBlock(GLuint program); // points the program's ObjectTransforms block at bindingPoint
+
+private:
+	TransformBatch(const TransformBatch &);
+	TransformBatch &operator=(const TransformBatch &);
+
+	int add();
+
+	//the inputs, one array per component - translate-only objects first, the rotating ones separately
+	float translatedX[maxObjects], translatedY[maxObjects], translatedZ[maxObjects];
+	uint16_t translatedSlot[maxObjects]; // where each one's transform goes
+	int translatedCount;
+
+	float rotatedX[maxObjects], rotatedY[maxObjects], rotatedZ[maxObjects];
+	float rotatedAngle[maxObjects];
+	float axisX[maxObjects], axisY[maxObjects], axisZ[maxObjects]; // normalised when added
+	uint16_t rotatedSlot[maxObjects];
+	int rotatedCount;
+
+	int objectCount;
+	ObjectTransform transforms[maxObjects];
+	bool overflowReported;
+
+	GpuBuffer buffer;
+};
+// end::transformBatch[]
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+
+// tag::tripleBuffer[]
+//Hands the latest copy of a value from one writer thread to one reader thread, without locks.
+//
+//  - there are three slots: one the writer is filling, one the reader is using, and one in the middle
+//  - publish() swaps the writer's slot with the middle one; update() swaps the middle slot with the reader's,
+//    but only if something new was published
+//  - neither side ever waits for the other, and the reader always sees a complete, unchanging value;
+//    if the writer publishes twice before the reader looks, the older value is simply skipped
+template <typename T>
+class TripleBuffer
+{
+public:
+	explicit TripleBuffer(const T &initial) : middle(1), writeIndex(0), readIndex(2)
+	{
+		slots[0] = slots[1] = slots[2] = initial;
+	}
+
+	T &writeBuffer() { return slots[writeIndex]; } // writer only
+
+	void publish() // writer only
+	{
+		writeIndex = middle.exchange(writeIndex | newDataBit, std::memory_order_acq_rel) & indexMask;
+	}
+
+	bool update() // reader only - true if a newer value was published since the last call
+	{
+		if ((middle.load(std::memory_order_relaxed) & newDataBit) == 0)
+			return false;
+		readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & indexMask;
+		return true;
+	}
+
+	const T &readBuffer() const { return slots[readIndex]; } // reader only
+
+private:
+	TripleBuffer(const TripleBuffer &);
+	TripleBuffer &operator=(const TripleBuffer &);
+
+	static const unsigned indexMask = 3;
+	static const unsigned newDataBit = 4;
+
+	T slots[3];
+	alignas(64) std::atomic<unsigned> middle; // index of the middle slot, plus newDataBit
+	alignas(64) unsigned writeIndex;
+	alignas(64) unsigned readIndex;
+};
+// end::tripleBuffer[]
@@ -0,0 +1,213 @@
+#include "udpSocket.h"
+
+#include <iostream>
+#include <cstring>
+
+#ifdef _WIN32
+	#include <ws2tcpip.h>
+	typedef int socklen_t;
+#else
+	#include <sys/socket.h>
+	#include <arpa/inet.h>
+	#include <netdb.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <cerrno>
+#endif
+
+using std::cerr;
+using std::endl;
+
+static const size_t ipAndUdpHeaderBytes = 28;
+
+#ifdef _WIN32
+static const SocketHandle invalidSocket = INVALID_SOCKET;
+
+static bool startNetworking()
+{
+	static bool started = false;
+	if (!started)
+	{
+		WSADATA data;
+		started = (WSAStartup(MAKEWORD(2, 2), &data) == 0);
+	}
+	return started;
+}
+#else
+static const SocketHandle invalidSocket = -1;
+
+static bool startNetworking()
+{
+	return true;
+}
+#endif
+
+UdpSocket::UdpSocket() : handle(invalidSocket), isOpen(false), hasPeer(false), randomState(1), heldCount(0),
+	sentBytes(0), receivedBytes(0), droppedPackets(0)
+{
+	std::memset(&peerAddress, 0, sizeof(peerAddress));
+}
+
+UdpSocket::~UdpSocket()
+{
+	close();
+}
+
+// tag::openSocket[]
+bool UdpSocket::open(uint16_t localPort)
+{
+	if (!startNetworking())
+	{
+		cerr << "UDP socket could not be opened - networking failed to start" << endl;
+		return false;
+	}
+
+	handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (handle == invalidSocket)
+	{
+		cerr << "UDP socket could not be opened" << endl;
+		return false;
+	}
+
+	sockaddr_in local;
+	std::memset(&local, 0, sizeof(local));
+	local.sin_family = AF_INET;
+	local.sin_addr.s_addr = htonl(INADDR_ANY);
+	local.sin_port = htons(localPort);
+	if (bind(handle, (const sockaddr *)&local, sizeof(local)) != 0)
+	{
+		cerr << "UDP socket could not be bound to port " << localPort << endl;
+		close();
+		return false;
+	}
+
+	//never block - the simulation polls for packets between ticks
+#ifdef _WIN32
+	u_long nonBlocking = 1;
+	ioctlsocket(handle, FIONBIO, &nonBlocking);
+#else
+	fcntl(handle, F_SETFL, fcntl(handle, F_GETFL, 0) | O_NONBLOCK);
+#endif
+
+	isOpen = true;
+	return true;
+}
+// end::openSocket[]
+
+bool UdpSocket::setPeer(const std::string &host, uint16_t port)
+{
+	addrinfo hints;
+	std::memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+
+	addrinfo *found = nullptr;
+	if (getaddrinfo(host.c_str(), nullptr, &hints, &found) != 0 || found == nullptr)
+	{
+		cerr << "UDP peer address could not be resolved - " << host << endl;
+		return false;
+	}
+	std::memcpy(&peerAddress, found->ai_addr, sizeof(peerAddress));
+	peerAddress.sin_port = htons(port);
+	freeaddrinfo(found);
+
+	hasPeer = true;
+	return true;
+}
+
+void UdpSocket::close()
+{
+	if (handle == invalidSocket)
+		return;
+#ifdef _WIN32
+	closesocket(handle);
+#else
+	::close(handle);
+#endif
+	handle = invalidSocket;
+	isOpen = false;
+}
+
+double UdpSocket::randomUnit()
+{
+	randomState = randomState * 1664525u + 1013904223u;
+	return double(randomState >> 8) / double(1 << 24);
+}
+
+// tag::sendWithConditions[]
+void UdpSocket::send(const uint8_t *data, size_t size, double nowMs)
+{
+	if (!isOpen || !hasPeer || size > maxPacketSize)
+		return;
+
+	if (simulated.lossRate > 0.0 && randomUnit() < simulated.lossRate)
+	{
+		droppedPackets++;
+		sentBytes += size + ipAndUdpHeaderBytes; // it still cost us the bandwidth
+		return;
+	}
+
+	if (simulated.latencyMs <= 0.0 && simulated.jitterMs <= 0.0)
+	{
+		sendNow(data, size);
+		return;
+	}
+
+	if (heldCount == maxHeldPackets)
+	{
+		droppedPackets++; // like a full router queue
+		return;
+	}
+	HeldPacket &packet = held[heldCount++];
+	packet.sendAtMs = nowMs + simulated.latencyMs + simulated.jitterMs * randomUnit();
+	packet.size = size;
+	std::memcpy(packet.data, data, size);
+	sentBytes += size + ipAndUdpHeaderBytes;
+}
+
+void UdpSocket::update(double nowMs)
+{
+	size_t kept = 0;
+	for (size_t i = 0; i < heldCount; i++)
+	{
+		if (held[i].sendAtMs <= nowMs)
+		{
+			if (::sendto(handle, (const char *)held[i].data, int(held[i].size), 0, (const sockaddr *)&peerAddress, sizeof(peerAddress)) < 0)
+				droppedPackets++;
+		}
+		else
+		{
+			if (kept != i)
+				held[kept] = held[i];
+			kept++;
+		}
+	}
+	heldCount = kept;
+}
+// end::sendWithConditions[]
+
+void UdpSocket::sendNow(const uint8_t *data, size_t size)
+{
+	if (::sendto(handle, (const char *)data, int(size), 0, (const sockaddr *)&peerAddress, sizeof(peerAddress)) >= 0)
+		sentBytes += size + ipAndUdpHeaderBytes;
+}
+
+int UdpSocket::receive(uint8_t *buffer, size_t bufferSize)
+{
+	if (!isOpen)
+		return 0;
+
+	//packets from anyone but the peer are ignored
+	for (;;)
+	{
+		sockaddr_in from;
+		socklen_t fromSize = sizeof(from);
+		int received = int(::recvfrom(handle, (char *)buffer, int(bufferSize), 0, (sockaddr *)&from, &fromSize));
+		if (received <= 0)
+			return 0; // nothing waiting (or an ICMP error from a peer that isn't listening yet)
+		if (hasPeer && (from.sin_addr.s_addr != peerAddress.sin_addr.s_addr || from.sin_port != peerAddress.sin_port))
+			continue;
+		receivedBytes += size_t(received) + ipAndUdpHeaderBytes;
+		return received;
+	}
+}
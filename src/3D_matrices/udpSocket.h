@@ -0,0 +1,86 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+#ifdef _WIN32
+	#include <winsock2.h>
+	typedef SOCKET SocketHandle;
+#else
+	#include <netinet/in.h>
+	typedef int SocketHandle;
+#endif
+
+// tag::networkConditions[]
+//Artificial network conditions, so two players can be tested on one machine over loopback.
+struct NetworkConditions
+{
+	NetworkConditions() : latencyMs(0.0), jitterMs(0.0), lossRate(0.0), seed(1) {}
+
+	double latencyMs; // one way - added to every packet we send
+	double jitterMs; // plus up to this much, picked per packet (so packets can arrive out of order)
+	double lossRate; // 0.05 drops 5% of the packets we send
+	uint32_t seed;
+};
+// end::networkConditions[]
+
+// tag::udpSocket[]
+//A non-blocking UDP socket, talking to one peer.
+//
+//  - send() never blocks; when NetworkConditions are set, packets are dropped or held back
+//    in a fixed-size queue and only handed to the OS by update() once their delay has passed
+//  - time is passed in (milliseconds, from any clock), so tests can run faster than real time
+//  - counts bytes sent and received, including the 28 bytes of IPv4 + UDP header per packet
+class UdpSocket
+{
+public:
+	static const size_t maxPacketSize = 512;
+
+	UdpSocket();
+	~UdpSocket();
+
+	bool open(uint16_t localPort); // false (with a message on cerr) if the port can't be bound
+	bool setPeer(const std::string &host, uint16_t port);
+	void close();
+
+	void setConditions(const NetworkConditions &conditions) { simulated = conditions; randomState = conditions.seed; }
+
+	void send(const uint8_t *data, size_t size, double nowMs);
+	void update(double nowMs); // sends any held-back packets that are due
+	int receive(uint8_t *buffer, size_t bufferSize); // bytes read from the peer, 0 when there is nothing waiting
+
+	uint64_t bytesSent() const { return sentBytes; }
+	uint64_t bytesReceived() const { return receivedBytes; }
+	uint64_t packetsDropped() const { return droppedPackets; } // by the artificial packet loss
+
+private:
+	UdpSocket(const UdpSocket &);
+	UdpSocket &operator=(const UdpSocket &);
+
+	void sendNow(const uint8_t *data, size_t size);
+	double randomUnit();
+
+	struct HeldPacket
+	{
+		double sendAtMs;
+		size_t size;
+		uint8_t data[maxPacketSize];
+	};
+	static const size_t maxHeldPackets = 256;
+
+	SocketHandle handle;
+	bool isOpen;
+	sockaddr_in peerAddress;
+	bool hasPeer;
+
+	NetworkConditions simulated;
+	uint32_t randomState;
+	HeldPacket held[maxHeldPackets];
+	size_t heldCount;
+
+	uint64_t sentBytes;
+	uint64_t receivedBytes;
+	uint64_t droppedPackets;
+};
+// end::udpSocket[]
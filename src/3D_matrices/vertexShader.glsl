@@ -1,14 +1,30 @@
 #version 330
 in vec3 position;
 in vec4 vertexColor;
+in vec3 normal;
 out vec4 fragmentColor;
+out vec3 viewPosition; // lighting is done in view space - the lights are already there
+out vec3 viewNormal;
 
-uniform mat4 modelMatrix      = mat4(1.0);
-uniform mat4 viewMatrix       = mat4(1.0);
-uniform mat4 projectionMatrix = mat4(1.0);
+// every object's matrices, built on the CPU in one batch each frame (see transformBatch.h)
+struct ObjectTransform
+{
+	mat4 modelView;
+	mat4 modelViewProjection;
+};
+
+layout(std140) uniform ObjectTransforms
+{
+	ObjectTransform objects[128]; // TransformBatch::maxObjects
+};
+
+uniform int object = 0; // which one this draw is
 
 void main()
 {
-		gl_Position = projectionMatrix * viewMatrix * modelMatrix * vec4(position, 1.0);
+		ObjectTransform transform = objects[object];
+		gl_Position = transform.modelViewProjection * vec4(position, 1.0);
 		fragmentColor = vertexColor;
+		viewPosition = (transform.modelView * vec4(position, 1.0)).xyz;
+		viewNormal = mat3(transform.modelView) * normal; // the model matrices only translate and rotate
 }